@@ -0,0 +1,115 @@
+#include "bench.h"
+#include "admission.h"
+#include "admission_batch.h"
+#include "metrics.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+    struct Sample {
+        PoolOccupancy occupancy;
+        AdmissionRequest visitor;
+    };
+
+    // Mixed visitors against occupancies anywhere between empty and full, so every rule gets to refuse
+    std::vector<Sample> makeSamples(int pool, size_t count) {
+        std::mt19937_64 rng(42 + pool);
+        const PoolRules &rules = POOL_RULES[pool];
+        std::vector<Sample> samples(count);
+        for (auto &sample: samples) {
+            int people = static_cast<int>(rng() % (rules.capacity + 1));
+            sample.occupancy = {people, static_cast<long>(people) * (20 + static_cast<long>(rng() % 40)),
+                                rng() % 20 == 0};
+            int age = 1 + static_cast<int>(rng() % 69);
+            sample.visitor = {age, rng() % 2 == 0, age < 10 && rng() % 8 != 0, age >= 18 && rng() % 2 == 0, 0};
+        }
+        return samples;
+    }
+
+    template<int Pool>
+    BenchResult run(const char *name, size_t count) {
+        std::vector<Sample> samples = makeSamples(Pool, 4096);
+        const PoolRules &rules = POOL_RULES[Pool];
+
+        uint64_t admitted = 0;
+        uint64_t start = Metrics::nowNs();
+        for (size_t i = 0; i < count; i++) {
+            const Sample &sample = samples[i & (samples.size() - 1)];
+            admitted += PoolPolicy<Pool>::tryAdmit(rules, sample.occupancy, sample.visitor) == ADMITTED;
+        }
+        uint64_t elapsedNs = Metrics::nowNs() - start;
+
+        BenchResult bench;
+        bench.suite = "admission";
+        bench.name = name;
+        bench.values = {
+                {"ns_per_decision",  static_cast<double>(elapsedNs) / static_cast<double>(count)},
+                {"decisions_per_s",  static_cast<double>(count) / (static_cast<double>(elapsedNs) / 1e9)},
+                {"admitted_percent", 100.0 * static_cast<double>(admitted) / static_cast<double>(count)},
+        };
+        return bench;
+    }
+
+    // A full entrance queue judged against all pools: one AdmissionBatch pass versus tryAdmit per
+    // visitor and pool, which is what trying the pools one after another costs without the locks
+    BenchResult runBatch(size_t count) {
+        std::mt19937_64 rng(42);
+        AdmissionBatch batch;
+        while (batch.count < AdmissionBatch::MAX_VISITORS) {
+            int age = 18 + static_cast<int>(rng() % 52);
+            int childAge = rng() % 4 == 0 ? 1 + static_cast<int>(rng() % 9) : 0;
+            uint8_t flags = (rng() % 2 ? CLIENT_VIP : 0) | (rng() % 5 ? CLIENT_CHILD_SWIM_DIAPER : 0);
+            batch.add(age, flags, childAge);
+        }
+        PoolOccupancy occupancy[POOL_COUNT];
+        for (int pool = 0; pool < POOL_COUNT; pool++) {
+            int people = POOL_RULES[pool].capacity / 2;
+            occupancy[pool] = {people, people * 35L, false};
+        }
+
+        size_t rounds = std::max<size_t>(1, count / AdmissionBatch::MAX_VISITORS);
+        uint64_t suggestions = 0;
+        uint64_t start = Metrics::nowNs();
+        for (size_t r = 0; r < rounds; r++) {
+            occupancy[r % POOL_COUNT].count = static_cast<int>(r % 20);
+            batch.evaluate(occupancy);
+            suggestions += batch.suggested[r % AdmissionBatch::MAX_VISITORS] >= 0;
+        }
+        uint64_t batchNs = Metrics::nowNs() - start;
+
+        uint64_t admitted = 0;
+        start = Metrics::nowNs();
+        for (size_t r = 0; r < rounds; r++) {
+            occupancy[r % POOL_COUNT].count = static_cast<int>(r % 20);
+            for (int i = 0; i < batch.count; i++) {
+                AdmissionRequest visitor{batch.ages[i], false, false, batch.childAges[i] > 0, 0};
+                for (int pool = 0; pool < POOL_COUNT; pool++) {
+                    const AdmissionEntry &policy = ADMISSION_POLICIES[pool];
+                    admitted += policy.tryAdmit(POOL_RULES[pool], occupancy[pool], visitor) == ADMITTED;
+                }
+            }
+        }
+        uint64_t singleNs = Metrics::nowNs() - start;
+
+        double visitors = static_cast<double>(rounds) * batch.count;
+        BenchResult bench;
+        bench.suite = "admission";
+        bench.name = "batch_all_pools";
+        bench.values = {
+                {"batch_visitors_per_s",  visitors / (static_cast<double>(batchNs) / 1e9)},
+                {"single_visitors_per_s", visitors / (static_cast<double>(singleNs) / 1e9)},
+                {"checksum",              static_cast<double>((suggestions + admitted) & 0xffff)},
+        };
+        return bench;
+    }
+}
+
+std::vector<BenchResult> Bench::runAdmissionSuite(const BenchOptions &options) {
+    auto count = static_cast<size_t>(option(options, "count", 50000000));
+    return {
+            run<POOL_OLYMPIC>("olympic", count),
+            run<POOL_RECREATIONAL>("recreational", count),
+            run<POOL_CHILDREN>("children", count),
+            runBatch(count / 4),
+    };
+}
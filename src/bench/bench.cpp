@@ -0,0 +1,169 @@
+#include "bench.h"
+#include "error_handler.h"
+#include "shared_memory.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <signal.h>
+
+double Bench::option(const BenchOptions &options, const std::string &name, double defaultValue) {
+    auto it = options.find(name);
+    if (it == options.end()) {
+        return defaultValue;
+    }
+    try {
+        return std::stod(it->second);
+    } catch (const std::exception &) {
+        throw PoolError("Invalid value for --" + name + ": " + it->second);
+    }
+}
+
+double Bench::percentile(std::vector<double> &samples, double fraction) {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto index = static_cast<size_t>(std::ceil(fraction * static_cast<double>(samples.size()))) - 1;
+    return samples[std::min(index, samples.size() - 1)];
+}
+
+namespace {
+    struct Suite {
+        const char *name;
+        std::function<std::vector<BenchResult>(const BenchOptions &)> run;
+    };
+
+    const Suite SUITES[] = {
+            {"spawn",     Bench::runSpawnSuite},
+            {"log",       Bench::runLogSuite},
+            {"admission", Bench::runAdmissionSuite},
+            {"roster",    Bench::runRosterSuite},
+            {"core",      Bench::runCoreSuite},
+            {"shm",       Bench::runShmSuite},
+    };
+
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " [--suite name|all] [--format text|json] [options]\n"
+                  << "Suites:\n"
+                  << "  spawn    visitor spawn latency and spawns/s, fork per visitor versus the prefork zygote\n"
+                  << "           --count n (1000), --ballast-mb n (0, heap touched before forking),\n"
+                  << "           --zygote-idle n (8), --zygote-max n (64)\n"
+                  << "  log      cost of a status log call, shared memory ring versus ostream with std::endl\n"
+                  << "           --count n (1000000)\n"
+                  << "  admission decisions/s of each pool's admission policy over mixed visitors, and a full\n"
+                  << "           queue judged against all pools by AdmissionBatch versus tryAdmit per visitor\n"
+                  << "           --count n (50000000)\n"
+                  << "  roster   scan throughput of the client roster, array of structs versus the SoA kernels\n"
+                  << "           at 100, 10k and 1M entries; --entries n (200000000, entries scanned per case)\n"
+                  << "  core     mean/p50/p99 ns of Pool::enter/leave at 0/50/90% occupancy, Cashier::addToQueue/\n"
+                  << "           processClient at several queue depths, WorkingHoursManager::isOpen,\n"
+                  << "           Lifeguard::notifyClients to 1/10/100 clients and Ticket::isValid; --count n (10000)\n"
+                  << "  shm      time and page faults to a forked visitor's first admission, and p50/p99/max/stddev\n"
+                  << "           of Pool::enter, per segment backend and prefault mode; --count n (10000)\n"
+                  << "All suites run against IPC keys and sockets private to the process, never a running simulation.\n"
+                  << "--format json prints one document, {\"format\":\"pool_bench\",\"version\":1,\"results\":[...]},\n"
+                  << "whose names and value keys only change together with the version.\n";
+    }
+
+    void printResults(const std::vector<BenchResult> &results) {
+        for (const auto &result: results) {
+            std::cout << result.suite << "/" << result.name << "\n";
+            for (const auto &value: result.values) {
+                std::cout << "  " << std::left << std::setw(24) << value.first << std::right
+                          << std::fixed << std::setprecision(2) << value.second << "\n";
+            }
+        }
+        std::cout.flush();
+    }
+
+    std::string jsonString(const std::string &text) {
+        std::string quoted = "\"";
+        for (char c: text) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    // Stable format for comparing releases: bump the version when a field changes meaning
+    void printJson(const std::vector<BenchResult> &results) {
+        std::cout << "{\"format\":\"pool_bench\",\"version\":1,\"results\":[";
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult &result = results[i];
+            std::cout << (i ? ",\n" : "\n") << "{\"suite\":" << jsonString(result.suite)
+                      << ",\"name\":" << jsonString(result.name) << ",\"values\":{";
+            for (size_t j = 0; j < result.values.size(); j++) {
+                std::cout << (j ? "," : "") << jsonString(result.values[j].first) << ":";
+                if (std::isfinite(result.values[j].second)) {
+                    std::cout << std::setprecision(6) << std::defaultfloat << result.values[j].second;
+                } else {
+                    std::cout << "null";
+                }
+            }
+            std::cout << "}}";
+        }
+        std::cout << "\n]}" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string suiteName = "all";
+    std::string format = "text";
+    BenchOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0 || i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--suite") {
+            suiteName = value;
+        } else if (arg == "--format") {
+            format = value;
+        } else {
+            options[arg.substr(2)] = value;
+        }
+    }
+
+    if (format != "text" && format != "json") {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    IpcKeys::usePrivate();
+
+    bool found = false;
+    std::vector<BenchResult> collected;
+    try {
+        for (const auto &suite: SUITES) {
+            if (suiteName == "all" || suiteName == suite.name) {
+                found = true;
+                std::vector<BenchResult> results = suite.run(options);
+                if (format == "json") {
+                    collected.insert(collected.end(), results.begin(), results.end());
+                } else {
+                    printResults(results);
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!found) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (format == "json") {
+        printJson(collected);
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef SWIMMING_POOL_BENCH_H
+#define SWIMMING_POOL_BENCH_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using BenchOptions = std::map<std::string, std::string>;
+
+struct BenchResult {
+    std::string suite;
+    std::string name;
+    std::vector<std::pair<std::string, double>> values;
+};
+
+namespace Bench {
+    double option(const BenchOptions &options, const std::string &name, double defaultValue);
+
+    // Sorts the samples in place
+    double percentile(std::vector<double> &samples, double fraction);
+
+    // Prefork zygote versus one fork() of the spawner per visitor
+    std::vector<BenchResult> runSpawnSuite(const BenchOptions &options);
+
+    // Log ring push versus a formatted std::cout line with std::endl
+    std::vector<BenchResult> runLogSuite(const BenchOptions &options);
+
+    // Admission decisions per second of each pool's compile-time policy
+    std::vector<BenchResult> runAdmissionSuite(const BenchOptions &options);
+
+    // Roster scans over the old array of structs versus the SoA kernels, at 100, 10k and 1M entries
+    std::vector<BenchResult> runRosterSuite(const BenchOptions &options);
+
+    // Hot paths of the pools, cashier, lifeguard and tickets against a private IPC set
+    std::vector<BenchResult> runCoreSuite(const BenchOptions &options);
+
+    // First admission of a freshly forked visitor and Pool::enter jitter per shared segment backend and
+    // prefault mode
+    std::vector<BenchResult> runShmSuite(const BenchOptions &options);
+}
+
+#endif
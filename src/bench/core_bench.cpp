@@ -0,0 +1,219 @@
+#include "bench.h"
+#include "cashier.h"
+#include "client.h"
+#include "error_handler.h"
+#include "lifeguard.h"
+#include "metrics.h"
+#include "pool_manager.h"
+#include "private_facility.h"
+#include "ticket.h"
+#include "working_hours_manager.h"
+#include "sim_clock.h"
+#include <chrono>
+#include <functional>
+#include <sys/msg.h>
+#include <thread>
+
+namespace {
+    const int BENCH_CLIENT_ID = 1;
+    const int PREFILL_ID_BASE = 1000000;
+
+    // Times count samples of batch calls each; the values are per call
+    BenchResult measure(const std::string &name, int count, int batch, const std::function<void()> &call,
+                        const std::function<void()> &between = nullptr) {
+        std::vector<double> samples;
+        samples.reserve(count);
+        double totalNs = 0;
+        for (int i = 0; i < count; i++) {
+            uint64_t start = Metrics::nowNs();
+            for (int j = 0; j < batch; j++) {
+                call();
+            }
+            double ns = static_cast<double>(Metrics::nowNs() - start) / batch;
+            samples.push_back(ns);
+            totalNs += ns;
+            if (between) {
+                between();
+            }
+        }
+
+        BenchResult result;
+        result.suite = "core";
+        result.name = name;
+        result.values = {
+                {"ns_mean",  totalNs / count},
+                {"ns_p50",   Bench::percentile(samples, 0.50)},
+                {"ns_p99",   Bench::percentile(samples, 0.99)},
+                {"calls",    static_cast<double>(count) * batch},
+        };
+        return result;
+    }
+
+    void prefill(PoolState *state, int members, int age, uint8_t flags) {
+        state->currentCount = 0;
+        for (int i = 0; i < members; i++) {
+            state->add(PREFILL_ID_BASE + i, age, flags, -1);
+        }
+    }
+
+    void runPoolCases(std::vector<BenchResult> &results, int count) {
+        // Socket servers for connectToPool(), as the lifeguard processes provide them
+        PoolManager *manager = PoolManager::getInstance();
+        Pool *pools[POOL_COUNT] = {manager->getPool(Pool::PoolType::Olympic),
+                                   manager->getPool(Pool::PoolType::Recreational),
+                                   manager->getPool(Pool::PoolType::Children)};
+        std::unique_ptr<Lifeguard> lifeguards[POOL_COUNT];
+        for (int p = 0; p < POOL_COUNT; p++) {
+            lifeguards[p] = std::make_unique<Lifeguard>(pools[p]);
+        }
+
+        const char *const names[POOL_COUNT] = {"olympic", "recreational", "children"};
+        const int percents[] = {0, 50, 90};
+        for (int p = 0; p < POOL_COUNT; p++) {
+            bool kids = p == POOL_CHILDREN;
+            int age = kids ? 4 : 30;
+            uint8_t flags = kids ? (CLIENT_SWIM_DIAPER | CLIENT_HAS_GUARDIAN) : 0;
+            Client client(BENCH_CLIENT_ID, age, false, kids, kids, kids ? PREFILL_ID_BASE - 1 : -1);
+
+            for (int percent: percents) {
+                prefill(pools[p]->getState(), pools[p]->getCapacity() * percent / 100, age, flags);
+                std::string suffix = "/" + std::string(names[p]) + "/occupancy_" + std::to_string(percent);
+
+                auto leave = [&] {
+                    pools[p]->leave(BENCH_CLIENT_ID);
+                    client.disconnectFromPool();
+                    client.setCurrentPool(nullptr);
+                };
+                results.push_back(measure("pool_enter" + suffix, count, 1, [&] {
+                    if (!pools[p]->enter(client)) {
+                        throw PoolError("pool_bench client was refused by " + std::string(names[p]));
+                    }
+                }, leave));
+
+                auto enter = [&] {
+                    pools[p]->enter(client);
+                };
+                enter();
+                results.push_back(measure("pool_leave" + suffix, count, 1, [&] {
+                    pools[p]->leave(BENCH_CLIENT_ID);
+                }, [&] {
+                    client.disconnectFromPool();
+                    enter();
+                }));
+                leave();
+            }
+            prefill(pools[p]->getState(), 0, age, flags);
+        }
+    }
+
+    void runCashierCases(std::vector<BenchResult> &results, PrivateFacility &facility, int count) {
+        Cashier cashier(false);
+        EntranceQueue &queue = facility.shm->entranceQueue;
+
+        ClientRequest request{};
+        request.mtype = CLIENT_REQUEST_REGULAR_M_TYPE;
+        request.clientId = BENCH_CLIENT_ID;
+        request.age = 30;
+
+        // Tickets go back to the waiting visitor; nobody waits here, so they are dropped untimed
+        auto dropTickets = [&] {
+            TicketMessage ticket{};
+            while (msgrcv(facility.queueId(), &ticket, sizeof(TicketMessage) - sizeof(long), 0, IPC_NOWAIT) > 0) {
+            }
+        };
+
+        const int depths[] = {0, 50, EntranceQueue::MAX_QUEUE_SIZE - 2};
+        for (int depth: depths) {
+            queue.queueSize = 0;
+            for (int i = 0; i < depth; i++) {
+                EntranceQueue::QueueEntry entry{};
+                entry.clientId = PREFILL_ID_BASE + i;
+                entry.age = 30;
+                queue.insert(entry);
+            }
+            std::string suffix = "/depth_" + std::to_string(depth);
+
+            results.push_back(measure("cashier_add_to_queue" + suffix, count, 1, [&] {
+                cashier.addToQueue(request);
+            }, [&] {
+                cashier.processClient();
+                dropTickets();
+            }));
+
+            results.push_back(measure("cashier_process_client" + suffix, count, 1, [&] {
+                cashier.processClient();
+            }, [&] {
+                dropTickets();
+                cashier.addToQueue(request);
+            }));
+        }
+        queue.queueSize = 0;
+        dropTickets();
+    }
+
+    void runNotifyCases(std::vector<BenchResult> &results, int count) {
+        Pool *pool = PoolManager::getInstance()->getPool(Pool::PoolType::Olympic);
+        std::string path = IpcKeys::socketPath(POOL_OLYMPIC);
+
+        const int fanOuts[] = {1, 10, 100};
+        for (int fanOut: fanOuts) {
+            Lifeguard lifeguard(pool);
+
+            std::vector<int> sockets;
+            for (int i = 0; i < fanOut; i++) {
+                int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+                checkSystemCall(fd, "Cannot create client socket");
+                sockets.push_back(fd);
+
+                struct sockaddr_un addr{};
+                addr.sun_family = AF_UNIX;
+                strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+                checkSystemCall(connect(fd, (struct sockaddr *) &addr, sizeof(addr)),
+                                "Cannot connect to pool socket");
+            }
+            // The lifeguard's accept thread registers the connections in the background
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+            LifeguardMessage message{};
+            results.push_back(measure("lifeguard_notify/clients_" + std::to_string(fanOut), count, 1, [&] {
+                lifeguard.notifyClients(LIFEGUARD_ACTION_RETURN);
+            }, [&] {
+                for (int fd: sockets) {
+                    while (recv(fd, &message, sizeof(message), MSG_DONTWAIT) > 0) {
+                    }
+                }
+            }));
+
+            for (int fd: sockets) {
+                close(fd);
+            }
+        }
+    }
+}
+
+std::vector<BenchResult> Bench::runCoreSuite(const BenchOptions &options) {
+    int count = static_cast<int>(option(options, "count", 10000));
+
+    PrivateFacility facility;
+    std::vector<BenchResult> results;
+
+    runPoolCases(results, count);
+    runCashierCases(results, facility, count);
+
+    results.push_back(measure("working_hours_is_open", count, 1, [] {
+        if (!WorkingHoursManager::isOpen()) {
+            throw PoolError("private facility reported closed");
+        }
+    }));
+
+    runNotifyCases(results, count);
+
+    // Far below the timer's resolution on its own, so timed in batches
+    Ticket ticket(1, BENCH_CLIENT_ID, 1, SimClock::now(), false, false);
+    volatile int valid = 0;
+    results.push_back(measure("ticket_is_valid", count, 100, [&] {
+        valid = valid + ticket.isValid();
+    }));
+
+    return results;
+}
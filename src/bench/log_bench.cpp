@@ -0,0 +1,63 @@
+#include "bench.h"
+#include "event_log.h"
+#include "metrics.h"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <unistd.h>
+
+namespace {
+    BenchResult result(const std::string &name, uint64_t elapsedNs, int calls) {
+        BenchResult bench;
+        bench.suite = "log";
+        bench.name = name;
+        bench.values = {
+                {"ns_per_call",  static_cast<double>(elapsedNs) / calls},
+                {"calls_per_s",  calls / (static_cast<double>(elapsedNs) / 1e9)},
+        };
+        return bench;
+    }
+}
+
+std::vector<BenchResult> Bench::runLogSuite(const BenchOptions &options) {
+    int count = static_cast<int>(option(options, "count", 1000000));
+
+    // A private ring on the heap, so a running simulation's log segment is left alone
+    auto ring = std::make_unique<LogRing>();
+    ring->reset();
+    ring->owner.store(getpid());
+
+    // Pushes in bursts of one ring's worth and drains between them outside the timed region, the
+    // way a process logs a few lines while the drain process empties its ring in the background
+    LogEntry pushed{0, getpid(), LOG_CLIENT_ENTERED, 3, {0, 35, 1}};
+    uint64_t ringNs = 0;
+    LogEntry entry{};
+    for (int done = 0; done < count;) {
+        int burst = std::min<int>(LogRing::SIZE, count - done);
+        uint64_t start = Metrics::nowNs();
+        for (int i = 0; i < burst; i++) {
+            pushed.timestampNs = start;
+            pushed.args[0] = done + i;
+            ring->push(pushed);
+        }
+        ringNs += Metrics::nowNs() - start;
+        done += burst;
+
+        while (ring->pop(entry)) {
+        }
+    }
+
+    BenchResult ringResult = result("ring_push", ringNs, count);
+    ringResult.values.emplace_back("dropped", static_cast<double>(ring->dropped.load()));
+
+    // What every status line used to cost: formatting plus a flush per line
+    int lines = std::max(1, count / 10);
+    std::ofstream devNull("/dev/null");
+    uint64_t start = Metrics::nowNs();
+    for (int i = 0; i < lines; i++) {
+        devNull << "Klient " << i << " w wieku " << 35 << " wszedł na basen " << "Recreational" << std::endl;
+    }
+    uint64_t streamNs = Metrics::nowNs() - start;
+
+    return {ringResult, result("ostream_endl", streamNs, lines)};
+}
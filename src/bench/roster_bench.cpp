@@ -0,0 +1,142 @@
+#include "bench.h"
+#include "metrics.h"
+#include "roster_scan.h"
+#include <random>
+
+namespace {
+    // The roster layout before the structure of arrays, kept here as the baseline
+    struct ClientRecord {
+        int id;
+        int age;
+        bool isVip;
+        bool hasSwimDiaper;
+        bool hasGuardian;
+        int guardianId;
+    };
+
+    struct Roster {
+        std::vector<ClientRecord> records;
+        std::vector<int32_t> ids;
+        std::vector<int32_t> ages;
+        std::vector<int32_t> guardianIds;
+        std::vector<uint8_t> flags;
+    };
+
+    Roster makeRoster(int size) {
+        std::mt19937_64 rng(7);
+        Roster roster;
+        for (int i = 0; i < size; i++) {
+            int age = 1 + static_cast<int>(rng() % 69);
+            bool isVip = rng() % 5 == 0;
+            bool hasGuardian = age < 10;
+            int guardianId = hasGuardian ? i - 1 : -1;
+            roster.records.push_back({i, age, isVip, age <= 3, hasGuardian, guardianId});
+            roster.ids.push_back(i);
+            roster.ages.push_back(age);
+            roster.guardianIds.push_back(guardianId);
+            roster.flags.push_back((isVip ? CLIENT_VIP : 0) | (age <= 3 ? CLIENT_SWIM_DIAPER : 0) |
+                                   (hasGuardian ? CLIENT_HAS_GUARDIAN : 0));
+        }
+        return roster;
+    }
+
+    // Repeats the scan until about `entries` entries have been visited; returns entries per second
+    template<typename Scan>
+    double measure(int size, double entries, int64_t &sink, Scan scan) {
+        int repeats = std::max(1, static_cast<int>(entries / size));
+        uint64_t start = Metrics::nowNs();
+        for (int r = 0; r < repeats; r++) {
+            sink += scan();
+        }
+        uint64_t elapsedNs = Metrics::nowNs() - start;
+        return static_cast<double>(repeats) * size / (static_cast<double>(elapsedNs) / 1e9);
+    }
+
+    enum Scan {
+        SCAN_SUM_AGES,
+        SCAN_FIND_MEMBER,
+        SCAN_COUNT_VIP
+    };
+
+    const char *const SCAN_NAMES[] = {"sum_ages", "find_member", "count_vip"};
+
+    // An id nobody has, so every search walks the whole roster
+    const int32_t MISSING_ID = -2;
+
+    int64_t scanRecords(Scan scan, const std::vector<ClientRecord> &records) {
+        int64_t value = 0;
+        switch (scan) {
+            case SCAN_SUM_AGES:
+                for (const auto &record: records) {
+                    value += record.age;
+                }
+                break;
+            case SCAN_FIND_MEMBER:
+                for (size_t i = 0; i < records.size(); i++) {
+                    if (records[i].id == MISSING_ID || records[i].guardianId == MISSING_ID) {
+                        return static_cast<int64_t>(i);
+                    }
+                }
+                return -1;
+            case SCAN_COUNT_VIP:
+                for (const auto &record: records) {
+                    value += record.isVip;
+                }
+                break;
+        }
+        return value;
+    }
+
+    int64_t scanColumns(Scan scan, const Roster &roster, int size) {
+        switch (scan) {
+            case SCAN_SUM_AGES:
+                return RosterScan::sumAges(roster.ages.data(), size);
+            case SCAN_FIND_MEMBER:
+                return RosterScan::findMember(roster.ids.data(), roster.guardianIds.data(), size, MISSING_ID);
+            case SCAN_COUNT_VIP:
+                return RosterScan::countFlags(roster.flags.data(), size, CLIENT_VIP);
+        }
+        return 0;
+    }
+
+    BenchResult scanResult(Scan scan, int size, double entries, const Roster &roster, int64_t &sink) {
+        BenchResult bench;
+        bench.suite = "roster";
+        bench.name = std::string(SCAN_NAMES[scan]) + "/" + std::to_string(size);
+
+        bench.values.emplace_back("aos_entries_per_s", measure(size, entries, sink, [&] {
+            return scanRecords(scan, roster.records);
+        }));
+
+        for (int kernel = 0; kernel < ROSTER_KERNEL_COUNT; kernel++) {
+            if (!RosterScan::setKernel(static_cast<RosterKernel>(kernel))) {
+                continue;
+            }
+            double rate = measure(size, entries, sink, [&] {
+                return scanColumns(scan, roster, size);
+            });
+            bench.values.emplace_back(std::string(RosterScan::kernelName(static_cast<RosterKernel>(kernel))) +
+                                      "_entries_per_s", rate);
+        }
+        return bench;
+    }
+}
+
+std::vector<BenchResult> Bench::runRosterSuite(const BenchOptions &options) {
+    double entries = option(options, "entries", 200000000);
+    RosterKernel selected = RosterScan::kernel();
+
+    std::vector<BenchResult> results;
+    int64_t sink = 0;
+    for (int size: {100, 10000, 1000000}) {
+        Roster roster = makeRoster(size);
+        for (Scan scan: {SCAN_SUM_AGES, SCAN_FIND_MEMBER, SCAN_COUNT_VIP}) {
+            results.push_back(scanResult(scan, size, entries, roster, sink));
+        }
+    }
+    RosterScan::setKernel(selected);
+
+    // Keeps the scans from being optimized away
+    results.back().values.emplace_back("checksum", static_cast<double>(sink & 0xffff));
+    return results;
+}
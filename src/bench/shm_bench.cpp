@@ -0,0 +1,169 @@
+#include "bench.h"
+#include "client.h"
+#include "error_handler.h"
+#include "lifeguard.h"
+#include "metrics.h"
+#include "pool_manager.h"
+#include "private_facility.h"
+#include <cmath>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    const int BENCH_CLIENT_ID = 1;
+
+    struct Case {
+        const char *name;
+        SegmentBackend backend;
+        SegmentPrefault prefault;
+    };
+
+    const Case CASES[] = {
+            {"sysv/off",         SEGMENT_SYSV,    PREFAULT_OFF},
+            {"sysv/populate",    SEGMENT_SYSV,    PREFAULT_POPULATE},
+            {"posix/off",        SEGMENT_POSIX,   PREFAULT_OFF},
+            {"posix/populate",   SEGMENT_POSIX,   PREFAULT_POPULATE},
+            {"posix/lock",       SEGMENT_POSIX,   PREFAULT_LOCK},
+            {"hugetlb/populate", SEGMENT_HUGETLB, PREFAULT_POPULATE},
+    };
+
+    // What the forked visitor sends back
+    struct ChildReport {
+        uint64_t firstAdmissionNs;     // from fork() in the parent until the first enter() returned
+        long firstAdmissionFaults;
+        long loopFaults;
+        int cycles;
+        bool refused;
+    };
+
+    long minorFaults() {
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_minflt;
+    }
+
+    // Runs in the forked child: a fresh process has no page tables for the shared segment, as a visitor
+    // spawned by the simulation, unless the atfork prefault mapped them before main code runs
+    void runVisitor(Pool *pool, uint64_t forkNs, int count, int resultFd) {
+        ChildReport report{};
+        std::vector<double> samples;
+        samples.reserve(count);
+        Client client(BENCH_CLIENT_ID, 30, false);
+
+        long faults = minorFaults();
+        report.refused = !pool->enter(client);
+        report.firstAdmissionNs = Metrics::nowNs() - forkNs;
+        report.firstAdmissionFaults = minorFaults() - faults;
+
+        faults = minorFaults();
+        for (int i = 0; i < count && !report.refused; i++) {
+            pool->leave(BENCH_CLIENT_ID);
+            client.disconnectFromPool();
+            client.setCurrentPool(nullptr);
+
+            uint64_t start = Metrics::nowNs();
+            report.refused = !pool->enter(client);
+            samples.push_back(static_cast<double>(Metrics::nowNs() - start));
+        }
+        report.loopFaults = minorFaults() - faults;
+        report.cycles = static_cast<int>(samples.size());
+        pool->leave(BENCH_CLIENT_ID);
+
+        bool sent = write(resultFd, &report, sizeof(report)) == sizeof(report) &&
+                    write(resultFd, samples.data(), samples.size() * sizeof(double)) ==
+                    static_cast<ssize_t>(samples.size() * sizeof(double));
+        _exit(sent ? 0 : 1);
+    }
+
+    bool readAll(int fd, void *buffer, size_t size) {
+        auto *bytes = static_cast<char *>(buffer);
+        while (size > 0) {
+            ssize_t got = read(fd, bytes, size);
+            if (got <= 0) {
+                return false;
+            }
+            bytes += got;
+            size -= static_cast<size_t>(got);
+        }
+        return true;
+    }
+
+    // false when the segment could not be created as the case asks (no huge pages reserved), so
+    // normal pages are not reported under the case's name
+    bool measure(const Case &shmCase, int count, BenchResult &result) {
+        SegmentOptions segment;
+        segment.backend = shmCase.backend;
+        segment.prefault = shmCase.prefault;
+        PrivateFacility facility(segment);
+        if (SharedSegment::backend() != shmCase.backend) {
+            std::cerr << "shm/" << shmCase.name << ": skipped, the segment fell back to another backend"
+                      << std::endl;
+            return false;
+        }
+
+        Pool *pool = PoolManager::getInstance()->getPool(Pool::PoolType::Recreational);
+        Lifeguard lifeguard(pool);
+
+        int resultPipe[2];
+        checkSystemCall(pipe(resultPipe), "Cannot create the result pipe");
+        uint64_t forkNs = Metrics::nowNs();
+        pid_t pid = fork();
+        checkSystemCall(pid, "fork failed");
+        if (pid == 0) {
+            close(resultPipe[0]);
+            runVisitor(pool, forkNs, count, resultPipe[1]);
+        }
+        close(resultPipe[1]);
+
+        ChildReport report{};
+        std::vector<double> samples;
+        bool received = readAll(resultPipe[0], &report, sizeof(report));
+        if (received) {
+            samples.resize(static_cast<size_t>(report.cycles));
+            received = readAll(resultPipe[0], samples.data(), samples.size() * sizeof(double));
+        }
+        close(resultPipe[0]);
+        waitpid(pid, nullptr, 0);
+        if (!received || report.refused) {
+            throw PoolError(std::string("shm/") + shmCase.name + ": the visitor was refused or did not report");
+        }
+
+        double mean = 0;
+        for (double ns: samples) {
+            mean += ns / static_cast<double>(samples.size());
+        }
+        double variance = 0;
+        for (double ns: samples) {
+            variance += (ns - mean) * (ns - mean) / static_cast<double>(samples.size());
+        }
+
+        result.suite = "shm";
+        result.name = shmCase.name;
+        result.values = {
+                {"first_admission_us",     static_cast<double>(report.firstAdmissionNs) / 1e3},
+                {"first_admission_faults", static_cast<double>(report.firstAdmissionFaults)},
+                {"enter_ns_p50",           Bench::percentile(samples, 0.50)},
+                {"enter_ns_p99",           Bench::percentile(samples, 0.99)},
+                {"enter_ns_max",           Bench::percentile(samples, 1.0)},
+                {"enter_ns_stddev",        std::sqrt(variance)},
+                {"loop_faults",            static_cast<double>(report.loopFaults)},
+                {"segment_bytes",          static_cast<double>(SharedSegment::mappedBytes())},
+        };
+        return true;
+    }
+}
+
+std::vector<BenchResult> Bench::runShmSuite(const BenchOptions &options) {
+    int count = static_cast<int>(option(options, "count", 10000));
+
+    std::vector<BenchResult> results;
+    for (const Case &shmCase: CASES) {
+        BenchResult result;
+        if (measure(shmCase, count, result)) {
+            results.push_back(result);
+        }
+    }
+    return results;
+}
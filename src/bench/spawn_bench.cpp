@@ -0,0 +1,182 @@
+#include "bench.h"
+#include "client.h"
+#include "client_spawner.h"
+#include "error_handler.h"
+#include "metrics.h"
+#include "process_role.h"
+#include <algorithm>
+#include <iostream>
+#include <poll.h>
+#include <sys/msg.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    struct ReadyMessage {
+        int id;
+        uint64_t readyNs;
+    };
+
+    VisitorProfile benchProfile(int id) {
+        VisitorProfile profile{};
+        profile.id = id;
+        profile.age = 20 + id % 50;
+        profile.isVip = id % 5 == 0;
+        profile.isGuardian = id % 4 == 0;
+        profile.childId = profile.isGuardian ? id + 1000000 : -1;
+        profile.childAge = 4;
+        profile.childHasSwimDiaper = true;
+        return profile;
+    }
+
+    // Does everything runVisitor does before the visitor queues for a ticket, then reports in
+    VisitorHandler readyHandler(int resultFd) {
+        return [resultFd](const VisitorProfile &profile) {
+            setProcessName(std::string("client_" + std::to_string(profile.id)).c_str());
+            srand(profile.id);
+
+            Client client(profile.id, profile.age, profile.isVip);
+            client.setAsGuardian(profile.isGuardian);
+            std::unique_ptr<Client> child;
+            if (profile.isGuardian) {
+                child = std::make_unique<Client>(profile.childId, profile.childAge, profile.isVip,
+                                                 profile.childHasSwimDiaper, true, client.getId());
+                client.addDependent(child.get());
+            }
+
+            ReadyMessage message = {profile.id, Metrics::nowNs()};
+            return write(resultFd, &message, sizeof(message)) == sizeof(message);
+        };
+    }
+
+    bool waitReady(int resultFd, ReadyMessage &message) {
+        struct pollfd pfd = {resultFd, POLLIN, 0};
+        if (poll(&pfd, 1, 5000) <= 0) {
+            return false;
+        }
+        return read(resultFd, &message, sizeof(message)) == sizeof(message);
+    }
+
+    void reapExited() {
+        while (waitpid(-1, nullptr, WNOHANG) > 0) {
+        }
+    }
+
+    void spawnOrThrow(ClientSpawner &spawner, int id) {
+        pid_t pid;
+        SpawnResult result;
+        while ((result = spawner.spawn(benchProfile(id), pid)) != SPAWN_STARTED) {
+            if (result == SPAWN_FAILED && errno != EAGAIN) {
+                throw PoolSystemError("Visitor spawn failed");
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    BenchResult measure(const std::string &name, const std::string &spec, int count, const int resultPipe[2]) {
+        int resultFd = resultPipe[0];
+        auto spawner = ClientSpawner::create(spec, readyHandler(resultPipe[1]));
+        spawner->start();
+
+        const int warmup = 20;
+        ReadyMessage message{};
+        for (int i = 0; i < warmup; i++) {
+            spawnOrThrow(*spawner, i);
+            if (!waitReady(resultFd, message)) {
+                throw PoolError(name + ": visitor did not report in");
+            }
+        }
+
+        // Latency: one visitor at a time, from the spawn call until the visitor process is ready
+        std::vector<double> latenciesUs;
+        latenciesUs.reserve(count);
+        for (int i = 0; i < count; i++) {
+            uint64_t spawnNs = Metrics::nowNs();
+            spawnOrThrow(*spawner, warmup + i);
+            if (!waitReady(resultFd, message)) {
+                throw PoolError(name + ": visitor did not report in");
+            }
+            latenciesUs.push_back(static_cast<double>(message.readyNs - spawnNs) / 1000.0);
+            reapExited();
+        }
+
+        // Throughput: the whole batch at once, until the last visitor is ready
+        uint64_t burstStart = Metrics::nowNs();
+        uint64_t lastReady = burstStart;
+        int ready = 0;
+        for (int i = 0; i < count; i++) {
+            spawnOrThrow(*spawner, warmup + count + i);
+        }
+        while (ready < count && waitReady(resultFd, message)) {
+            lastReady = std::max(lastReady, message.readyNs);
+            ready++;
+            if (ready % 64 == 0) {
+                reapExited();
+            }
+        }
+        if (ready < count) {
+            throw PoolError(name + ": only " + std::to_string(ready) + " visitors reported in");
+        }
+
+        double meanUs = 0;
+        for (double latency: latenciesUs) {
+            meanUs += latency / count;
+        }
+
+        BenchResult result;
+        result.suite = "spawn";
+        result.name = name;
+        result.values = {
+                {"latency_mean_us", meanUs},
+                {"latency_p50_us",  Bench::percentile(latenciesUs, 0.50)},
+                {"latency_p99_us",  Bench::percentile(latenciesUs, 0.99)},
+                {"latency_max_us",  Bench::percentile(latenciesUs, 1.0)},
+                {"spawns_per_s",    count / (static_cast<double>(lastReady - burstStart) / 1e9)},
+        };
+
+        spawner.reset();
+        while (wait(nullptr) > 0) {
+        }
+        return result;
+    }
+}
+
+std::vector<BenchResult> Bench::runSpawnSuite(const BenchOptions &options) {
+    int count = static_cast<int>(option(options, "count", 1000));
+    auto ballastMb = static_cast<size_t>(option(options, "ballast-mb", 0));
+    int zygoteIdle = static_cast<int>(option(options, "zygote-idle", 8));
+    int zygoteMax = static_cast<int>(option(options, "zygote-max", 64));
+
+    // Visitors need the cashier queue to exist. The bench runs under private IPC keys, so the queue is
+    // its own; it is only removed here if this suite created it
+    int createdQueue = msgget(IpcKeys::key(CASHIER_MSG_KEY), IPC_CREAT | IPC_EXCL | 0666);
+    Client::cashierQueueId();
+
+    // Stands in for the heap the spawner has built up, fork() has to copy its page tables
+    std::vector<char> ballast(ballastMb << 20, 1);
+
+    int resultPipe[2];
+    checkSystemCall(pipe(resultPipe), "Failed to create result pipe");
+
+    auto cleanup = [&] {
+        close(resultPipe[0]);
+        close(resultPipe[1]);
+        if (createdQueue >= 0) {
+            msgctl(createdQueue, IPC_RMID, nullptr);
+        }
+    };
+
+    std::vector<BenchResult> results;
+    try {
+        results.push_back(measure("fork", "fork", count, resultPipe));
+        results.push_back(measure("zygote", "zygote:idle=" + std::to_string(zygoteIdle) +
+                                            ",max=" + std::to_string(zygoteMax), count, resultPipe));
+    } catch (...) {
+        cleanup();
+        throw;
+    }
+
+    cleanup();
+    return results;
+}
@@ -1,6 +1,16 @@
 #include "cashier.h"
 #include "error_handler.h"
 #include "shared_memory.h"
+#include "admission_batch.h"
+#include "metrics.h"
+#include "lock_stats.h"
+#include "event_log.h"
+#include "tracer.h"
+#include "latency_histogram.h"
+#include "sim_clock.h"
+#include "shutdown_coordinator.h"
+#include "heartbeat.h"
+#include "shared_segment.h"
 #include <sys/msg.h>
 #include <iostream>
 #include <ctime>
@@ -8,18 +18,21 @@
 #include <algorithm>
 #include <csignal>
 
-Cashier::Cashier() : currentTicketNumber(1), shouldRun(true) {
+Cashier::Cashier(bool processQueue) : shouldRun(true) {
     try {
-        msgId = msgget(CASHIER_MSG_KEY, 0666);
+        msgId = msgget(IpcKeys::key(CASHIER_MSG_KEY), 0666);
         checkSystemCall(msgId, "msgget failed in Cashier");
 
-        semId = semget(SEM_KEY, SEM_COUNT, 0666);
+        semId = semget(IpcKeys::key(SEM_KEY), SEM_COUNT, 0666);
         checkSystemCall(semId, "semget failed in Cashier");
 
-        shmId = shmget(SHM_KEY, sizeof(SharedMemory), 0666);
-        checkSystemCall(shmId, "shmget failed in Cashier");
+        if (!SharedSegment::get()) {
+            throw PoolSystemError("Shared memory segment not found in Cashier");
+        }
 
-        queueProcessingThread = std::thread(&Cashier::processQueueLoop, this);
+        if (processQueue) {
+            queueProcessingThread = std::thread(&Cashier::processQueueLoop, this);
+        }
 
     } catch (const std::exception &e) {
         std::cerr << "Error initializing Cashier: " << e.what() << std::endl;
@@ -28,26 +41,23 @@ Cashier::Cashier() : currentTicketNumber(1), shouldRun(true) {
 }
 
 void Cashier::processClient() {
-    auto *shm = (SharedMemory *) shmat(shmId, nullptr, 0);
-    if (shm == (void *) -1) {
-        throw PoolSystemError("shmat failed in processClient");
-    }
+    LatencyScope latency(LATENCY_OP_PROCESS_CLIENT);
+    SharedMemory *shm = SharedSegment::get();
 
-    struct sembuf op = {SEM_ENTRANCE_QUEUE, -1, 0};
-    checkSystemCall(semop(semId, &op, 1), "semop lock failed");
+    checkSystemCall(LockStats::acquire(semId, SEM_ENTRANCE_QUEUE, SEM_UNDO), "semop lock failed");
 
     try {
         if (shm->entranceQueue.queueSize == 0) {
-            op.sem_op = 1;
-            semop(semId, &op, 1);
-            shmdt(shm);
+            LockStats::release(semId, SEM_ENTRANCE_QUEUE, SEM_UNDO);
             return;
         }
 
+        TraceScope trace(TRACE_PROCESS_CLIENT, shm->entranceQueue.queueSize);
         auto request = shm->entranceQueue.queue[0];
+        trace.setResult(request.clientId);
 
-        int ticketId = currentTicketNumber++;
-        time_t issueTime = time(nullptr);
+        int ticketId = ++shm->entranceQueue.lastTicketNumber;
+        time_t issueTime = SimClock::now();
 
         TicketMessage ticket = {};
         ticket.mtype = request.clientId;
@@ -58,89 +68,99 @@ void Cashier::processClient() {
         ticket.isVip = request.isVip;
         ticket.isChild = request.age < 10;
 
+        // Tells the visitor which pool would take them right now, so they do not go round the pools
+        AdmissionBatch batch;
+        PoolOccupancy occupancy[POOL_COUNT];
+        AdmissionBatch::readOccupancy(*shm, occupancy);
+        batch.addQueueHead(shm->entranceQueue);
+        batch.evaluate(occupancy);
+        ticket.suggestedPool = batch.suggested[0];
+
         checkSystemCall(msgsnd(msgId, &ticket, sizeof(TicketMessage) - sizeof(long), 0), "Failed to send ticket");
+        Metrics::ticketIssued();
+        EventLog::log(LOG_TICKET_ISSUED, ticketId, request.clientId);
 
-        for (int i = 0; i < shm->entranceQueue.queueSize - 1; i++) {
-            shm->entranceQueue.queue[i] = shm->entranceQueue.queue[i + 1];
-        }
-        shm->entranceQueue.queueSize--;
+        int queueClass = EntranceQueue::classOf(request);
+        auto waitS = static_cast<uint64_t>(std::max<time_t>(0, issueTime - request.arrivalTime));
+        double sloS = shm->entranceQueue.waitSloS[queueClass];
+        Metrics::queueWait(queueClass, waitS, sloS > 0 && static_cast<double>(waitS) > sloS);
+
+        shm->entranceQueue.removeFront();
+        Metrics::queueDepth(shm->entranceQueue.queueSize);
 
-        op.sem_op = 1;
-        checkSystemCall(semop(semId, &op, 1), "semop unlock failed");
-        shmdt(shm);
+        checkSystemCall(LockStats::release(semId, SEM_ENTRANCE_QUEUE, SEM_UNDO), "semop unlock failed");
 
     } catch (const std::exception &e) {
-        op.sem_op = 1;
-        semop(semId, &op, 1);
-        shmdt(shm);
+        LockStats::release(semId, SEM_ENTRANCE_QUEUE, SEM_UNDO);
         throw;
     }
 }
 
 void Cashier::addToQueue(const ClientRequest &request) const {
-    auto *shm = (SharedMemory *) shmat(shmId, nullptr, 0);
-    if (shm == (void *) -1) {
-        throw PoolSystemError("shmat failed in addToQueue");
-    }
+    SharedMemory *shm = SharedSegment::get();
 
-    struct sembuf op = {SEM_ENTRANCE_QUEUE, -1, 0};
-    checkSystemCall(semop(semId, &op, 1), "semop lock failed");
+    TraceScope trace(TRACE_QUEUE_ADD, request.clientId, request.mtype == CLIENT_REQUEST_VIP_M_TYPE);
+    checkSystemCall(LockStats::acquire(semId, SEM_ENTRANCE_QUEUE, SEM_UNDO), "semop lock failed");
 
     try {
-        if (shm->entranceQueue.queueSize >= EntranceQueue::MAX_QUEUE_SIZE - 1) {
-            op.sem_op = 1;
-            semop(semId, &op, 1);
-            shmdt(shm);
-            throw PoolError("Queue is full");
-        }
-
         EntranceQueue::QueueEntry entry = {};
         entry.clientId = request.clientId;
         entry.age = request.age;
         entry.hasGuardian = request.hasGuardian;
         entry.hasSwimDiaper = request.hasSwimDiaper;
+        entry.childAge = request.childAge;
+        entry.childHasSwimDiaper = request.childHasSwimDiaper;
         entry.isVip = (request.mtype == CLIENT_REQUEST_VIP_M_TYPE);
-        time(&entry.arrivalTime);
-
-        int insertPos;
-        if (entry.isVip) {
-            insertPos = 0;
-            while (insertPos < shm->entranceQueue.queueSize && shm->entranceQueue.queue[insertPos].isVip) {
-                insertPos++;
-            }
-        } else {
-            insertPos = shm->entranceQueue.queueSize;
-        }
-
+        entry.arrivalTime = SimClock::now();
 
-        shm->entranceQueue.queueSize++;
-        for (int i = shm->entranceQueue.queueSize; i > insertPos; i--) {
-            shm->entranceQueue.queue[i] = shm->entranceQueue.queue[i - 1];
+        int insertPos = shm->entranceQueue.insert(entry);
+        if (insertPos < 0) {
+            throw PoolError("Queue is full");
         }
-        shm->entranceQueue.queue[insertPos] = entry;
+        trace.setResult(insertPos);
+        Metrics::queueDepth(shm->entranceQueue.queueSize);
 
-        op.sem_op = 1;
-        checkSystemCall(semop(semId, &op, 1), "semop unlock failed");
-        shmdt(shm);
+        checkSystemCall(LockStats::release(semId, SEM_ENTRANCE_QUEUE, SEM_UNDO), "semop unlock failed");
 
     } catch (const std::exception &e) {
         std::cerr << "Error in addToQueue: " << e.what() << std::endl;
-        op.sem_op = 1;
-        semop(semId, &op, 1);
-        shmdt(shm);
+        LockStats::release(semId, SEM_ENTRANCE_QUEUE, SEM_UNDO);
         throw;
     }
 }
 
 
+void Cashier::beat() const {
+    uint64_t progressNs = Metrics::nowNs();
+    uint64_t requestNs = requestSinceNs.load(std::memory_order_relaxed);
+    if (requestNs != 0 && requestNs < progressNs) {
+        progressNs = requestNs;
+    }
+    Heartbeat::beat(WATCH_CASHIER, progressNs);
+}
+
+void Cashier::waitForNextCustomer() const {
+    using Clock = std::chrono::steady_clock;
+    auto until = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(2.0 / SimClock::speed()));
+    auto now = Clock::now();
+    while (now < until && shouldRun.load() && !ShutdownCoordinator::stopRequested()) {
+        std::this_thread::sleep_for(std::min<Clock::duration>(BEAT_INTERVAL, until - now));
+        beat();
+        now = Clock::now();
+    }
+}
+
 void Cashier::processQueueLoop() {
-    while (shouldRun.load()) {
+    Heartbeat::attach(WATCH_CASHIER);
+    while (shouldRun.load() && !ShutdownCoordinator::stopRequested()) {
+        beat();
         try {
             processClient();
         } catch (const std::exception &e) {
             std::cerr << "Error processing client: " << e.what() << std::endl;
         }
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        waitForNextCustomer();
     }
 }
 
@@ -149,19 +169,19 @@ bool isClientRequestForTicket(long mType) {
 }
 
 void Cashier::run() {
-    signal(SIGTERM, [](int) {
-        exit(0);
-    });
-
-    while (shouldRun.load()) {
+    while (shouldRun.load() && !ShutdownCoordinator::stopRequested()) {
         ClientRequest request = {};
+        requestSinceNs.store(0, std::memory_order_relaxed);
         ssize_t bytesReceived = msgrcv(msgId, &request, sizeof(ClientRequest) - sizeof(long), 0, 0);
+        requestSinceNs.store(Metrics::nowNs(), std::memory_order_relaxed);
 
         if (bytesReceived > 0 && isClientRequestForTicket(request.mtype)) {
             try {
                 addToQueue(request);
             } catch (const std::exception &e) {
                 std::cerr << "Error adding client to queue: " << e.what() << std::endl;
+                Metrics::ticketRefused();
+                EventLog::log(LOG_TICKET_REFUSED, request.clientId);
 
                 TicketMessage ticket{};
                 ticket.mtype = request.clientId;
@@ -171,6 +191,7 @@ void Cashier::run() {
                 ticket.issueTime = -1;
                 ticket.isVip = request.isVip;
                 ticket.isChild = request.age < 10;
+                ticket.suggestedPool = -1;
 
                 checkSystemCall(msgsnd(msgId, &ticket, sizeof(TicketMessage) - sizeof(long), 0), "Failed to send ticket");
             }
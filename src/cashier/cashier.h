@@ -6,26 +6,36 @@
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 
 class Cashier {
 private:
     int msgId;
     int semId;
-    int shmId;
-    int currentTicketNumber;
     std::vector<Ticket> activeTickets;
     std::atomic<bool> shouldRun;
     std::thread queueProcessingThread;
 
+    // Real time between heartbeats, independent of the simulated clock speed
+    static constexpr std::chrono::milliseconds BEAT_INTERVAL{500};
+
+    // When run() took the request it is still handling; 0 while it waits in msgrcv, which is idle
+    // rather than stalled
+    std::atomic<uint64_t> requestSinceNs{0};
 
-    void processClient();
     void processQueueLoop();
 
-    void addToQueue(const ClientRequest &request) const;
+    // Beats for both loops from the queue thread: a request stuck in run() holds the beat back
+    void beat() const;
+
+    // Two simulated seconds between customers, slept in real-time slices with a beat after each
+    void waitForNextCustomer() const;
 
 public:
-    Cashier();
+    // Without processQueue nobody serves the queue; pool_bench drives addToQueue/processClient itself
+    explicit Cashier(bool processQueue = true);
     ~Cashier() {
         shouldRun.store(false);
         if (queueProcessingThread.joinable()) {
@@ -33,6 +43,10 @@ public:
         }
     }
     void run();
+
+    void addToQueue(const ClientRequest &request) const;
+
+    void processClient();
 };
 
 #endif
\ No newline at end of file
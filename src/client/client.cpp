@@ -1,10 +1,20 @@
 #include "client.h"
+#include "client_spawner.h"
+#include "cpu_placement.h"
+#include "lock_stats.h"
+#include "process_role.h"
 #include "shared_memory.h"
 #include "pool_manager.h"
 #include "error_handler.h"
 #include "working_hours_manager.h"
 #include "ticket.h"
 #include "cashier.h"
+#include "shutdown_coordinator.h"
+#include "event_log.h"
+#include "tracer.h"
+#include "latency_histogram.h"
+#include "sim_clock.h"
+#include "lease.h"
 #include <iostream>
 #include <sys/msg.h>
 #include <unistd.h>
@@ -12,6 +22,8 @@
 #include <sys/file.h>
 #include <csignal>
 
+double Client::hopsPerMinute = 0;
+
 Client::Client(int id, int age, bool isVip, bool hasSwimDiaper, bool hasGuardian, int guardianId) : shouldRun(true),
                                                                                                     clientSocket(-1) {
     try {
@@ -26,6 +38,7 @@ Client::Client(int id, int age, bool isVip, bool hasSwimDiaper, bool hasGuardian
         this->currentPool = nullptr;
         this->hasEvacuated = false;
         this->isGuardian = false;
+        this->suggestedPool = -1;
 
         if (age < 10 && !hasGuardian) {
             throw PoolError("Child under 10 needs a guardian");
@@ -35,9 +48,7 @@ Client::Client(int id, int age, bool isVip, bool hasSwimDiaper, bool hasGuardian
             throw PoolError("Child under 3 needs swim diapers");
         }
 
-        cashierMsgId = msgget(CASHIER_MSG_KEY, 0666);
-        checkSystemCall(cashierMsgId, "msgget failed in Client");
-
+        cashierMsgId = cashierQueueId();
 
     } catch (const std::exception &e) {
         std::cerr << "Error creating Client: " << e.what() << std::endl;
@@ -45,6 +56,15 @@ Client::Client(int id, int age, bool isVip, bool hasSwimDiaper, bool hasGuardian
     }
 }
 
+int Client::cashierQueueId() {
+    static int cachedId = -1;
+    if (cachedId == -1) {
+        cachedId = msgget(IpcKeys::key(CASHIER_MSG_KEY), 0666);
+        checkSystemCall(cachedId, "msgget failed in Client");
+    }
+    return cachedId;
+}
+
 Client::~Client() {
     if (currentPool) {
         disconnectFromPool();
@@ -65,7 +85,13 @@ void Client::waitForTicket() {
     request.hasGuardian = hasGuardian;
     request.hasSwimDiaper = hasSwimDiaper;
     request.isVip = isVip;
+    if (!dependents.empty()) {
+        request.childAge = dependents[0]->age;
+        request.childHasSwimDiaper = dependents[0]->hasSwimDiaper;
+    }
 
+    LatencyScope latency(LATENCY_OP_WAIT_FOR_TICKET);
+    TraceScope trace(TRACE_TICKET_WAIT, id, isVip);
     try {
         checkSystemCall(msgsnd(cashierMsgId, &request, sizeof(ClientRequest) - sizeof(long), 0),
                         "Failed to send ticket request");
@@ -74,6 +100,7 @@ void Client::waitForTicket() {
 
         checkSystemCall(msgrcv(cashierMsgId, &ticketMsg, sizeof(TicketMessage) - sizeof(long),
                                id, 0), "Failed to receive ticket");
+        trace.setResult(ticketMsg.ticketId);
 
         if (ticketMsg.ticketId == -1 && ticketMsg.validityTime == -1) {
             throw PoolError("Facility queue is full, client abandoning pool");
@@ -91,6 +118,7 @@ void Client::waitForTicket() {
                 ticketMsg.isVip,
                 ticketMsg.isChild
         );
+        suggestedPool = ticketMsg.suggestedPool;
 
     } catch (const std::exception &e) {
         std::cerr << "Error in waitForTicket: " << e.what() << std::endl;
@@ -100,10 +128,13 @@ void Client::waitForTicket() {
 
 
 void Client::connectToPool() {
+    std::lock_guard<std::recursive_mutex> lock(connectionMutex);
     disconnectFromPool();
 
+    LatencyScope latency(LATENCY_OP_CONNECT_TO_POOL);
+    TraceScope trace(TRACE_SOCKET_CONNECT, id, static_cast<int>(currentPool->getType()));
     try {
-        socketPath = "/tmp/pool_" + std::to_string(static_cast<int>(currentPool->getType())) + ".sock";
+        socketPath = IpcKeys::socketPath(static_cast<int>(currentPool->getType()));
 
         clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
         if (clientSocket == -1) {
@@ -145,39 +176,39 @@ void Client::moveToAnotherPool() {
 
         if (!WorkingHoursManager::isOpen()) {
             if (poolManager->getPool(Pool::PoolType::Olympic)->getState()->isUnderMaintenance) {
-                std::cout << "Klient szukający basenu opuszcza obiekt ze względu na przerwę techniczną" << std::endl;
-                exit(1);
+                EventLog::log(LOG_CLIENT_LEFT_FOR_MAINTENANCE);
+                shouldRun.store(false);
+                return;
             }
-            sleep(5);
+            SimClock::sleepFor(std::chrono::seconds(5));
             return;
         }
 
         int retries = 0;
+        bool entered = false;
 
-        while (retries < 3 && !currentPool) {
+        while (retries < 3 && !entered) {
+            // One critical section per attempt, released for the wait before the next one
+            std::unique_lock<std::recursive_mutex> lock(connectionMutex);
             Client *dependent = dependents.empty() ? nullptr : dependents[0];
             bool adultWantsToGoToRecreational = rand() % 100 < 25;
 
+            // On the first attempt an adult on their own follows the cashier's advice when one of
+            // their two pools would refuse them
+            if (retries == 0 && suggestedPool == POOL_RECREATIONAL) {
+                adultWantsToGoToRecreational = true;
+            } else if (retries == 0 && suggestedPool == POOL_OLYMPIC) {
+                adultWantsToGoToRecreational = false;
+            }
+
             // Case 1: Guardian with young child (<=5 years) - children's pool
             if (dependent && dependent->getAge() <= 5) {
                 auto childrenPool = poolManager->getPool(Pool::PoolType::Children);
 
                 try {
-                    if (childrenPool->enter(*this) && childrenPool->enter(*dependent)) {
-                        std::cout << "Klient " << this->id << " w wieku " << this->age << " oraz dziecko "
-                                  << dependent->id << " w wieku " << dependent->age << " weszli na basen "
-                                  << childrenPool->getName() << std::endl;
-                        currentPool = childrenPool;
-                        dependent->currentPool = childrenPool;
-                    } else {
-                        if (currentPool) {
-                            childrenPool->leave(id);
-                            currentPool = nullptr;
-                        }
-                        if (dependent->currentPool) {
-                            childrenPool->leave(dependent->getId());
-                            dependent->currentPool = nullptr;
-                        }
+                    if (childrenPool->enterWithDependent(*this, *dependent)) {
+                        EventLog::log(LOG_CLIENT_ENTERED_WITH_CHILD, id, age, dependent->id, dependent->age,
+                                      childrenPool->getType());
                     }
                 } catch (const std::exception &e) {
                     std::cerr << "Failed to connect to pool: " << e.what() << std::endl;
@@ -197,23 +228,15 @@ void Client::moveToAnotherPool() {
                 auto recPool = poolManager->getPool(Pool::PoolType::Recreational);
 
                 try {
-                    bool success = recPool->enter(*this);
+                    bool success = dependent ? recPool->enterWithDependent(*this, *dependent) : recPool->enter(*this);
                     if (success && dependent) {
-                        if (!recPool->enter(*dependent)) {
-                            recPool->leave(id);
-                            success = false;
-                        } else {
-                            dependent->currentPool = recPool;
-                            std::cout << "Klient " << this->id << " w wieku " << this->age << " oraz dziecko "
-                                      << dependent->id << " w wieku " << dependent->age << " weszli na basen "
-                                      << recPool->getName() << std::endl;
-                        }
+                        EventLog::log(LOG_CLIENT_ENTERED_WITH_CHILD, id, age, dependent->id, dependent->age,
+                                      recPool->getType());
                     }
 
                     if (success) {
                         currentPool = recPool;
-                        std::cout << "Klient " << this->id << " w wieku " << this->age << " wszedł na basen "
-                                  << recPool->getName() << std::endl;
+                        EventLog::log(LOG_CLIENT_ENTERED, id, age, recPool->getType());
 
                     }
                 } catch (const std::exception &e) {
@@ -235,8 +258,7 @@ void Client::moveToAnotherPool() {
 
                 try {
                     if (olympicPool->enter(*this)) {
-                        std::cout << "Klient " << this->id << " w wieku " << this->age << " wszedł na basen "
-                                  << olympicPool->getName() << std::endl;
+                        EventLog::log(LOG_CLIENT_ENTERED, id, age, olympicPool->getType());
                         currentPool = olympicPool;
                     }
                 } catch (const std::exception &e) {
@@ -248,51 +270,66 @@ void Client::moveToAnotherPool() {
                 }
             }
 
-            if (!currentPool) {
+            entered = currentPool != nullptr;
+            lock.unlock();
+
+            if (!entered) {
                 retries++;
                 if (retries < 3) {
-                    sleep(3);
+                    TraceScope trace(TRACE_ENTER_RETRY_WAIT, id, retries);
+                    SimClock::sleepFor(std::chrono::seconds(3));
                 }
             }
         }
 
-        if (!currentPool) {
-            exit(0);
+        if (!getCurrentPool()) {
+            shouldRun.store(false);
         }
     } catch (const std::exception &e) {
         std::cerr << "Error moving client " << id << " to another pool: "
                   << e.what() << std::endl;
-        exit(1);
+        shouldRun.store(false);
     }
 }
 
 void Client::handleSocketSignals() {
     try {
-        while (shouldRun.load()) {
+        while (shouldRun.load() && !ShutdownCoordinator::stopRequested()) {
+            // The receive, the reconnect and the reaction are one critical section, so a transfer on
+            // the visitor's thread cannot swap the socket or the pool in between
+            std::unique_lock<std::recursive_mutex> lock(connectionMutex);
             LifeguardMessage msg{};
-            ssize_t received = recv(
-                    clientSocket,
-                    &msg,
-                    sizeof(msg),
-                    MSG_DONTWAIT
-            );
+            ssize_t received = recv(clientSocket, &msg, sizeof(msg), MSG_DONTWAIT);
+
+            // The lifeguard was restarted by the watchdog: subscribe to the new one
+            if (received == 0 && currentPool) {
+                try {
+                    connectToPool();
+                } catch (const std::exception &) {
+                    // Not listening yet, the next pass tries again
+                }
+            }
+
+            // Left over from the lifeguard of a pool this visitor has just transferred from
+            if (received > 0 && currentPool && msg.poolId != static_cast<int>(currentPool->getType())) {
+                received = 0;
+            }
 
             if (received > 0) {
                 if (msg.action == LIFEGUARD_ACTION_EVAC) {
-                    std::cout << "Klient " << id << " otrzymał sygnał do ewakuacji z basenu " << currentPool->getName()
-                              << std::endl;
                     if (currentPool) {
-                        for (auto dependent: dependents) {
-                            dependent->leaveCurrentPool();
-                        }
-                        leaveCurrentPool();
+                        EventLog::log(LOG_CLIENT_EVACUATED, id, currentPool->getType());
+                        Tracer::instant(TRACE_EVACUATION, id, static_cast<int>(currentPool->getType()));
+                        leaveWithDependents();
                     }
                 } else if (msg.action == LIFEGUARD_ACTION_MAINTENANCE) {
                     leaveCurrentPool();
                     throw PoolError("Basen jest w trybie konserwacji, opuszczam obiekt");
                 }
             }
+            lock.unlock();
 
+            Leases::renew();
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
     } catch (const std::exception &e) {
@@ -301,9 +338,7 @@ void Client::handleSocketSignals() {
     }
 }
 
-void Client::run() {
-    signal(SIGTERM, [](int) { exit(0); });
-
+bool Client::run() {
     try {
         waitForTicket();
 
@@ -312,46 +347,50 @@ void Client::run() {
         });
 
         while (shouldRun.load()) {
-            if (!ticket || !ticket->isValid()) {
-                std::cout << "Client " << id << "'s ticket has expired "
-                          << "(was valid for " << ticket->getValidityTime()
-                          << " minutes)" << std::endl;
-
-                if (currentPool) {
-                    leaveCurrentPool();
-
-                    for (auto dependent: dependents) {
-                        dependent->leaveCurrentPool();
-                    }
-                }
+            if (ShutdownCoordinator::stopRequested()) {
+                leaveWithDependents();
+                shouldRun.store(false);
+                break;
+            }
 
+            if (!ticket || !ticket->isValid()) {
+                EventLog::log(LOG_TICKET_EXPIRED, id, ticket ? ticket->getValidityTime() : 0);
+                leaveWithDependents();
                 shouldRun.store(false);
                 break;
             }
 
 
-            if (!currentPool && !hasEvacuated) {
+            if (!getCurrentPool() && !hasEvacuated) {
                 moveToAnotherPool();
+                if (!shouldRun.load()) {
+                    break;
+                }
+            } else {
+                maybeHop();
             }
 
-            sleep(1);
+            SimClock::sleepFor(std::chrono::seconds(1));
         }
 
         if (signalThread.joinable()) {
             signalThread.join();
         }
-        exit(1);
+        Leases::release();
+        return true;
     } catch (const std::exception &e) {
         shouldRun.store(false);
         if (signalThread.joinable()) {
             signalThread.join();
         }
+        Leases::release();
         std::cerr << "Error in client " << id << ": " << e.what() << std::endl;
-        exit(1);
+        return false;
     }
 }
 
 void Client::disconnectFromPool() {
+    std::lock_guard<std::recursive_mutex> lock(connectionMutex);
     if (clientSocket != -1) {
         close(clientSocket);
         clientSocket = -1;
@@ -360,6 +399,11 @@ void Client::disconnectFromPool() {
 }
 
 void Client::leaveCurrentPool(int c_id) {
+    std::lock_guard<std::recursive_mutex> lock(connectionMutex);
+    if (!currentPool) {
+        return;
+    }
+
     int clientIdToLeave = c_id > 0 ? c_id : id;
 
     currentPool->leave(clientIdToLeave);
@@ -367,6 +411,101 @@ void Client::leaveCurrentPool(int c_id) {
     disconnectFromPool();
 }
 
+void Client::leaveWithDependents() {
+    std::lock_guard<std::recursive_mutex> lock(connectionMutex);
+    if (!currentPool) {
+        return;
+    }
+    // The guardian's leave() takes their children out in the same step
+    leaveCurrentPool();
+    for (auto dependent: dependents) {
+        dependent->leaveCurrentPool();
+    }
+}
+
+void Client::handOffConnection(int pool) {
+    std::lock_guard<std::recursive_mutex> lock(connectionMutex);
+    LifeguardRequest request{LIFEGUARD_REQUEST_HANDOFF, pool};
+    if (clientSocket != -1 && send(clientSocket, &request, sizeof(request), MSG_NOSIGNAL) == sizeof(request)) {
+        socketPath = IpcKeys::socketPath(pool);
+        return;
+    }
+    // No connection to pass on: the old lifeguard is gone, so connect to the new one instead
+    connectToPool();
+}
+
+bool Client::transferTo(Pool::PoolType destination) {
+    std::lock_guard<std::recursive_mutex> lock(connectionMutex);
+    Pool *source = currentPool;
+    if (!source) {
+        return false;
+    }
+    Client *dependent = dependents.empty() ? nullptr : dependents[0];
+    if (!PoolManager::getInstance()->transfer(*this, dependent, destination)) {
+        return false;
+    }
+
+    int pool = static_cast<int>(destination);
+    EventLog::log(LOG_CLIENT_TRANSFERRED, id, source->getType(), pool);
+    try {
+        handOffConnection(pool);
+        if (dependent) {
+            dependent->handOffConnection(pool);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Failed to follow client " << id << " to pool " << pool << ": " << e.what() << std::endl;
+    }
+    return true;
+}
+
+void Client::maybeHop() {
+    // Called once a simulated second
+    std::lock_guard<std::recursive_mutex> lock(connectionMutex);
+    if (hopsPerMinute <= 0 || !currentPool || rand() % 6000 >= static_cast<int>(hopsPerMinute * 100)) {
+        return;
+    }
+
+    // Only between the two pools the party may use: the children's and the recreational one with a
+    // small child, the olympic and the recreational one for an adult on their own
+    Client *dependent = dependents.empty() ? nullptr : dependents[0];
+    Pool::PoolType other;
+    if (dependent && dependent->getAge() <= 5) {
+        other = currentPool->getType() == Pool::PoolType::Children ? Pool::PoolType::Recreational
+                                                                    : Pool::PoolType::Children;
+    } else if (!dependent && age >= 18) {
+        other = currentPool->getType() == Pool::PoolType::Olympic ? Pool::PoolType::Recreational
+                                                                   : Pool::PoolType::Olympic;
+    } else {
+        return;
+    }
+    transferTo(other);
+}
+
 void Client::setCurrentPool(Pool *pool) {
+    std::lock_guard<std::recursive_mutex> lock(connectionMutex);
     currentPool = pool;
 }
+
+bool runVisitor(const VisitorProfile &profile) {
+    setProcessName(std::string("client_" + std::to_string(profile.id)).c_str());
+    LockStats::setRole(ProcessRole::Client);
+    CpuPlacement::apply(ProcessRole::Client);
+    srand(profile.id);
+
+    try {
+        Client client(profile.id, profile.age, profile.isVip);
+        client.setAsGuardian(profile.isGuardian);
+
+        std::unique_ptr<Client> child;
+        if (profile.isGuardian && profile.childId != -1) {
+            child = std::make_unique<Client>(profile.childId, profile.childAge, profile.isVip,
+                                             profile.childHasSwimDiaper, true, client.getId());
+            client.addDependent(child.get());
+        }
+
+        return client.run();
+    } catch (const std::exception &e) {
+        std::cerr << "Error in client process: " << e.what() << std::endl;
+        return false;
+    }
+}
@@ -8,6 +8,7 @@
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <mutex>
 #include "pool.h"
 #include "ticket.h"
 
@@ -29,14 +30,30 @@ private:
     std::thread signalThread;
 
     bool isGuardian;
+    int suggestedPool;
+
+    static double hopsPerMinute;
 
     void waitForTicket();
 
     void moveToAnotherPool();
 
+    // Mid-session pool change at the rate of setPoolHopping()
+    void maybeHop();
+
+    // Leaves the pool together with the dependents, under the guardian's lock
+    void leaveWithDependents();
+
+    // Asks the lifeguard on the other end of this visitor's connection to pass it on
+    void handOffConnection(int pool);
+
     int clientSocket;
     std::string socketPath;
 
+    // Guards currentPool, clientSocket and socketPath (also of the dependents) between the visitor's
+    // loop and its signal thread. Recursive because Pool::enter() calls back into setCurrentPool()
+    // and connectToPool(); taken before any pool semaphore, and the guardian's before a dependent's.
+    mutable std::recursive_mutex connectionMutex;
 
 public:
     void disconnectFromPool();
@@ -45,6 +62,15 @@ public:
 
     void setCurrentPool(Pool *pool);
 
+    Pool *getCurrentPool() const {
+        std::lock_guard<std::recursive_mutex> lock(connectionMutex);
+        return currentPool;
+    }
+
+    // Switches to another pool in one step and hands the lifeguard connections over to its
+    // lifeguard; false when the destination refuses
+    bool transferTo(Pool::PoolType destination);
+
     Client(int id, int age, bool isVip, bool hasSwimDiaper = false, bool hasGuardian = false, int guardianId = -1);
 
     ~Client();
@@ -55,7 +81,16 @@ public:
 
     void setAsGuardian(bool value) { isGuardian = value; }
 
-    void run();
+    // Returns once the visitor has left the facility, so a reused worker process can take the next one
+    bool run();
+
+    // Cashier queue id, looked up once per process and inherited by forked children
+    static int cashierQueueId();
+
+    // Pool changes per simulated minute of a visitor in a pool (Config::poolHopping)
+    static void setPoolHopping(double perMinute) { hopsPerMinute = perMinute; }
+
+    static double poolHopping() { return hopsPerMinute; }
 
     int getId() const { return id; }
 
@@ -65,6 +100,8 @@ public:
 
     bool getHasGuardian() const { return hasGuardian; }
 
+    bool getIsGuardian() const { return isGuardian; }
+
     bool getHasSwimDiaper() const { return hasSwimDiaper; }
 
     int getGuardianId() const { return guardianId; }
@@ -0,0 +1,44 @@
+#ifndef SWIMMING_POOL_CLIENT_LAUNCH_H
+#define SWIMMING_POOL_CLIENT_LAUNCH_H
+
+#include "load_generator.h"
+#include <cstdio>
+
+// What ExecSpawner hands a pool_client process. The visitor travels as the only argument,
+// "id,age,flags,childId,childAge"; settings that are the same for every visitor of a run go in the
+// environment, prepared once when the spawner starts.
+namespace ClientLaunch {
+    const int ARGS_SIZE = 64;
+
+    const int FLAG_VIP = 1;
+    const int FLAG_GUARDIAN = 2;
+    const int FLAG_CHILD_SWIM_DIAPER = 4;
+
+    const char *const IPC_OWNER_ENV = "POOL_IPC_OWNER";         // pid whose private IPC keys to use
+    const char *const POOL_HOPPING_ENV = "POOL_POOL_HOPPING";   // Client::setPoolHopping()
+    const char *const CLIENT_CPUS_ENV = "POOL_CLIENT_CPUS";
+    const char *const CLIENT_NICE_ENV = "POOL_CLIENT_NICE";
+    const char *const SHM_PREFAULT_ENV = "POOL_SHM_PREFAULT";   // SegmentPrefault value
+
+    inline void format(const VisitorProfile &profile, char (&args)[ARGS_SIZE]) {
+        int flags = (profile.isVip ? FLAG_VIP : 0) | (profile.isGuardian ? FLAG_GUARDIAN : 0) |
+                    (profile.childHasSwimDiaper ? FLAG_CHILD_SWIM_DIAPER : 0);
+        snprintf(args, sizeof(args), "%d,%d,%d,%d,%d", profile.id, profile.age, flags, profile.childId,
+                 profile.childAge);
+    }
+
+    inline bool parse(const char *args, VisitorProfile &profile) {
+        int flags = 0;
+        int consumed = 0;
+        if (sscanf(args, "%d,%d,%d,%d,%d%n", &profile.id, &profile.age, &flags, &profile.childId, &profile.childAge,
+                   &consumed) != 5 || args[consumed] != '\0') {
+            return false;
+        }
+        profile.isVip = flags & FLAG_VIP;
+        profile.isGuardian = flags & FLAG_GUARDIAN;
+        profile.childHasSwimDiaper = flags & FLAG_CHILD_SWIM_DIAPER;
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,338 @@
+#include "client_spawner.h"
+#include "client.h"
+#include "client_launch.h"
+#include "config.h"
+#include "cpu_placement.h"
+#include "error_handler.h"
+#include "heartbeat.h"
+#include "process_role.h"
+#include "shared_segment.h"
+#include "shutdown_coordinator.h"
+#include "signal_handler.h"
+#include <climits>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_set>
+
+static_assert(sizeof(VisitorProfile) <= PIPE_BUF, "visitor profiles must be written to the pipe atomically");
+
+std::unique_ptr<ClientSpawner> ClientSpawner::create(const std::string &spec, VisitorHandler handler) {
+    size_t colon = spec.find(':');
+    std::string name = spec.substr(0, colon);
+
+    if (name == "fork" && colon == std::string::npos) {
+        return std::make_unique<ForkSpawner>(std::move(handler));
+    }
+    if (name == "exec") {
+        std::string param = colon == std::string::npos ? "" : spec.substr(colon + 1);
+        if (!param.empty() && (param.compare(0, 5, "path=") != 0 || param.size() == 5)) {
+            throw PoolError("Invalid parameter '" + param + "' in " + spec);
+        }
+        std::string path = param.empty() ? ExecSpawner::defaultPath() : param.substr(5);
+        if (access(path.c_str(), X_OK) != 0) {
+            throw PoolError("Cannot run " + path + " for " + spec);
+        }
+        return std::make_unique<ExecSpawner>(std::move(handler), path);
+    }
+    if (name != "zygote") {
+        throw PoolError("Unknown client spawner: " + spec);
+    }
+
+    int minIdle = 4;
+    int maxWorkers = 128;
+    std::string params = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    size_t pos = 0;
+    while (pos < params.size()) {
+        size_t end = params.find(',', pos);
+        std::string param = params.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        pos = end == std::string::npos ? params.size() : end + 1;
+
+        size_t equals = param.find('=');
+        int value = 0;
+        try {
+            value = equals == std::string::npos ? 0 : std::stoi(param.substr(equals + 1));
+        } catch (const std::exception &) {
+        }
+        if (value <= 0) {
+            throw PoolError("Invalid parameter '" + param + "' in " + spec);
+        }
+
+        std::string key = param.substr(0, equals);
+        if (key == "idle") {
+            minIdle = value;
+        } else if (key == "max") {
+            maxWorkers = value;
+        } else {
+            throw PoolError("Unknown parameter '" + key + "' in " + spec);
+        }
+    }
+    if (minIdle > maxWorkers) {
+        throw PoolError("zygote idle workers cannot exceed max in " + spec);
+    }
+
+    return std::make_unique<ZygoteSpawner>(std::move(handler), minIdle, maxWorkers);
+}
+
+SpawnResult ForkSpawner::spawn(const VisitorProfile &profile, pid_t &newProcess) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        SignalHandler::setChildProcess();
+        exit(handler(profile) ? 0 : 1);
+    }
+
+    newProcess = pid > 0 ? pid : 0;
+    return pid > 0 ? SPAWN_STARTED : SPAWN_FAILED;
+}
+
+ExecSpawner::ExecSpawner(VisitorHandler handler, std::string path)
+        : ClientSpawner(std::move(handler)), path(std::move(path)) {
+    // main blocks its managed signals in every thread; the visitor installs its own handlers
+    sigset_t none;
+    sigemptyset(&none);
+    sigset_t defaults = SignalHandler::managedSignals();
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setsigmask(&attributes, &none);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+}
+
+ExecSpawner::~ExecSpawner() {
+    posix_spawnattr_destroy(&attributes);
+}
+
+std::string ExecSpawner::defaultPath() {
+    char self[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (length <= 0) {
+        return "./pool_client";
+    }
+    std::string directory(self, length);
+    return directory.substr(0, directory.rfind('/') + 1) + "pool_client";
+}
+
+pid_t ExecSpawner::start() {
+    const Config *config = Config::getInstance();
+    environment.clear();
+    for (char **variable = environ; *variable; variable++) {
+        if (strncmp(*variable, "POOL_", 5) != 0) {
+            environment.emplace_back(*variable);
+        }
+    }
+    if (IpcKeys::isPrivate()) {
+        environment.push_back(std::string(ClientLaunch::IPC_OWNER_ENV) + "=" + std::to_string(getpid()));
+    }
+    environment.push_back(std::string(ClientLaunch::POOL_HOPPING_ENV) + "=" + std::to_string(Client::poolHopping()));
+    environment.push_back(std::string(ClientLaunch::CLIENT_CPUS_ENV) + "=" + config->clientCpus);
+    environment.push_back(std::string(ClientLaunch::CLIENT_NICE_ENV) + "=" + std::to_string(config->clientNice));
+    environment.push_back(std::string(ClientLaunch::SHM_PREFAULT_ENV) + "=" +
+                          std::to_string(SharedSegment::prefaultSetting()));
+
+    envp.clear();
+    for (auto &variable: environment) {
+        envp.push_back(variable.data());
+    }
+    envp.push_back(nullptr);
+    return 0;
+}
+
+SpawnResult ExecSpawner::spawn(const VisitorProfile &profile, pid_t &newProcess) {
+    char args[ClientLaunch::ARGS_SIZE];
+    ClientLaunch::format(profile, args);
+    char name[] = "pool_client";
+    char *argv[] = {name, args, nullptr};
+
+    pid_t pid = 0;
+    int result = posix_spawn(&pid, path.c_str(), nullptr, &attributes, argv, envp.data());
+    if (result != 0) {
+        errno = result;
+        newProcess = 0;
+        return SPAWN_FAILED;
+    }
+    newProcess = pid;
+    return SPAWN_STARTED;
+}
+
+ZygoteSpawner::ZygoteSpawner(VisitorHandler handler, int minIdle, int maxWorkers)
+        : ClientSpawner(std::move(handler)), minIdle(minIdle), maxWorkers(maxWorkers), dispatchFd(-1),
+          zygotePid(-1) {}
+
+ZygoteSpawner::~ZygoteSpawner() {
+    if (dispatchFd != -1) {
+        close(dispatchFd);
+    }
+}
+
+std::string ZygoteSpawner::describe() const {
+    return "zygote with " + std::to_string(minIdle) + " idle workers (max " + std::to_string(maxWorkers) +
+           ", backlog " + std::to_string(minIdle) + ")";
+}
+
+pid_t ZygoteSpawner::start() {
+    int dispatchPipe[2];
+    checkSystemCall(pipe(dispatchPipe), "Failed to create zygote dispatch pipe");
+
+    // Idle workers all poll the read end, the ones that lose the race must not block in read()
+    fcntl(dispatchPipe[0], F_SETFL, fcntl(dispatchPipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(dispatchPipe[1], F_SETFL, fcntl(dispatchPipe[1], F_GETFL) | O_NONBLOCK);
+
+    zygotePid = fork();
+    if (zygotePid == 0) {
+        close(dispatchPipe[1]);
+        runZygote(dispatchPipe[0]);
+    }
+
+    close(dispatchPipe[0]);
+    if (zygotePid == -1) {
+        close(dispatchPipe[1]);
+        throw PoolSystemError("Failed to fork client zygote");
+    }
+
+    dispatchFd = dispatchPipe[1];
+    return zygotePid;
+}
+
+pid_t ZygoteSpawner::restart() {
+    std::lock_guard<std::mutex> lock(dispatchMutex);
+    // The old zygote's idle workers see the hang-up and exit; busy ones finish their visitor first
+    if (dispatchFd != -1) {
+        close(dispatchFd);
+        dispatchFd = -1;
+    }
+    return start();
+}
+
+SpawnResult ZygoteSpawner::spawn(const VisitorProfile &profile, pid_t &newProcess) {
+    newProcess = 0;
+    std::lock_guard<std::mutex> lock(dispatchMutex);
+    int queuedBytes = 0;
+    if (ioctl(dispatchFd, FIONREAD, &queuedBytes) == 0 &&
+        queuedBytes >= minIdle * static_cast<int>(sizeof(VisitorProfile))) {
+        return SPAWN_DROPPED;
+    }
+    if (write(dispatchFd, &profile, sizeof(profile)) == sizeof(profile)) {
+        return SPAWN_STARTED;
+    }
+    return errno == EAGAIN ? SPAWN_DROPPED : SPAWN_FAILED;
+}
+
+void ZygoteSpawner::runZygote(int dispatchRead) {
+    setProcessName("client_zygote");
+    SignalHandler::setChildProcess();
+    CpuPlacement::apply(ProcessRole::Zygote);
+
+    // Everything a visitor needs from the IPC is looked up once here and inherited by the workers
+    try {
+        Client::cashierQueueId();
+        SharedSegment::get();
+    } catch (const std::exception &e) {
+        std::cerr << "Error in client zygote: " << e.what() << std::endl;
+        exit(1);
+    }
+
+    int statusPipe[2];
+    if (pipe(statusPipe) == -1) {
+        perror("Failed to create zygote status pipe");
+        exit(1);
+    }
+    fcntl(statusPipe[0], F_SETFL, fcntl(statusPipe[0], F_GETFL) | O_NONBLOCK);
+
+    std::unordered_set<pid_t> workers;
+    std::unordered_set<pid_t> busy;
+    pid_t self = getpid();
+    bool dispatchClosed = false;
+
+    Heartbeat::attach(WATCH_ZYGOTE);
+    while (true) {
+        Heartbeat::beat(WATCH_ZYGOTE);
+        bool stopping = dispatchClosed || ShutdownCoordinator::stopRequested();
+        if (stopping && workers.empty()) {
+            exit(0);
+        }
+
+        while (!stopping && static_cast<int>(workers.size() - busy.size()) < minIdle &&
+               static_cast<int>(workers.size()) < maxWorkers) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(statusPipe[0]);
+                runWorker(dispatchRead, statusPipe[1], self);
+            }
+            if (pid == -1) {
+                perror("fork failed in client zygote");
+                break;
+            }
+            workers.insert(pid);
+        }
+
+        // The dispatch pipe is only watched for hang-up, its data belongs to the workers
+        struct pollfd fds[2] = {{statusPipe[0], POLLIN, 0},
+                                {dispatchRead, 0,      0}};
+        if (poll(fds, dispatchClosed ? 1 : 2, 100) > 0) {
+            dispatchClosed = dispatchClosed || (fds[1].revents & POLLHUP);
+
+            WorkerEvent events[64];
+            ssize_t received;
+            while ((received = read(statusPipe[0], events, sizeof(events))) > 0) {
+                for (size_t i = 0; i < received / sizeof(WorkerEvent); i++) {
+                    if (!workers.count(events[i].pid)) {
+                        continue;
+                    }
+                    if (events[i].busy) {
+                        busy.insert(events[i].pid);
+                    } else {
+                        busy.erase(events[i].pid);
+                    }
+                }
+            }
+        }
+
+        pid_t pid;
+        while ((pid = waitpid(-1, nullptr, WNOHANG)) > 0) {
+            workers.erase(pid);
+            busy.erase(pid);
+        }
+    }
+}
+
+void ZygoteSpawner::runWorker(int dispatchRead, int statusWrite, pid_t zygote) {
+#ifndef __APPLE__
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+    if (getppid() != zygote) {
+        exit(0);
+    }
+    setProcessName("client_idle");
+
+    WorkerEvent event = {getpid(), false};
+    while (!ShutdownCoordinator::stopRequested()) {
+        struct pollfd pfd = {dispatchRead, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+
+        VisitorProfile profile{};
+        ssize_t received = read(dispatchRead, &profile, sizeof(profile));
+        if (received == 0) {
+            break;
+        }
+        if (received != sizeof(profile)) {
+            continue;
+        }
+
+        event.busy = true;
+        write(statusWrite, &event, sizeof(event));
+
+        handler(profile);
+
+        event.busy = false;
+        write(statusWrite, &event, sizeof(event));
+        setProcessName("client_idle");
+    }
+
+    exit(0);
+}
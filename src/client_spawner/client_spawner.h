@@ -0,0 +1,125 @@
+#ifndef SWIMMING_POOL_CLIENT_SPAWNER_H
+#define SWIMMING_POOL_CLIENT_SPAWNER_H
+
+#include "load_generator.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <spawn.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Runs one visitor (with its dependent child) to completion in the calling process; in client.cpp,
+// so pool_client links it without the spawners
+bool runVisitor(const VisitorProfile &profile);
+
+using VisitorHandler = std::function<bool(const VisitorProfile &)>;
+
+// What became of a visitor handed to a spawner
+enum SpawnResult {
+    SPAWN_STARTED,
+    SPAWN_DROPPED,      // backpressure: no worker can take the visitor soon; turned away, not an error
+    SPAWN_FAILED,       // errno tells why
+};
+
+class ClientSpawner {
+protected:
+    VisitorHandler handler;
+
+public:
+    explicit ClientSpawner(VisitorHandler handler) : handler(std::move(handler)) {}
+
+    virtual ~ClientSpawner() = default;
+
+    // Starts helper processes, returns the pid to register or 0 when there is none
+    virtual pid_t start() { return 0; }
+
+    // Starts them again after the watchdog killed a stalled one
+    virtual pid_t restart() { return start(); }
+
+    // Hands the visitor to a process. newProcess is set to the pid of a freshly forked process that
+    // has to be registered, or 0 when an already running worker took the visitor.
+    virtual SpawnResult spawn(const VisitorProfile &profile, pid_t &newProcess) = 0;
+
+    virtual std::string describe() const = 0;
+
+    // fork, zygote:idle=4,max=128, exec or exec:path=/path/to/pool_client
+    static std::unique_ptr<ClientSpawner> create(const std::string &spec, VisitorHandler handler = runVisitor);
+};
+
+// One fork() of the calling process per visitor
+class ForkSpawner : public ClientSpawner {
+public:
+    explicit ForkSpawner(VisitorHandler handler) : ClientSpawner(std::move(handler)) {}
+
+    SpawnResult spawn(const VisitorProfile &profile, pid_t &newProcess) override;
+
+    std::string describe() const override { return "fork per visitor"; }
+};
+
+// posix_spawn() of the pool_client executable per visitor, which links only the client, ticket and
+// IPC code, so a visitor does not carry copies of the main process's threads, heap and singletons.
+// The handler is not used: the visitor runs runVisitor() in the new executable.
+class ExecSpawner : public ClientSpawner {
+private:
+    std::string path;
+    std::vector<std::string> environment;
+    std::vector<char *> envp;
+    posix_spawnattr_t attributes;
+
+public:
+    ExecSpawner(VisitorHandler handler, std::string path);
+
+    ~ExecSpawner() override;
+
+    // Prepares the environment shared by all visitors, once the IPC keys and settings are final
+    pid_t start() override;
+
+    SpawnResult spawn(const VisitorProfile &profile, pid_t &newProcess) override;
+
+    std::string describe() const override { return "posix_spawn of " + path; }
+
+    // pool_client next to the running executable
+    static std::string defaultPath();
+};
+
+// A small template process forked early, attached to the IPC, that keeps a pool of idle workers.
+// Visitor profiles go through a shared dispatch pipe; whichever idle worker reads a profile runs the
+// visitor and then waits for the next one. The zygote forks new workers whenever fewer than minIdle
+// are waiting. At most minIdle profiles wait in the pipe: more means every worker is busy, and the
+// visitor is dropped rather than left to wait with a stale arrival time.
+class ZygoteSpawner : public ClientSpawner {
+private:
+    struct WorkerEvent {
+        pid_t pid;
+        bool busy;
+    };
+
+    int minIdle;
+    int maxWorkers;
+    int dispatchFd;
+    pid_t zygotePid;
+    std::mutex dispatchMutex;       // spawn() on the main thread against restart() on the watchdog's
+
+    [[noreturn]] void runZygote(int dispatchRead);
+
+    [[noreturn]] void runWorker(int dispatchRead, int statusWrite, pid_t zygote);
+
+public:
+    ZygoteSpawner(VisitorHandler handler, int minIdle, int maxWorkers);
+
+    // Closing the dispatch pipe makes the idle workers exit
+    ~ZygoteSpawner() override;
+
+    pid_t start() override;
+
+    // Forked from the running main process, unlike the first zygote
+    pid_t restart() override;
+
+    SpawnResult spawn(const VisitorProfile &profile, pid_t &newProcess) override;
+
+    std::string describe() const override;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include "private_facility.h"
+#include "error_handler.h"
+#include "event_log.h"
+#include "latency_histogram.h"
+#include "pool_manager.h"
+#include "shared_segment.h"
+#include "signal_handler.h"
+#include "tracer.h"
+#include <sys/msg.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+
+PrivateFacility::PrivateFacility(const SegmentOptions &segment) {
+    if (!IpcKeys::isPrivate()) {
+        throw PoolError("a private facility needs private IPC keys");
+    }
+
+    semId = semget(IpcKeys::key(SEM_KEY), SEM_COUNT, IPC_CREAT | IPC_EXCL | 0666);
+    checkSystemCall(semId, "semget failed for a private facility");
+    unsigned short values[SEM_COUNT];
+    for (auto &value: values) {
+        value = 1;
+    }
+    union semun {
+        int val;
+        struct semid_ds *buf;
+        unsigned short *array;
+    } arg{};
+    arg.array = values;
+    checkSystemCall(semctl(semId, 0, SETALL, arg), "semctl SETALL failed for a private facility");
+
+    shm = SharedSegment::create(segment);
+    shm->workingHours[0] = 0;
+    shm->workingHours[1] = 24;
+
+    msgId = msgget(IpcKeys::key(CASHIER_MSG_KEY), IPC_CREAT | IPC_EXCL | 0666);
+    checkSystemCall(msgId, "msgget failed for a private facility");
+
+    EventLog::createSegment();
+    Tracer::createSegment();
+    LatencyHistograms::createSegment();
+    PoolManager::getInstance()->initialize();
+}
+
+PrivateFacility::~PrivateFacility() {
+    SharedSegment::detach(shm, SharedSegment::mappedBytes());
+    SignalHandler::cleanupIPC();
+}
@@ -0,0 +1,29 @@
+#ifndef SWIMMING_POOL_PRIVATE_FACILITY_H
+#define SWIMMING_POOL_PRIVATE_FACILITY_H
+
+#include "shared_segment.h"
+
+// The IPC objects initializeIPC() creates for a simulation, under this process's private keys and
+// open around the clock, for tools that drive pools, the cashier and lifeguards in-process without
+// disturbing a simulation running at the same time. Everything is removed again on destruction.
+class PrivateFacility {
+private:
+    int semId;
+    int msgId;
+
+public:
+    SharedMemory *shm;
+
+    // Needs IpcKeys::usePrivate() first
+    explicit PrivateFacility(const SegmentOptions &segment = SegmentOptions());
+
+    ~PrivateFacility();
+
+    int queueId() const { return msgId; }
+
+    PrivateFacility(const PrivateFacility &) = delete;
+
+    PrivateFacility &operator=(const PrivateFacility &) = delete;
+};
+
+#endif
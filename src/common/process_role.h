@@ -0,0 +1,52 @@
+#ifndef SWIMMING_POOL_PROCESS_ROLE_H
+#define SWIMMING_POOL_PROCESS_ROLE_H
+
+#ifdef __APPLE__
+
+#include <pthread.h>
+
+#else
+#include <sys/prctl.h>
+#endif
+
+enum class ProcessRole {
+    Main = 0,
+    Lifeguard = 1,
+    Cashier = 2,
+    Client = 3,
+    Monitor = 4,
+    Zygote = 5,
+    LogDrain = 6,
+    Count = 7
+};
+
+inline const char *processRoleName(ProcessRole role) {
+    switch (role) {
+        case ProcessRole::Main:
+            return "main";
+        case ProcessRole::Lifeguard:
+            return "lifeguard";
+        case ProcessRole::Cashier:
+            return "cashier";
+        case ProcessRole::Client:
+            return "client";
+        case ProcessRole::Monitor:
+            return "monitor";
+        case ProcessRole::Zygote:
+            return "zygote";
+        case ProcessRole::LogDrain:
+            return "log_drain";
+        default:
+            return "unknown";
+    }
+}
+
+inline void setProcessName(const char *name) {
+#ifdef __APPLE__
+    pthread_setname_np(name);
+#else
+    prctl(PR_SET_NAME, name);
+#endif
+}
+
+#endif
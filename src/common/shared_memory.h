@@ -7,27 +7,71 @@
 #include <sys/sem.h>
 #include <sys/msg.h>
 #include <climits>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "process_role.h"
 
 class Client;
 
-struct ClientData {
-    int id;
-    int age;
-    bool isVip;
-    bool hasSwimDiaper;
-    bool hasGuardian;
-    int guardianId;
+enum ClientFlags : uint8_t {
+    CLIENT_VIP = 1,
+    CLIENT_SWIM_DIAPER = 2,
+    CLIENT_HAS_GUARDIAN = 4,
+    CLIENT_CHILD_SWIM_DIAPER = 8    // only in AdmissionBatch, for the child a guardian brings along
 };
 
+// The clients in a pool as a structure of arrays, so a scan over one field (the age sum, a
+// guardian lookup, the VIP count) touches only that field's cache lines; see RosterScan
 struct PoolState {
-    ClientData clients[100];
+    static constexpr int MAX_CLIENTS = 100;
+    alignas(64) int32_t ids[MAX_CLIENTS];
+    alignas(64) int32_t ages[MAX_CLIENTS];
+    alignas(64) int32_t guardianIds[MAX_CLIENTS];
+    alignas(64) uint8_t flags[MAX_CLIENTS];
+    alignas(64) int32_t ownerPids[MAX_CLIENTS];     // holder of the lease on the place, 0 for none
     int currentCount;
     bool isClosed;
     bool isUnderMaintenance;
+
+    void add(int32_t id, int32_t age, uint8_t clientFlags, int32_t guardianId, int32_t ownerPid = 0) {
+        int index = currentCount++;
+        ids[index] = id;
+        ages[index] = age;
+        flags[index] = clientFlags;
+        guardianIds[index] = guardianId;
+        ownerPids[index] = ownerPid;
+    }
+
+    // Moves the last client into the gap
+    void removeAt(int index) {
+        int last = --currentCount;
+        ids[index] = ids[last];
+        ages[index] = ages[last];
+        flags[index] = flags[last];
+        guardianIds[index] = guardianIds[last];
+        ownerPids[index] = ownerPids[last];
+    }
+};
+
+enum QueuePolicy : int32_t {
+    QUEUE_STRICT_PRIORITY,  // VIPs before everyone else, first come first served within a class
+    QUEUE_AGING,            // a regular visitor's priority grows with the wait, VIPs start vipBonusS ahead
+    QUEUE_WEIGHTED_FAIR,    // VIPs get vipShare of the tickets while both classes wait
+    QUEUE_POLICY_COUNT
+};
+
+enum QueueClass {
+    QUEUE_CLASS_REGULAR,
+    QUEUE_CLASS_VIP,
+    QUEUE_CLASS_COUNT
 };
 
+// The entrance queue as a binary min-heap on priorityKey (ties by arrival order): queue[0] is always
+// the next visitor to be served, the rest of queue[] is in no particular order. The policy only
+// decides the key at insert time, so insert and removeFront stay O(log n) for every policy.
 struct EntranceQueue {
-    static const int MAX_QUEUE_SIZE = 100;
+    static constexpr int MAX_QUEUE_SIZE = 100;
     struct QueueEntry {
         int clientId;
         bool isVip;
@@ -35,9 +79,197 @@ struct EntranceQueue {
         int age;
         int hasGuardian;
         int hasSwimDiaper;
+        int childAge;           // 0 when the visitor brings no child
+        int childHasSwimDiaper;
+        double priorityKey;     // smaller is served first
+        uint32_t sequence;
     };
     QueueEntry queue[MAX_QUEUE_SIZE];
     int queueSize;
+    int lastTicketNumber;   // here rather than in the cashier, so a restarted cashier goes on counting
+
+    // Zero-initialised shared memory is strict priority; set up by QueueSettings::apply
+    QueuePolicy policy;
+    double vipBonusS;
+    double vipShare;
+    double waitSloS[QUEUE_CLASS_COUNT];     // waits above these count as SLO misses, 0 for none
+    double virtualTime;                     // QUEUE_WEIGHTED_FAIR: finish tag of the last visitor served
+    double lastFinish[QUEUE_CLASS_COUNT];   // QUEUE_WEIGHTED_FAIR: finish tag of the last visitor of each class
+    uint32_t nextSequence;
+
+    static int classOf(const QueueEntry &entry) {
+        return entry.isVip ? QUEUE_CLASS_VIP : QUEUE_CLASS_REGULAR;
+    }
+
+    // Shared by the cashier and pool_sim. Returns the number of visitors already waiting, or -1 when
+    // the queue is full.
+    int insert(const QueueEntry &entry) {
+        if (queueSize >= MAX_QUEUE_SIZE - 1) {
+            return -1;
+        }
+
+        QueueEntry added = entry;
+        added.sequence = nextSequence++;
+        int queueClass = classOf(entry);
+        switch (policy) {
+            case QUEUE_AGING:
+                // Serving the highest (now - arrival + bonus) first is serving the lowest (arrival - bonus)
+                added.priorityKey = static_cast<double>(entry.arrivalTime) - (entry.isVip ? vipBonusS : 0);
+                break;
+            case QUEUE_WEIGHTED_FAIR: {
+                double weight = entry.isVip ? vipShare : 1 - vipShare;
+                double start = virtualTime > lastFinish[queueClass] ? virtualTime : lastFinish[queueClass];
+                added.priorityKey = lastFinish[queueClass] = start + 1 / weight;
+                break;
+            }
+            default:
+                added.priorityKey = entry.isVip ? 0 : 1;
+                break;
+        }
+
+        int waiting = queueSize;
+        int position = queueSize++;
+        while (position > 0 && before(added, queue[(position - 1) / 2])) {
+            queue[position] = queue[(position - 1) / 2];
+            position = (position - 1) / 2;
+        }
+        queue[position] = added;
+        return waiting;
+    }
+
+    void removeFront() {
+        if (queueSize <= 0) {
+            return;
+        }
+        virtualTime = queue[0].priorityKey;
+
+        QueueEntry last = queue[--queueSize];
+        int position = 0;
+        while (true) {
+            int child = 2 * position + 1;
+            if (child >= queueSize) {
+                break;
+            }
+            if (child + 1 < queueSize && before(queue[child + 1], queue[child])) {
+                child++;
+            }
+            if (!before(queue[child], last)) {
+                break;
+            }
+            queue[position] = queue[child];
+            position = child;
+        }
+        queue[position] = last;
+    }
+
+    static bool before(const QueueEntry &a, const QueueEntry &b) {
+        return a.priorityKey < b.priorityKey || (a.priorityKey == b.priorityKey && a.sequence < b.sequence);
+    }
+};
+
+enum Semaphores {
+    SEM_OLYMPIC = 0,
+    SEM_RECREATIONAL = 1,
+    SEM_KIDS = 2,
+    SEM_ENTRANCE_QUEUE = 3,
+    SEM_INIT = 4,
+    SEM_COUNT = 5
+};
+
+const int POOL_COUNT = 3;
+
+enum RefusalReason {
+    REFUSAL_NO_SWIM_DIAPER = 0,
+    REFUSAL_POOL_CLOSED = 1,
+    REFUSAL_POOL_FULL = 2,
+    REFUSAL_NO_CHILD_IN_KIDS_POOL = 3,
+    REFUSAL_AVERAGE_AGE = 4,
+    REFUSAL_AGE_LIMIT = 5,
+    REFUSAL_NO_GUARDIAN = 6,
+    REFUSAL_REASON_COUNT = 7
+};
+
+// Updated with relaxed atomic increments only, so readers never need a lock
+struct MetricsRegistry {
+    std::atomic<uint64_t> admissions[POOL_COUNT];
+    std::atomic<uint64_t> refusals[POOL_COUNT][REFUSAL_REASON_COUNT];
+    std::atomic<uint64_t> evacuations[POOL_COUNT];
+    std::atomic<uint64_t> ticketsIssued;
+    std::atomic<uint64_t> ticketsRefused;
+    std::atomic<uint64_t> visitorsDropped;      // arrivals the client spawner had no worker for
+    std::atomic<int64_t> queueDepth;
+    std::atomic<uint64_t> queueServed[QUEUE_CLASS_COUNT];
+    std::atomic<uint64_t> queueWaitS[QUEUE_CLASS_COUNT];
+    std::atomic<uint64_t> queueSloMissed[QUEUE_CLASS_COUNT];
+    std::atomic<uint64_t> lockAcquisitions[SEM_COUNT];
+    std::atomic<uint64_t> lockWaitNs[SEM_COUNT];
+    std::atomic<uint64_t> leaseReclaims[POOL_COUNT];
+};
+
+// Log2 buckets of nanoseconds: bucket b counts durations in [2^b, 2^(b+1)), bucket 0 also takes 0 and 1
+struct LockHistogram {
+    static constexpr int BUCKETS = 40;
+
+    std::atomic<uint64_t> counts[BUCKETS];
+    std::atomic<uint64_t> sumNs;
+};
+
+const int ROLE_COUNT = static_cast<int>(ProcessRole::Count);
+
+// Contention of one semaphore of the set, written by LockStats
+struct LockCounters {
+    std::atomic<uint64_t> acquisitions;
+    std::atomic<uint64_t> contended;            // the semaphore was taken when asked for
+    LockHistogram wait;
+    LockHistogram hold;
+    std::atomic<uint64_t> acquisitionsByRole[ROLE_COUNT];
+    std::atomic<uint64_t> holdNsByRole[ROLE_COUNT];
+    std::atomic<int32_t> holderPid;             // 0 while free
+    std::atomic<int32_t> holderRole;
+};
+
+// A process holding places in the pools renews heartbeatNs (Metrics::nowNs) while it lives; see Leases
+struct ClientLease {
+    std::atomic<int32_t> pid;                   // 0 for a free slot
+    std::atomic<uint64_t> heartbeatNs;
+};
+
+struct LeaseTable {
+    static constexpr int SLOT_COUNT = 512;
+
+    ClientLease slots[SLOT_COUNT];
+};
+
+// Long-lived roles whose stalls the Watchdog detects and repairs
+enum WatchedRole {
+    WATCH_CASHIER,
+    WATCH_LIFEGUARD_OLYMPIC,
+    WATCH_LIFEGUARD_RECREATIONAL,
+    WATCH_LIFEGUARD_KIDS,
+    WATCH_ZYGOTE,
+    WATCH_COUNT
+};
+
+// Written by the watched process with Heartbeat::beat (Metrics::nowNs), read by the watchdog
+struct RoleHeartbeat {
+    std::atomic<int32_t> pid;                   // 0 until the role first beats
+    std::atomic<uint64_t> beats;
+    std::atomic<uint64_t> lastBeatNs;
+};
+
+struct ShutdownState {
+    std::atomic<uint32_t> stopRequested;
+};
+
+// Simulated time = epochNs + (CLOCK_MONOTONIC - startMonotonicNs) * speed, see SimClock
+struct ClockState {
+    std::atomic<int64_t> epochNs;
+    std::atomic<int64_t> startMonotonicNs;
+    std::atomic<double> speed;
+};
+
+struct TraceState {
+    std::atomic<uint32_t> enabled;
 };
 
 struct SharedMemory {
@@ -47,6 +279,13 @@ struct SharedMemory {
     PoolState kids;
     EntranceQueue entranceQueue;
     int workingHours[2];  // Tp, Tk
+    MetricsRegistry metrics;
+    LockCounters locks[SEM_COUNT];
+    LeaseTable leases;
+    RoleHeartbeat heartbeats[WATCH_COUNT];
+    ShutdownState shutdown;
+    TraceState trace;
+    ClockState clock;
 };
 
 struct TicketMessage {
@@ -57,6 +296,7 @@ struct TicketMessage {
     time_t issueTime;
     bool isVip;
     bool isChild;
+    int suggestedPool;      // PoolIndex from AdmissionBatch at issue time, -1 when none would admit
 };
 
 const int LIFEGUARD_ACTION_EVAC = 41080;
@@ -71,6 +311,15 @@ struct LifeguardMessage {
     int poolId;
 };
 
+const int LIFEGUARD_REQUEST_HANDOFF = 41090;
+
+// Sent by a visitor on its lifeguard connection: HANDOFF passes the connection on to the lifeguard of
+// poolId after a transfer, so the visitor does not connect again
+struct LifeguardRequest {
+    int action;
+    int poolId;
+};
+
 const long CLIENT_REQUEST_VIP_M_TYPE = 31080;
 const long CLIENT_REQUEST_REGULAR_M_TYPE = 31081;
 
@@ -81,20 +330,35 @@ struct ClientRequest {
     bool hasGuardian;
     bool hasSwimDiaper;
     bool isVip;
+    int childAge;
+    bool childHasSwimDiaper;
 };
 
 const key_t SHM_KEY = 6969;
 const key_t SEM_KEY = 7000;
 const key_t CASHIER_MSG_KEY = ftok("./ipc_key.txt", 'C');
 
+// Every IPC key and pool socket path goes through IpcKeys. A tool that must never touch a running
+// simulation (pool_bench) moves them all by a per-process offset with usePrivate() before creating
+// anything; forked children inherit the choice.
+class IpcKeys {
+private:
+    static key_t offset;
 
-enum Semaphores {
-    SEM_OLYMPIC = 0,
-    SEM_RECREATIONAL = 1,
-    SEM_KIDS = 2,
-    SEM_ENTRANCE_QUEUE = 3,
-    SEM_INIT = 4,
-    SEM_COUNT = 5
+public:
+    static key_t key(key_t base) { return base + offset; }
+
+    // Keys private to the owner process, by default the calling one; pool_loadtest passes the pid of
+    // the swimming_pool it started with --private-ipc on to reach that simulation's objects
+    static void usePrivate(pid_t owner = 0);
+
+    static bool isPrivate() { return offset != 0; }
+
+    static std::string socketPath(int pool);
+
+    // Datagram socket on which a pool's lifeguard takes over connections of transferred visitors
+    static std::string handoffPath(int pool);
 };
 
+
 #endif
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "shared_segment.h"
+#include "error_handler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <pthread.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SharedMemory *SharedSegment::cached = nullptr;
+size_t SharedSegment::cachedBytes = 0;
+SegmentBackend SharedSegment::createdBackend = SEGMENT_SYSV;
+SegmentPrefault SharedSegment::prefaultMode = PREFAULT_OFF;
+key_t IpcKeys::offset = 0;
+
+namespace {
+    const char *const BACKEND_NAMES[SEGMENT_BACKEND_COUNT] = {"sysv", "posix", "hugetlb"};
+    const char *const PREFAULT_NAMES[PREFAULT_COUNT] = {"off", "populate", "lock"};
+    const size_t DEFAULT_HUGE_PAGE = 2 * 1024 * 1024;
+
+    size_t hugePageSize() {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string line;
+        while (std::getline(meminfo, line)) {
+            size_t kb = 0;
+            if (sscanf(line.c_str(), "Hugepagesize: %zu kB", &kb) == 1) {
+                return kb * 1024;
+            }
+        }
+        return DEFAULT_HUGE_PAGE;
+    }
+
+    size_t roundUp(size_t bytes, size_t unit) {
+        return (bytes + unit - 1) / unit * unit;
+    }
+
+    void removeSysV() {
+        int shmId = shmget(IpcKeys::key(SHM_KEY), 0, 0666);
+        if (shmId >= 0) {
+            shmctl(shmId, IPC_RMID, nullptr);
+        }
+    }
+
+    void *createSysV(size_t bytes, int flags) {
+        int shmId = shmget(IpcKeys::key(SHM_KEY), bytes, IPC_CREAT | flags | 0666);
+        if (shmId < 0 && errno == EINVAL) {
+            // Left over by a run with a smaller or differently backed segment
+            removeSysV();
+            shmId = shmget(IpcKeys::key(SHM_KEY), bytes, IPC_CREAT | flags | 0666);
+        }
+        if (shmId < 0) {
+            return MAP_FAILED;
+        }
+        void *shm = shmat(shmId, nullptr, 0);
+        return shm == (void *) -1 ? MAP_FAILED : shm;
+    }
+}
+
+void IpcKeys::usePrivate(pid_t owner) {
+    offset = 0x10000000 + (((owner ? owner : getpid()) & 0xffff) << 12);
+}
+
+std::string IpcKeys::socketPath(int pool) {
+    if (offset == 0) {
+        return "/tmp/pool_" + std::to_string(pool) + ".sock";
+    }
+    return "/tmp/pool_" + std::to_string(offset) + "_" + std::to_string(pool) + ".sock";
+}
+
+std::string IpcKeys::handoffPath(int pool) {
+    std::string path = socketPath(pool);
+    return path.substr(0, path.size() - 5) + ".handoff.sock";
+}
+
+SegmentOptions SegmentOptions::parse(const std::string &backend, const std::string &prefault,
+                                     const std::string &size) {
+    SegmentOptions options;
+    auto backendName = std::find(BACKEND_NAMES, BACKEND_NAMES + SEGMENT_BACKEND_COUNT, backend);
+    auto prefaultName = std::find(PREFAULT_NAMES, PREFAULT_NAMES + PREFAULT_COUNT, prefault);
+    if (backendName == BACKEND_NAMES + SEGMENT_BACKEND_COUNT) {
+        throw PoolError("Unknown shared memory backend: " + backend);
+    }
+    if (prefaultName == PREFAULT_NAMES + PREFAULT_COUNT) {
+        throw PoolError("Unknown prefault mode: " + prefault);
+    }
+    options.backend = static_cast<SegmentBackend>(backendName - BACKEND_NAMES);
+    options.prefault = static_cast<SegmentPrefault>(prefaultName - PREFAULT_NAMES);
+
+    if (!size.empty()) {
+        char *end = nullptr;
+        unsigned long long value = strtoull(size.c_str(), &end, 10);
+        std::string suffix = end ? end : "";
+        if (end == size.c_str() || (suffix != "" && suffix != "k" && suffix != "m")) {
+            throw PoolError("Invalid shared memory size: " + size);
+        }
+        options.sizeBytes = value << (suffix == "k" ? 10 : suffix == "m" ? 20 : 0);
+        if (options.sizeBytes < sizeof(SharedMemory)) {
+            throw PoolError("Shared memory size " + size + " is below the " + std::to_string(sizeof(SharedMemory)) +
+                            " bytes of the shared state");
+        }
+    }
+    return options;
+}
+
+std::string SegmentOptions::describe() const {
+    std::ostringstream out;
+    out << BACKEND_NAMES[backend] << ", prefault " << PREFAULT_NAMES[prefault];
+    return out.str();
+}
+
+std::string SharedSegment::posixName() {
+    return "/swimming_pool_" + std::to_string(IpcKeys::key(SHM_KEY));
+}
+
+SharedMemory *SharedSegment::map(bool readOnly, size_t &bytes) {
+    int fd = shm_open(posixName().c_str(), readOnly ? O_RDONLY : O_RDWR, 0666);
+    if (fd >= 0) {
+        struct stat status{};
+        void *shm = MAP_FAILED;
+        if (fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(SharedMemory)) {
+            bytes = static_cast<size_t>(status.st_size);
+            shm = mmap(nullptr, bytes, readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        return shm == MAP_FAILED ? nullptr : static_cast<SharedMemory *>(shm);
+    }
+
+    int shmId = shmget(IpcKeys::key(SHM_KEY), 0, 0666);
+    struct shmid_ds status{};
+    if (shmId < 0 || shmctl(shmId, IPC_STAT, &status) == -1) {
+        return nullptr;
+    }
+    void *shm = shmat(shmId, nullptr, readOnly ? SHM_RDONLY : 0);
+    if (shm == (void *) -1) {
+        return nullptr;
+    }
+    bytes = status.shm_segsz;
+    return static_cast<SharedMemory *>(shm);
+}
+
+SharedMemory *SharedSegment::attach() {
+    size_t bytes = 0;
+    SharedMemory *shm = map(false, bytes);
+    if (!shm) {
+        return nullptr;
+    }
+
+    cached = shm;
+    cachedBytes = bytes;
+    prefault();
+    return cached;
+}
+
+SharedMemory *SharedSegment::create(const SegmentOptions &options) {
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t bytes = std::max(options.sizeBytes, sizeof(SharedMemory));
+    void *shm = MAP_FAILED;
+    SegmentBackend backend = options.backend;
+
+    if (options.backend == SEGMENT_POSIX) {
+        removeSysV();
+        bytes = roundUp(bytes, pageSize);
+        int fd = shm_open(posixName().c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+        checkSystemCall(fd, "shm_open failed for the shared memory segment");
+        if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+            shm = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | (options.prefault != PREFAULT_OFF ? MAP_POPULATE : 0), fd, 0);
+        }
+        close(fd);
+    } else {
+        shm_unlink(posixName().c_str());
+        if (options.backend == SEGMENT_HUGETLB) {
+            size_t hugeBytes = roundUp(bytes, hugePageSize());
+            shm = createSysV(hugeBytes, SHM_HUGETLB);
+            if (shm == MAP_FAILED) {
+                std::cerr << "SHM_HUGETLB segment of " << hugeBytes << " bytes failed (" << strerror(errno)
+                          << "), using normal pages; see /proc/sys/vm/nr_hugepages" << std::endl;
+            } else {
+                bytes = hugeBytes;
+            }
+        }
+        if (shm == MAP_FAILED) {
+            backend = SEGMENT_SYSV;
+            bytes = roundUp(bytes, pageSize);
+            shm = createSysV(bytes, 0);
+        }
+    }
+    if (shm == MAP_FAILED) {
+        throw PoolSystemError("Failed to create the shared memory segment");
+    }
+
+    cached = static_cast<SharedMemory *>(shm);
+    cachedBytes = bytes;
+    createdBackend = backend;
+    prefaultMode = options.prefault;
+    if (prefaultMode != PREFAULT_OFF) {
+        static bool forkHandlerInstalled = false;
+        if (!forkHandlerInstalled) {
+            forkHandlerInstalled = true;
+            pthread_atfork(nullptr, nullptr, &SharedSegment::prefault);
+        }
+        prefault();
+    }
+    return cached;
+}
+
+SharedMemory *SharedSegment::attachReadOnly(size_t &bytes) {
+    return map(true, bytes);
+}
+
+void SharedSegment::detach(SharedMemory *shm, size_t bytes) {
+    if (!shm) {
+        return;
+    }
+    if (shm == cached) {
+        cached = nullptr;
+        cachedBytes = 0;
+    }
+    // shmdt refuses anything shmat did not return, which leaves an mmap of the POSIX object
+    if (shmdt(shm) == -1) {
+        munmap(shm, bytes);
+    }
+}
+
+bool SharedSegment::exists() {
+    int fd = shm_open(posixName().c_str(), O_RDONLY, 0);
+    if (fd >= 0) {
+        close(fd);
+        return true;
+    }
+    return shmget(IpcKeys::key(SHM_KEY), 0, 0666) >= 0;
+}
+
+void SharedSegment::remove() {
+    shm_unlink(posixName().c_str());
+    removeSysV();
+}
+
+void SharedSegment::prefault() {
+    if (!cached || prefaultMode == PREFAULT_OFF) {
+        return;
+    }
+
+    auto *bytes = reinterpret_cast<volatile char *>(cached);
+    bool populated = false;
+#ifdef MADV_POPULATE_WRITE
+    populated = madvise(const_cast<char *>(bytes), cachedBytes, MADV_POPULATE_WRITE) == 0;
+#endif
+    if (!populated) {
+        // A read fault maps a shared page writable, so touching never writes to the shared state
+        size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        for (size_t offset = 0; offset < cachedBytes; offset += pageSize) {
+            (void) bytes[offset];
+        }
+    }
+
+    if (prefaultMode == PREFAULT_LOCK && mlock(const_cast<char *>(bytes), cachedBytes) == -1) {
+        static bool warned = false;
+        if (!warned) {
+            warned = true;
+            std::cerr << "mlock of the shared memory segment failed: " << strerror(errno) << std::endl;
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef SWIMMING_POOL_SHARED_SEGMENT_H
+#define SWIMMING_POOL_SHARED_SEGMENT_H
+
+#include "shared_memory.h"
+#include <cstddef>
+#include <string>
+
+enum SegmentBackend {
+    SEGMENT_SYSV,       // shmget/shmat
+    SEGMENT_POSIX,      // shm_open/mmap
+    SEGMENT_HUGETLB,    // shmget with SHM_HUGETLB, SysV when no huge pages are reserved
+    SEGMENT_BACKEND_COUNT
+};
+
+enum SegmentPrefault {
+    PREFAULT_OFF,       // pages are faulted in by whichever access comes first
+    PREFAULT_POPULATE,  // every process maps all pages when it starts (MAP_POPULATE for the creator)
+    PREFAULT_LOCK,      // as populate, and mlock()ed so they are never paged out
+    PREFAULT_COUNT
+};
+
+// How the main segment is created, from the --shm-* options
+struct SegmentOptions {
+    SegmentBackend backend = SEGMENT_SYSV;
+    SegmentPrefault prefault = PREFAULT_OFF;
+    size_t sizeBytes = 0;       // 0 for sizeof(SharedMemory); rounded up to whole (huge) pages
+
+    // backend sysv|posix|hugetlb, prefault off|populate|lock, size in bytes with an optional k/m suffix
+    // (empty for the default); throws PoolError
+    static SegmentOptions parse(const std::string &backend, const std::string &prefault, const std::string &size);
+
+    std::string describe() const;
+};
+
+// Per-process attachment to the main shared memory segment. The mapping is created once and
+// inherited by forked children, so hot paths can read shared state without shmget/shmat calls.
+// Attaching looks for the POSIX object first and the SysV segment second, so readers need not know
+// which backend the simulation was started with.
+class SharedSegment {
+private:
+    static SharedMemory *cached;
+    static size_t cachedBytes;
+    static SegmentBackend createdBackend;
+    static SegmentPrefault prefaultMode;
+
+    static SharedMemory *attach();
+
+    // nullptr when neither object exists
+    static SharedMemory *map(bool readOnly, size_t &bytes);
+
+public:
+    static SharedMemory *get() {
+        return cached ? cached : attach();
+    }
+
+    // Replaces a stale segment under the same key; main and PrivateFacility. Throws PoolSystemError.
+    static SharedMemory *create(const SegmentOptions &options);
+
+    // A separate read-only mapping, for tools that look at more than one simulation
+    static SharedMemory *attachReadOnly(size_t &bytes);
+
+    static void detach(SharedMemory *shm, size_t bytes);
+
+    static bool exists();
+
+    // Removes the segment; mappings stay valid until their processes detach or exit
+    static void remove();
+
+    // Maps every page into this process, and locks them with PREFAULT_LOCK. Shared mappings keep
+    // neither page tables nor locks across fork(), so children of the creator call it on their own.
+    static void prefault();
+
+    static size_t mappedBytes() { return cachedBytes; }
+
+    // The backend create() ended up with: SEGMENT_SYSV when SEGMENT_HUGETLB fell back to normal pages
+    static SegmentBackend backend() { return createdBackend; }
+
+    // For processes that attach instead of inheriting the creator's mapping (pool_client): the mode
+    // applies from the next attach on
+    static void setPrefault(SegmentPrefault mode) { prefaultMode = mode; }
+
+    static SegmentPrefault prefaultSetting() { return prefaultMode; }
+
+    static std::string posixName();
+};
+
+#endif
@@ -1,91 +1,83 @@
 #include "signal_handler.h"
 #include "shared_memory.h"
+#include "shared_segment.h"
+#include "latency_histogram.h"
 #include <iostream>
-#include <utility>
 #include <sys/msg.h>
 #include <sys/shm.h>
 #include <sys/sem.h>
 #include <unistd.h>
-#include <sys/wait.h>
 
-std::vector<pid_t> *SignalHandler::processes = nullptr;
+ShutdownCoordinator *SignalHandler::coordinator = nullptr;
 std::atomic<bool> *SignalHandler::shouldRun = nullptr;
-bool SignalHandler::isMainProcess = true;
-std::function<void()> SignalHandler::childCleanupHandler = []() {};
+LogDrain *SignalHandler::logDrain = nullptr;
 
-void SignalHandler::initialize(std::vector<pid_t> *procs, std::atomic<bool> *run) {
-    processes = procs;
+void SignalHandler::initialize(ShutdownCoordinator *shutdownCoordinator, std::atomic<bool> *run, LogDrain *drain) {
+    coordinator = shutdownCoordinator;
     shouldRun = run;
+    logDrain = drain;
 }
 
-void SignalHandler::setChildProcess() {
-    isMainProcess = false;
-}
-
-void SignalHandler::setChildCleanupHandler(std::function<void()> handler) {
-    childCleanupHandler = std::move(handler);
+sigset_t SignalHandler::managedSignals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGQUIT);
+    sigaddset(&signals, SIGCHLD);
+    return signals;
 }
 
 void SignalHandler::cleanupIPC() {
-    int cashierMsgId = msgget(CASHIER_MSG_KEY, 0666);
+    int cashierMsgId = msgget(IpcKeys::key(CASHIER_MSG_KEY), 0666);
     if (cashierMsgId >= 0) {
         msgctl(cashierMsgId, IPC_RMID, nullptr);
     }
 
-    int semId = semget(SEM_KEY, SEM_COUNT, 0666);
+    int semId = semget(IpcKeys::key(SEM_KEY), SEM_COUNT, 0666);
     if (semId >= 0) {
         semctl(semId, 0, IPC_RMID);
     }
 
-    int shmId = shmget(SHM_KEY, sizeof(SharedMemory), 0666);
-    if (shmId >= 0) {
-        shmctl(shmId, IPC_RMID, nullptr);
-    }
+    SharedSegment::remove();
+
+    EventLog::removeSegment();
+    Tracer::removeSegment();
+    LatencyHistograms::removeSegment();
 }
 
-void SignalHandler::handleSignal(int signal) {
-    if (isMainProcess) {
-        if (shouldRun) shouldRun->store(false);
-
-        if (processes) {
-            for (pid_t pid: *processes) {
-                if (pid > 0) {
-                    kill(pid, SIGTERM);
-                }
-            }
-
-            for (pid_t pid: *processes) {
-                if (pid > 0) {
-                    int status;
-                    waitpid(pid, &status, 0);
-                }
-            }
-        }
-
-        cleanupIPC();
-        exit(0);
-    } else {
-        childCleanupHandler();
-        exit(0);
+void SignalHandler::shutdown(int) {
+    if (shouldRun) shouldRun->store(false);
+
+    if (coordinator) {
+        coordinator->run(std::cout);
     }
-}
 
-void SignalHandler::handleChildProcess(int) {
-    int status;
-    pid_t pid;
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        if (processes) {
-            auto it = std::find(processes->begin(), processes->end(), pid);
-            if (it != processes->end()) {
-                processes->erase(it);
-            }
-        }
+    // Whatever the children logged after the drain process stopped
+    if (logDrain) {
+        logDrain->drainOnce(true);
+        logDrain->finishTrace();
     }
+
+    cleanupIPC();
+    exit(0);
 }
 
+void SignalHandler::handleChildSignal(int) {
+    _exit(0);
+}
+
+// The main process blocks these signals in every thread and consumes them on the ProcessReaper thread
 void SignalHandler::setupSignalHandling() {
+    sigset_t signals = managedSignals();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    signal(SIGPIPE, SIG_IGN);
+}
+
+void SignalHandler::setChildProcess() {
     struct sigaction sa{};
-    sa.sa_handler = handleSignal;
+    sa.sa_handler = handleChildSignal;
     sigemptyset(&sa.sa_mask);
     sa.sa_flags = 0;
 
@@ -94,10 +86,10 @@ void SignalHandler::setupSignalHandling() {
     sigaction(SIGQUIT, &sa, nullptr);
 
     struct sigaction sa_chld{};
-    sa_chld.sa_handler = handleChildProcess;
+    sa_chld.sa_handler = SIG_DFL;
     sigemptyset(&sa_chld.sa_mask);
-    sa_chld.sa_flags = SA_RESTART | SA_NOCLDSTOP;
     sigaction(SIGCHLD, &sa_chld, nullptr);
 
-    signal(SIGPIPE, SIG_IGN);
-}
\ No newline at end of file
+    sigset_t signals = managedSignals();
+    pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+}
@@ -2,31 +2,32 @@
 #ifndef SWIMMING_POOL_SIGNAL_HANDLER_H
 #define SWIMMING_POOL_SIGNAL_HANDLER_H
 
-#include <vector>
 #include <atomic>
 #include <csignal>
-#include <functional>
+#include "shutdown_coordinator.h"
+#include "log_drain.h"
 
 class SignalHandler {
 private:
-    static std::vector<pid_t> *processes;
+    static ShutdownCoordinator *coordinator;
     static std::atomic<bool> *shouldRun;
-    static bool isMainProcess;
-    static std::function<void()> childCleanupHandler;
+    static LogDrain *logDrain;
 
-    static void cleanupIPC();
-    static void handleChildProcess(int signal);
+    static void handleChildSignal(int signal);
 
 public:
-    static void initialize(std::vector<pid_t> *procs, std::atomic<bool> *run);
+    static void initialize(ShutdownCoordinator *shutdownCoordinator, std::atomic<bool> *run, LogDrain *drain);
+
+    static sigset_t managedSignals();
 
     static void setupSignalHandling();
 
     static void setChildProcess();
 
-    static void setChildCleanupHandler(std::function<void()> handler);
+    static void shutdown(int signal);
 
-    static void handleSignal(int signal);
+    // Removes every IPC object under the current IpcKeys
+    static void cleanupIPC();
 };
 
-#endif
\ No newline at end of file
+#endif
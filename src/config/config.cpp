@@ -0,0 +1,147 @@
+#include "config.h"
+#include "error_handler.h"
+#include <cstdio>
+#include <iostream>
+
+Config *Config::instance = nullptr;
+
+Config *Config::getInstance() {
+    if (instance == nullptr) {
+        instance = new Config();
+    }
+    return instance;
+}
+
+namespace {
+    double parseSeconds(const std::string &option, const std::string &value) {
+        try {
+            double seconds = std::stod(value);
+            if (seconds >= 0) {
+                return seconds;
+            }
+        } catch (const std::exception &) {
+        }
+        throw PoolError("Invalid value for " + option + ": " + value);
+    }
+
+    void parseClockTime(const std::string &option, const std::string &value, int &hour, int &minute) {
+        if (sscanf(value.c_str(), "%d:%d", &hour, &minute) < 1 || hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+            throw PoolError("Invalid value for " + option + ": " + value);
+        }
+    }
+}
+
+void Config::parse(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            throw PoolError("Missing value for option " + option);
+        }
+        std::string value = argv[++i];
+
+        if (option == "--shutdown-grace") {
+            shutdownGraceS = parseSeconds(option, value);
+        } else if (option == "--shutdown-deadline") {
+            shutdownDeadlineS = parseSeconds(option, value);
+        } else if (option == "--arrival") {
+            arrivalModel = value;
+        } else if (option == "--mix") {
+            demographicMix = value;
+        } else if (option == "--seed") {
+            seed = std::stoull(value);
+        } else if (option == "--spawner") {
+            clientSpawner = value;
+        } else if (option == "--log-file") {
+            logFile = value;
+        } else if (option == "--trace") {
+            if (value != "on" && value != "off") {
+                throw PoolError("Invalid value for " + option + ": " + value);
+            }
+            trace = value == "on";
+        } else if (option == "--trace-file") {
+            traceFile = value;
+        } else if (option == "--speed") {
+            clockSpeed = parseSeconds(option, value);
+            if (clockSpeed <= 0) {
+                throw PoolError("Invalid value for " + option + ": " + value);
+            }
+        } else if (option == "--sim-start") {
+            parseClockTime(option, value, simStartHour, simStartMinute);
+        } else if (option == "--watchdog") {
+            watchdogS = parseSeconds(option, value);
+        } else if (option == "--pool-hopping") {
+            poolHopping = parseSeconds(option, value);
+        } else if (option == "--queue-policy") {
+            queuePolicy = value;
+        } else if (option == "--queue-slo") {
+            queueSlo = value;
+        } else if (option == "--lifeguard-cpus") {
+            lifeguardCpus = value;
+        } else if (option == "--cashier-cpus") {
+            cashierCpus = value;
+        } else if (option == "--client-cpus") {
+            clientCpus = value;
+        } else if (option == "--lifeguard-priority") {
+            lifeguardPriority = value;
+        } else if (option == "--client-nice") {
+            clientNice = std::stoi(value);
+        } else if (option == "--shm-backend") {
+            shmBackend = value;
+        } else if (option == "--shm-prefault") {
+            shmPrefault = value;
+        } else if (option == "--shm-size") {
+            shmSize = value;
+        } else if (option == "--private-ipc") {
+            if (value != "on" && value != "off") {
+                throw PoolError("Invalid value for " + option + ": " + value);
+            }
+            privateIpc = value == "on";
+        } else {
+            throw PoolError("Unknown option " + option);
+        }
+    }
+
+    if (shutdownGraceS > shutdownDeadlineS) {
+        shutdownGraceS = shutdownDeadlineS;
+    }
+}
+
+void Config::printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --shutdown-grace s       time children get to react to the stop event before SIGTERM (1)\n"
+              << "  --shutdown-deadline s    time after which remaining children are SIGKILLed (5)\n"
+              << "  --arrival model          visitor arrival process (periodic:rate=1), one of\n"
+              << "                           periodic:rate=r, poisson:rate=r,\n"
+              << "                           mmpp:low=r,high=r,low-duration=s,high-duration=s,\n"
+              << "                           profile:<hour>=r,... (rate from that local hour), trace:file=path\n"
+              << "  --mix shares             visitor demographics, e.g. guardian=0.2,vip=0.2,diaper-forget=0.2\n"
+              << "  --seed n                 seed of the arrival and demographic generator (time based)\n"
+              << "  --spawner mode           how visitor processes are started (fork), one of\n"
+              << "                           fork, zygote:idle=4,max=128 (prefork pool of reused workers),\n"
+              << "                           exec[:path=p] (posix_spawn of pool_client, next to this binary)\n"
+              << "  --log-file path          write the status log with timestamps and pids to a file (terminal)\n"
+              << "  --trace on|off           record visitor lifecycle spans, switchable later with monitor (off)\n"
+              << "  --trace-file path        Chrome trace JSON written by the log drain (/tmp/pool_trace.json)\n"
+              << "  --speed x                simulated time runs x times faster than real time (1)\n"
+              << "  --sim-start HH[:MM]      simulated clock starts at that time of day (current time)\n"
+              << "  --private-ipc on|off     IPC keys and sockets derived from this process's pid, so several\n"
+              << "                           simulations can run side by side (off)\n"
+              << "  --watchdog s             restart the cashier, a lifeguard or the zygote after s seconds\n"
+              << "                           without a heartbeat, 0 for no watchdog (5)\n"
+              << "  --pool-hopping r         pool changes per simulated minute of a visitor in a pool (0)\n"
+              << "  --queue-policy policy    order of the entrance queue (strict), one of strict (VIPs first),\n"
+              << "                           aging:vip-bonus=s (regulars gain priority while waiting, VIPs start\n"
+              << "                           s seconds ahead), wfq:vip-share=x (VIPs get x of the tickets)\n"
+              << "  --queue-slo waits        queue wait SLO per class in simulated seconds (regular=120,vip=30)\n"
+              << "  --lifeguard-cpus list    pin the lifeguards to these CPUs, e.g. 0 or 0-1 (any)\n"
+              << "  --cashier-cpus list      pin the cashier to these CPUs (any)\n"
+              << "  --client-cpus list       confine the visitors and the zygote to these CPUs, e.g. 2-7 (any)\n"
+              << "  --lifeguard-priority p   normal, fifo:p (SCHED_FIFO, nice -10 where not permitted) or nice:n\n"
+              << "                           (normal)\n"
+              << "  --client-nice n          nice level of the visitor processes, 0-19 (0)\n"
+              << "  --shm-backend b          shared memory segment: sysv, posix (shm_open/mmap) or hugetlb\n"
+              << "                           (SHM_HUGETLB, sysv without reserved huge pages) (sysv)\n"
+              << "  --shm-prefault mode      off, populate (every process maps all pages at start) or lock\n"
+              << "                           (populate and mlock) (off)\n"
+              << "  --shm-size n[k|m]        segment size, at least the shared state; rounded up to pages (its size)\n";
+}
@@ -0,0 +1,52 @@
+#ifndef SWIMMING_POOL_CONFIG_H
+#define SWIMMING_POOL_CONFIG_H
+
+#include <string>
+#include <cstdint>
+
+// Startup options of the swimming_pool process, parsed once in main and inherited by forked children
+class Config {
+private:
+    static Config *instance;
+
+    Config() = default;
+
+public:
+    static Config *getInstance();
+
+    void parse(int argc, char *argv[]);
+
+    static void printUsage(const char *program);
+
+    double shutdownGraceS = 1.0;
+    double shutdownDeadlineS = 5.0;
+    std::string arrivalModel = "periodic:rate=1";
+    std::string demographicMix;
+    uint64_t seed = 0;
+    std::string clientSpawner = "fork";
+    std::string logFile;
+    bool trace = false;
+    double clockSpeed = 1.0;
+    int simStartHour = -1;
+    int simStartMinute = 0;
+    std::string traceFile = "/tmp/pool_trace.json";
+    bool privateIpc = false;
+    double watchdogS = 5.0;     // heartbeat silence after which a role is restarted, 0 turns the watchdog off
+    double poolHopping = 0;     // pool changes per simulated minute of a visitor in a pool
+    std::string queuePolicy = "strict";
+    std::string queueSlo;
+    std::string lifeguardCpus;  // CPU lists as in cpuset(7), empty for no pinning
+    std::string cashierCpus;
+    std::string clientCpus;
+    std::string lifeguardPriority = "normal";
+    int clientNice = 0;
+    std::string shmBackend = "sysv";
+    std::string shmPrefault = "off";
+    std::string shmSize;        // empty for the size of the shared state
+
+    Config(const Config &) = delete;
+
+    Config &operator=(const Config &) = delete;
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "cpu_placement.h"
+#include "error_handler.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+
+cpu_set_t CpuPlacement::cpus[static_cast<int>(ProcessRole::Count)];
+bool CpuPlacement::pinned[static_cast<int>(ProcessRole::Count)] = {};
+LifeguardPriority CpuPlacement::lifeguardPriority = LIFEGUARD_PRIORITY_NORMAL;
+int CpuPlacement::lifeguardLevel = 0;
+int CpuPlacement::clientNice = 0;
+
+namespace {
+    int parseNumber(const std::string &text, const std::string &context) {
+        try {
+            size_t used = 0;
+            int value = std::stoi(text, &used);
+            if (used == text.size()) {
+                return value;
+            }
+        } catch (const std::exception &) {
+        }
+        throw PoolError("Invalid value in " + context + ": " + text);
+    }
+
+    std::string formatCpuList(const cpu_set_t &set) {
+        std::ostringstream out;
+        bool first = true;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (!CPU_ISSET(cpu, &set)) {
+                continue;
+            }
+            int last = cpu;
+            while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) {
+                last++;
+            }
+            out << (first ? "" : ",") << cpu;
+            if (last > cpu) {
+                out << "-" << last;
+            }
+            first = false;
+            cpu = last;
+        }
+        return out.str();
+    }
+
+    // Clients share the zygote's settings, the zygote being their template
+    int placementRole(ProcessRole role) {
+        return static_cast<int>(role == ProcessRole::Zygote ? ProcessRole::Client : role);
+    }
+}
+
+cpu_set_t CpuPlacement::parseCpuList(const std::string &list) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    std::stringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        size_t dash = range.find('-');
+        int first = parseNumber(range.substr(0, dash), list);
+        int last = dash == std::string::npos ? first : parseNumber(range.substr(dash + 1), list);
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            throw PoolError("Invalid CPU range " + range + " in " + list);
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        throw PoolError("Empty CPU list: " + list);
+    }
+    return set;
+}
+
+void CpuPlacement::configure(const std::string &lifeguardCpus, const std::string &cashierCpus,
+                             const std::string &clientCpus, const std::string &priority, int clientNiceLevel) {
+    const std::pair<ProcessRole, const std::string *> lists[] = {
+            {ProcessRole::Lifeguard, &lifeguardCpus},
+            {ProcessRole::Cashier,   &cashierCpus},
+            {ProcessRole::Client,    &clientCpus}
+    };
+    for (const auto &list: lists) {
+        int role = static_cast<int>(list.first);
+        pinned[role] = !list.second->empty();
+        if (pinned[role]) {
+            cpus[role] = parseCpuList(*list.second);
+        }
+    }
+
+    size_t colon = priority.find(':');
+    std::string kind = priority.substr(0, colon);
+    if (kind == "normal" && colon == std::string::npos) {
+        lifeguardPriority = LIFEGUARD_PRIORITY_NORMAL;
+    } else if (kind == "fifo" && colon != std::string::npos) {
+        lifeguardPriority = LIFEGUARD_PRIORITY_FIFO;
+        lifeguardLevel = parseNumber(priority.substr(colon + 1), priority);
+        if (lifeguardLevel < sched_get_priority_min(SCHED_FIFO) ||
+            lifeguardLevel > sched_get_priority_max(SCHED_FIFO)) {
+            throw PoolError("SCHED_FIFO priority out of range: " + priority);
+        }
+    } else if (kind == "nice" && colon != std::string::npos) {
+        lifeguardPriority = LIFEGUARD_PRIORITY_NICE;
+        lifeguardLevel = parseNumber(priority.substr(colon + 1), priority);
+    } else {
+        throw PoolError("Invalid lifeguard priority: " + priority);
+    }
+
+    if (clientNiceLevel < 0 || clientNiceLevel > 19) {
+        throw PoolError("Client nice level must be between 0 and 19");
+    }
+    clientNice = clientNiceLevel;
+}
+
+void CpuPlacement::apply(ProcessRole role) {
+    int index = placementRole(role);
+    if (pinned[index] && sched_setaffinity(0, sizeof(cpu_set_t), &cpus[index]) == -1) {
+        std::cerr << processRoleName(role) << ": sched_setaffinity " << formatCpuList(cpus[index])
+                  << " failed: " << strerror(errno) << std::endl;
+    }
+
+    if (index == static_cast<int>(ProcessRole::Client) && clientNice > 0 &&
+        setpriority(PRIO_PROCESS, 0, clientNice) == -1) {
+        std::cerr << processRoleName(role) << ": setpriority failed: " << strerror(errno) << std::endl;
+    }
+
+    if (role != ProcessRole::Lifeguard || lifeguardPriority == LIFEGUARD_PRIORITY_NORMAL) {
+        return;
+    }
+    int nice = lifeguardLevel;
+    if (lifeguardPriority == LIFEGUARD_PRIORITY_FIFO) {
+        struct sched_param param{};
+        param.sched_priority = lifeguardLevel;
+        if (sched_setscheduler(0, SCHED_FIFO, &param) == 0) {
+            return;
+        }
+        std::cerr << "lifeguard: SCHED_FIFO not permitted (" << strerror(errno) << "), trying nice "
+                  << FALLBACK_NICE << std::endl;
+        nice = FALLBACK_NICE;
+    }
+    if (setpriority(PRIO_PROCESS, 0, nice) == -1) {
+        std::cerr << "lifeguard: nice " << nice << " not permitted (" << strerror(errno)
+                  << "), staying at the default priority" << std::endl;
+    }
+}
+
+std::string CpuPlacement::describe() {
+    std::ostringstream out;
+    for (ProcessRole role: {ProcessRole::Lifeguard, ProcessRole::Cashier, ProcessRole::Client}) {
+        int index = static_cast<int>(role);
+        out << processRoleName(role) << " CPUs " << (pinned[index] ? formatCpuList(cpus[index]) : "any") << ", ";
+    }
+    switch (lifeguardPriority) {
+        case LIFEGUARD_PRIORITY_FIFO:
+            out << "lifeguards SCHED_FIFO " << lifeguardLevel;
+            break;
+        case LIFEGUARD_PRIORITY_NICE:
+            out << "lifeguards nice " << lifeguardLevel;
+            break;
+        default:
+            out << "lifeguards normal priority";
+            break;
+    }
+    out << ", clients nice " << clientNice;
+    return out.str();
+}
@@ -0,0 +1,41 @@
+#ifndef SWIMMING_POOL_CPU_PLACEMENT_H
+#define SWIMMING_POOL_CPU_PLACEMENT_H
+
+#include "process_role.h"
+#include <sched.h>
+#include <string>
+
+enum LifeguardPriority {
+    LIFEGUARD_PRIORITY_NORMAL,
+    LIFEGUARD_PRIORITY_FIFO,    // SCHED_FIFO, nice FALLBACK_NICE when that is not permitted
+    LIFEGUARD_PRIORITY_NICE
+};
+
+// CPU sets and scheduling of the roles, so evacuation notices do not queue behind visitor churn.
+// main configures it before forking; each child applies its role's settings right after the fork,
+// before it starts threads, and the threads inherit them. The zygote takes the visitors' settings.
+class CpuPlacement {
+private:
+    static cpu_set_t cpus[static_cast<int>(ProcessRole::Count)];
+    static bool pinned[static_cast<int>(ProcessRole::Count)];
+    static LifeguardPriority lifeguardPriority;
+    static int lifeguardLevel;      // SCHED_FIFO priority or nice value
+    static int clientNice;
+
+public:
+    static constexpr int FALLBACK_NICE = -10;
+
+    // "2-5,7" style lists as in cpuset(7); throws PoolError on a malformed list
+    static cpu_set_t parseCpuList(const std::string &list);
+
+    // Empty CPU lists leave the role unpinned; priority is normal, fifo:p or nice:n
+    static void configure(const std::string &lifeguardCpus, const std::string &cashierCpus,
+                          const std::string &clientCpus, const std::string &priority, int clientNiceLevel);
+
+    // Failures are reported on stderr and leave the process as it was
+    static void apply(ProcessRole role);
+
+    static std::string describe();
+};
+
+#endif
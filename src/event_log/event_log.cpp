@@ -0,0 +1,165 @@
+#include "event_log.h"
+#include "error_handler.h"
+#include "process_role.h"
+#include <cstdio>
+#include <iostream>
+#include <pthread.h>
+#include <unistd.h>
+
+LogSegment *EventLog::segment = nullptr;
+bool EventLog::attached = false;
+std::atomic<LogRing *> EventLog::processRing(nullptr);
+std::atomic<bool> EventLog::noRingAvailable(false);
+
+namespace {
+    const char *const FORMATS[LOG_EVENT_COUNT] = {
+            "Failed to acquire semaphore for pool %P, errno: %d (%e)",
+            "Failed to release semaphore for pool %P, errno: %d (%e)",
+            "Klient %d nie może wejść na basen bez pieluch do pływania",
+            "Próba wejścia na zamknięty basen %P - odmowa!",
+            "Basen %P jest pełny: %d/%d",
+            "Klient %d w wieku %d bez dziecka próbował wejść do brodzika",
+            "Klient %d podwyższył by średnią wieku poza limit (%f > %f)",
+            "Klient %d w wieku %d nie spełnia limitu wieku basenu %P",
+            "Klient %d w wieku %d nie może wejść na basen %P bez opiekuna",
+            "Klient %d w wieku %d wszedł na basen %P",
+            "Klient %d w wieku %d oraz dziecko %d w wieku %d weszli na basen %P",
+            "Klient szukający basenu opuszcza obiekt ze względu na przerwę techniczną",
+            "Klient %d otrzymał sygnał do ewakuacji z basenu %P",
+            "Client %d's ticket has expired (was valid for %d minutes)",
+            "Kasjer: bilet %d dla klienta %d",
+            "Kasjer: brak miejsca w kolejce dla klienta %d",
+            "Removed disconnected client socket from pool %P. Remaining clients: %d",
+            "EMERGENCY: Immediate pool evacuation required for pool %P",
+            "EMERGENCY: Emergency ended for pool %P",
+            "Ratownik: zamykanie basenu %P z powodu nadchodzącej konserwacji",
+            "Ratownik: Ewakuacja basenu %P!",
+            "Ratownik: Ponowne otwarcie %P!",
+            "Cannot open pool - outside working hours",
+            "Cannot open pool - emergency situation active",
+            "Zamykamy basen na konserwacje!",
+            "Poza godzinami pracy",
+            "Zwolniono miejsce klienta %d na basenie %P - proces %d nie odnawia dzierżawy",
+            "Miejsca odzyskane z wygasłych dzierżaw w ostatniej godzinie: %d",
+            "Klient %d przeszedł z basenu %P na basen %P",
+            "Failed to hand a client connection over from pool %P to pool %P, errno: %d (%e)",
+            "Watchdog: %R (pid %d) bez sygnału życia od %f s - restart",
+            "Watchdog: %R wznowiony jako pid %d po %f s",
+    };
+
+    const char *poolName(int64_t poolType) {
+        switch (poolType) {
+            case 0:
+                return "Olympic";
+            case 1:
+                return "Recreational";
+            case 2:
+                return "Children";
+            default:
+                return "";
+        }
+    }
+}
+
+void EventLog::createSegment() {
+    segment = static_cast<LogSegment *>(RingSegment::create(LOG_SHM_KEY, sizeof(LogSegment)));
+    for (auto &ring: segment->rings) {
+        ring.owner.store(0, std::memory_order_release);
+    }
+    attached = true;
+}
+
+void EventLog::removeSegment() {
+    RingSegment::remove(LOG_SHM_KEY, sizeof(LogSegment));
+}
+
+LogSegment *EventLog::getSegment() {
+    if (!attached) {
+        attached = true;
+        segment = static_cast<LogSegment *>(RingSegment::attach(LOG_SHM_KEY, sizeof(LogSegment)));
+    }
+    return segment;
+}
+
+LogRing *EventLog::claimRing() {
+    static bool forkHandlerInstalled = false;
+    if (!forkHandlerInstalled) {
+        forkHandlerInstalled = true;
+        // A forked child must not keep pushing into its parent's ring
+        pthread_atfork(nullptr, nullptr, [] {
+            processRing.store(nullptr, std::memory_order_relaxed);
+            noRingAvailable.store(false, std::memory_order_relaxed);
+        });
+    }
+
+    LogSegment *logSegment = getSegment();
+    if (!logSegment) {
+        noRingAvailable.store(true, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    LogRing *ring = claimFreeRing(logSegment->rings, getpid());
+    if (!ring) {
+        noRingAvailable.store(true, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // Another thread of this process may have claimed a ring at the same time
+    LogRing *none = nullptr;
+    if (processRing.compare_exchange_strong(none, ring, std::memory_order_acq_rel)) {
+        return ring;
+    }
+    ring->owner.store(0, std::memory_order_release);
+    return none;
+}
+
+void EventLog::writeDirect(const LogEntry &entry) {
+    std::cout << format(entry.event, entry.args, entry.argCount) << std::endl;
+}
+
+std::string EventLog::format(uint16_t event, const int64_t *args, int argCount) {
+    if (event >= LOG_EVENT_COUNT) {
+        return "Unknown log event " + std::to_string(event);
+    }
+
+    std::string line;
+    int argIndex = 0;
+    for (const char *c = FORMATS[event]; *c; c++) {
+        if (*c != '%' || c[1] == '\0') {
+            line += *c;
+            continue;
+        }
+
+        char spec = *++c;
+        int64_t value = argIndex < argCount ? args[argIndex] : 0;
+        argIndex++;
+        switch (spec) {
+            case 'd':
+                line += std::to_string(value);
+                break;
+            case 'f': {
+                double asDouble;
+                memcpy(&asDouble, &value, sizeof(asDouble));
+                char buffer[32];
+                snprintf(buffer, sizeof(buffer), "%g", asDouble);
+                line += buffer;
+                break;
+            }
+            case 'P':
+                line += poolName(value);
+                break;
+            case 'e':
+                line += strerror(static_cast<int>(value));
+                break;
+            case 'R':
+                line += processRoleName(static_cast<ProcessRole>(value));
+                break;
+            default:
+                line += '%';
+                line += spec;
+                argIndex--;
+                break;
+        }
+    }
+    return line;
+}
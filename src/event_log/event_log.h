@@ -0,0 +1,132 @@
+#ifndef SWIMMING_POOL_EVENT_LOG_H
+#define SWIMMING_POOL_EVENT_LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <sys/types.h>
+#include <type_traits>
+#include "shared_ring.h"
+
+const key_t LOG_SHM_KEY = 6970;
+
+// Every status line the simulation prints. The text lives in a format table in event_log.cpp,
+// hot paths only store the event id and its numeric arguments.
+enum LogEvent : uint16_t {
+    LOG_POOL_LOCK_FAILED,
+    LOG_POOL_UNLOCK_FAILED,
+    LOG_REFUSED_NO_SWIM_DIAPER,
+    LOG_REFUSED_POOL_CLOSED,
+    LOG_REFUSED_POOL_FULL,
+    LOG_REFUSED_NO_CHILD,
+    LOG_REFUSED_AVERAGE_AGE,
+    LOG_REFUSED_AGE_LIMIT,
+    LOG_REFUSED_NO_GUARDIAN,
+    LOG_CLIENT_ENTERED,
+    LOG_CLIENT_ENTERED_WITH_CHILD,
+    LOG_CLIENT_LEFT_FOR_MAINTENANCE,
+    LOG_CLIENT_EVACUATED,
+    LOG_TICKET_EXPIRED,
+    LOG_TICKET_ISSUED,
+    LOG_TICKET_REFUSED,
+    LOG_SOCKET_REMOVED,
+    LOG_EMERGENCY_STARTED,
+    LOG_EMERGENCY_ENDED,
+    LOG_POOL_CLOSING_FOR_MAINTENANCE,
+    LOG_POOL_EVACUATION,
+    LOG_POOL_REOPENED,
+    LOG_POOL_CANNOT_OPEN_HOURS,
+    LOG_POOL_CANNOT_OPEN_EMERGENCY,
+    LOG_POOL_MAINTENANCE,
+    LOG_OUTSIDE_WORKING_HOURS,
+    LOG_LEASE_RECLAIMED,
+    LOG_LEASES_HOURLY,
+    LOG_CLIENT_TRANSFERRED,
+    LOG_HANDOFF_FAILED,
+    LOG_WATCHDOG_STALL,
+    LOG_WATCHDOG_RECOVERED,
+    LOG_EVENT_COUNT
+};
+
+struct LogEntry {
+    static constexpr int MAX_ARGS = 5;
+
+    uint64_t timestampNs;
+    int32_t pid;
+    uint16_t event;
+    uint16_t argCount;
+    int64_t args[MAX_ARGS];
+};
+
+using LogRing = SharedRing<LogEntry, 256>;
+
+static_assert(sizeof(LogRing::Slot) == 64, "log records should fill exactly one cache line");
+
+struct LogSegment {
+    static constexpr int RING_COUNT = 512;
+
+    LogRing rings[RING_COUNT];
+};
+
+// Asynchronous status log. A log call copies the event id and its arguments into the calling
+// process's ring in the log segment; the LogDrain process formats and writes them. Processes
+// without the segment (the tools, or when the rings are all taken) print the line directly.
+class EventLog {
+private:
+    static LogSegment *segment;
+    static bool attached;
+    static std::atomic<LogRing *> processRing;
+    static std::atomic<bool> noRingAvailable;
+
+    static LogRing *claimRing();
+
+    static void writeDirect(const LogEntry &entry);
+
+    template<typename T>
+    static int64_t toArg(T value) {
+        if constexpr (std::is_floating_point_v<T>) {
+            auto asDouble = static_cast<double>(value);
+            int64_t bits;
+            memcpy(&bits, &asDouble, sizeof(bits));
+            return bits;
+        } else {
+            return static_cast<int64_t>(value);
+        }
+    }
+
+public:
+    // Created once by the main process before forking, removed in SignalHandler::cleanupIPC
+    static void createSegment();
+
+    static void removeSegment();
+
+    static LogSegment *getSegment();
+
+    template<typename... Args>
+    static void log(LogEvent event, Args... args) {
+        static_assert(sizeof...(Args) <= LogEntry::MAX_ARGS, "too many log arguments");
+        LogEntry entry = {0, 0, event, sizeof...(Args), {toArg(args)...}};
+
+        LogRing *ring = processRing.load(std::memory_order_acquire);
+        if (!ring && !noRingAvailable.load(std::memory_order_relaxed)) {
+            ring = claimRing();
+        }
+        if (!ring) {
+            writeDirect(entry);
+            return;
+        }
+
+        struct timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        entry.timestampNs = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+        entry.pid = ring->owner.load(std::memory_order_relaxed);
+        ring->push(entry);
+    }
+
+    // %d integer, %f floating point, %P pool name, %e strerror of an errno value, %R process role
+    static std::string format(uint16_t event, const int64_t *args, int argCount);
+};
+
+#endif
@@ -0,0 +1,32 @@
+#include "shared_ring.h"
+#include "error_handler.h"
+#include "shared_memory.h"
+#include <sys/shm.h>
+
+void *RingSegment::create(key_t key, size_t size) {
+    int shmId = shmget(IpcKeys::key(key), size, IPC_CREAT | 0666);
+    checkSystemCall(shmId, "shmget failed for a ring segment");
+
+    void *segment = shmat(shmId, nullptr, 0);
+    if (segment == (void *) -1) {
+        throw PoolSystemError("shmat failed for a ring segment");
+    }
+    return segment;
+}
+
+void *RingSegment::attach(key_t key, size_t size) {
+    int shmId = shmget(IpcKeys::key(key), size, 0666);
+    if (shmId < 0) {
+        return nullptr;
+    }
+
+    void *segment = shmat(shmId, nullptr, 0);
+    return segment == (void *) -1 ? nullptr : segment;
+}
+
+void RingSegment::remove(key_t key, size_t size) {
+    int shmId = shmget(IpcKeys::key(key), size, 0666);
+    if (shmId >= 0) {
+        shmctl(shmId, IPC_RMID, nullptr);
+    }
+}
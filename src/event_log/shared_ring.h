@@ -0,0 +1,101 @@
+#ifndef SWIMMING_POOL_SHARED_RING_H
+#define SWIMMING_POOL_SHARED_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+// Bounded multi-producer single-consumer ring (Vyukov's sequence-per-slot queue) living in shared
+// memory. Each process claims one ring, all of its threads push without locks and the drain
+// process is the only consumer. A full ring drops the entry and counts it.
+template<typename Entry, uint64_t Size>
+struct SharedRing {
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        Entry entry;
+    };
+
+    static constexpr uint64_t SIZE = Size;
+
+    std::atomic<int32_t> owner;
+    std::atomic<uint64_t> dropped;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    Slot slots[Size];
+
+    void reset() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+        for (uint64_t i = 0; i < Size; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    bool push(const Entry &entry) {
+        uint64_t position = head.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true) {
+            slot = &slots[position % Size];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<int64_t>(sequence - position);
+            if (difference == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->entry = entry;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Drain side only
+    bool pop(Entry &out) {
+        uint64_t position = tail.load(std::memory_order_relaxed);
+        Slot &slot = slots[position % Size];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            return false;
+        }
+
+        out = slot.entry;
+        slot.sequence.store(position + Size, std::memory_order_release);
+        tail.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+// Takes the first free ring for the calling process. The ring is reset by its new owner, so the
+// pages of rings that are never claimed stay untouched.
+template<typename Ring, size_t Count>
+Ring *claimFreeRing(Ring (&rings)[Count], int32_t pid) {
+    for (auto &ring: rings) {
+        int32_t expected = 0;
+        if (ring.owner.load(std::memory_order_relaxed) == 0 &&
+            ring.owner.compare_exchange_strong(expected, pid, std::memory_order_acq_rel)) {
+            ring.reset();
+            return &ring;
+        }
+    }
+    return nullptr;
+}
+
+// SysV segments holding the rings: created by the main process, attached lazily everywhere else
+namespace RingSegment {
+    void *create(key_t key, size_t size);
+
+    // nullptr when the segment does not exist
+    void *attach(key_t key, size_t size);
+
+    void remove(key_t key, size_t size);
+}
+
+#endif
@@ -0,0 +1,204 @@
+#include "latency_histogram.h"
+#include "shared_ring.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+
+LatencySegment *LatencyHistograms::segment = nullptr;
+bool LatencyHistograms::attached = false;
+std::atomic<LatencySlot *> LatencyHistograms::processSlot(nullptr);
+
+namespace {
+    const char *const OP_NAMES[LATENCY_OP_COUNT] = {
+            "pool_enter", "pool_leave", "pool_transfer", "wait_for_ticket", "connect_to_pool", "process_client",
+            "notify_clients"
+    };
+
+    // Owner of a slot whose samples are being moved to the retired slot
+    const int32_t RETIRING = -1;
+
+    void raiseMax(std::atomic<uint64_t> &max, uint64_t ns) {
+        uint64_t current = max.load(std::memory_order_relaxed);
+        while (ns > current && !max.compare_exchange_weak(current, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Only called on slots of exited processes, so nothing records into the source meanwhile
+    void retire(LatencySlot &slot, LatencySlot &retired) {
+        for (int op = 0; op < LATENCY_OP_COUNT; op++) {
+            HdrHistogram &from = slot.ops[op];
+            HdrHistogram &to = retired.ops[op];
+            for (int bucket = 0; bucket < HdrHistogram::BUCKETS; bucket++) {
+                uint64_t count = from.counts[bucket].load(std::memory_order_relaxed);
+                if (count) {
+                    to.counts[bucket].fetch_add(count, std::memory_order_relaxed);
+                }
+            }
+            to.sumNs.fetch_add(from.sumNs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            raiseMax(to.maxNs, from.maxNs.load(std::memory_order_relaxed));
+            from.clear();
+        }
+    }
+}
+
+int HdrHistogram::bucketOf(uint64_t ns) {
+    if (ns < 2 * SUB_BUCKETS) {
+        return static_cast<int>(ns);
+    }
+    int magnitude = 63 - __builtin_clzll(ns);
+    if (magnitude >= MAX_MAGNITUDE) {
+        return BUCKETS - 1;
+    }
+    int shift = magnitude - SUB_BUCKET_BITS;
+    return 2 * SUB_BUCKETS + (shift - 1) * SUB_BUCKETS + static_cast<int>((ns >> shift) - SUB_BUCKETS);
+}
+
+uint64_t HdrHistogram::bucketUpperNs(int bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int shift = (bucket - 2 * SUB_BUCKETS) / SUB_BUCKETS + 1;
+    uint64_t subBucket = SUB_BUCKETS + (bucket - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+void HdrHistogram::record(uint64_t ns) {
+    counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    sumNs.fetch_add(ns, std::memory_order_relaxed);
+    raiseMax(maxNs, ns);
+}
+
+void HdrHistogram::clear() {
+    for (auto &count: counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    sumNs.store(0, std::memory_order_relaxed);
+    maxNs.store(0, std::memory_order_relaxed);
+}
+
+void LatencySnapshot::add(const HdrHistogram &histogram) {
+    for (int bucket = 0; bucket < HdrHistogram::BUCKETS; bucket++) {
+        uint64_t count = histogram.counts[bucket].load(std::memory_order_relaxed);
+        counts[bucket] += count;
+        total += count;
+    }
+    sumNs += histogram.sumNs.load(std::memory_order_relaxed);
+    maxNs = std::max(maxNs, histogram.maxNs.load(std::memory_order_relaxed));
+}
+
+void LatencySnapshot::merge(const LatencySnapshot &other) {
+    for (int bucket = 0; bucket < HdrHistogram::BUCKETS; bucket++) {
+        counts[bucket] += other.counts[bucket];
+    }
+    total += other.total;
+    sumNs += other.sumNs;
+    maxNs = std::max(maxNs, other.maxNs);
+}
+
+uint64_t LatencySnapshot::percentileNs(double fraction) const {
+    if (total == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(fraction * static_cast<double>(total));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < HdrHistogram::BUCKETS; bucket++) {
+        seen += counts[bucket];
+        if (seen > rank || seen == total) {
+            return std::min(HdrHistogram::bucketUpperNs(bucket), maxNs);
+        }
+    }
+    return maxNs;
+}
+
+void LatencyHistograms::createSegment() {
+    segment = static_cast<LatencySegment *>(RingSegment::create(LATENCY_SHM_KEY, sizeof(LatencySegment)));
+    attached = true;
+}
+
+void LatencyHistograms::removeSegment() {
+    RingSegment::remove(LATENCY_SHM_KEY, sizeof(LatencySegment));
+}
+
+LatencySegment *LatencyHistograms::getSegment() {
+    if (!attached) {
+        attached = true;
+        segment = static_cast<LatencySegment *>(RingSegment::attach(LATENCY_SHM_KEY, sizeof(LatencySegment)));
+    }
+    return segment;
+}
+
+LatencySlot *LatencyHistograms::claimSlot() {
+    static bool forkHandlerInstalled = false;
+    if (!forkHandlerInstalled) {
+        forkHandlerInstalled = true;
+        pthread_atfork(nullptr, nullptr, [] {
+            processSlot.store(nullptr, std::memory_order_relaxed);
+        });
+    }
+
+    LatencySegment *latency = getSegment();
+    if (!latency) {
+        return nullptr;
+    }
+
+    int32_t pid = getpid();
+    LatencySlot *claimed = nullptr;
+    for (auto &slot: latency->slots) {
+        int32_t expected = 0;
+        if (slot.owner.load(std::memory_order_relaxed) == 0 &&
+            slot.owner.compare_exchange_strong(expected, pid, std::memory_order_acq_rel)) {
+            claimed = &slot;
+            break;
+        }
+    }
+
+    // All taken: move the samples of an exited process to the retired slot and take its place
+    for (int i = 0; !claimed && i < LatencySegment::SLOT_COUNT; i++) {
+        LatencySlot &slot = latency->slots[i];
+        int32_t owner = slot.owner.load(std::memory_order_relaxed);
+        if (owner > 0 && kill(owner, 0) == -1 && errno == ESRCH &&
+            slot.owner.compare_exchange_strong(owner, RETIRING, std::memory_order_acq_rel)) {
+            retire(slot, latency->retired);
+            slot.owner.store(pid, std::memory_order_release);
+            claimed = &slot;
+        }
+    }
+
+    if (!claimed) {
+        claimed = &latency->retired;
+    }
+
+    LatencySlot *none = nullptr;
+    if (processSlot.compare_exchange_strong(none, claimed, std::memory_order_acq_rel)) {
+        return claimed;
+    }
+    if (claimed != &latency->retired) {
+        claimed->owner.store(0, std::memory_order_release);
+    }
+    return none;
+}
+
+void LatencyHistograms::record(LatencyOp op, uint64_t ns) {
+    LatencySlot *slot = processSlot.load(std::memory_order_acquire);
+    if (!slot && !(slot = claimSlot())) {
+        return;
+    }
+    slot->ops[op].record(ns);
+}
+
+const char *LatencyHistograms::opName(int op) {
+    return op >= 0 && op < LATENCY_OP_COUNT ? OP_NAMES[op] : "unknown";
+}
+
+LatencySnapshot LatencyHistograms::merged(const LatencySegment &latency, LatencyOp op) {
+    LatencySnapshot snapshot;
+    snapshot.add(latency.retired.ops[op]);
+    for (const auto &slot: latency.slots) {
+        if (slot.owner.load(std::memory_order_acquire) != 0) {
+            snapshot.add(slot.ops[op]);
+        }
+    }
+    return snapshot;
+}
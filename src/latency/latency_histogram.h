@@ -0,0 +1,125 @@
+#ifndef SWIMMING_POOL_LATENCY_HISTOGRAM_H
+#define SWIMMING_POOL_LATENCY_HISTOGRAM_H
+
+#include "metrics.h"
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+
+const key_t LATENCY_SHM_KEY = 6972;
+
+enum LatencyOp : uint8_t {
+    LATENCY_OP_POOL_ENTER,
+    LATENCY_OP_POOL_LEAVE,
+    LATENCY_OP_POOL_TRANSFER,
+    LATENCY_OP_WAIT_FOR_TICKET,
+    LATENCY_OP_CONNECT_TO_POOL,
+    LATENCY_OP_PROCESS_CLIENT,
+    LATENCY_OP_NOTIFY_CLIENTS,
+    LATENCY_OP_COUNT
+};
+
+// Log-linear buckets as in HdrHistogram: values below 2 * SUB_BUCKETS ns get a bucket each, above
+// that every power of two is split into SUB_BUCKETS equal buckets, so a value is known to within
+// 1/SUB_BUCKETS (6.25%) whatever its magnitude. Values from 2^MAX_MAGNITUDE ns (about 18 minutes)
+// on share the last bucket.
+struct HdrHistogram {
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_MAGNITUDE = 40;
+    static constexpr int BUCKETS = 2 * SUB_BUCKETS + (MAX_MAGNITUDE - SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+    std::atomic<uint64_t> counts[BUCKETS];
+    std::atomic<uint64_t> sumNs;
+    std::atomic<uint64_t> maxNs;
+
+    static int bucketOf(uint64_t ns);
+
+    // The highest value that lands in the bucket
+    static uint64_t bucketUpperNs(int bucket);
+
+    void record(uint64_t ns);
+
+    void clear();
+};
+
+// One process's histograms, one per operation. owner is the pid, 0 for a free slot.
+struct LatencySlot {
+    std::atomic<int32_t> owner;
+    HdrHistogram ops[LATENCY_OP_COUNT];
+};
+
+struct LatencySegment {
+    static constexpr int SLOT_COUNT = 256;
+
+    // Histograms of exited processes whose slots were taken over, and of processes that found no
+    // free slot; shared, so recording into it costs cache line traffic but stays lock-free
+    LatencySlot retired;
+    LatencySlot slots[SLOT_COUNT];
+};
+
+// A plain copy of histograms, for merging and percentile queries off the shared segment
+struct LatencySnapshot {
+    uint64_t counts[HdrHistogram::BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t sumNs = 0;
+    uint64_t maxNs = 0;
+
+    void add(const HdrHistogram &histogram);
+
+    void merge(const LatencySnapshot &other);
+
+    // Highest value of the bucket holding that fraction of the samples, capped at the recorded
+    // maximum; 0 without samples
+    uint64_t percentileNs(double fraction) const;
+
+    double meanNs() const { return total ? static_cast<double>(sumNs) / static_cast<double>(total) : 0; }
+};
+
+// Per-operation latency distributions of the public operations of pools, visitors, the cashier and
+// the lifeguards. Each process claims a slot of the latency segment on its first sample and records
+// into it with relaxed atomic adds; readers (monitor, pool_latency) merge the slots on demand.
+class LatencyHistograms {
+private:
+    static LatencySegment *segment;
+    static bool attached;
+    static std::atomic<LatencySlot *> processSlot;
+
+    static LatencySlot *claimSlot();
+
+public:
+    static void createSegment();
+
+    static void removeSegment();
+
+    // nullptr when the simulation is not running
+    static LatencySegment *getSegment();
+
+    static void record(LatencyOp op, uint64_t ns);
+
+    static const char *opName(int op);
+
+    // Every process's samples of op, retired ones included. A slot being taken over while this runs
+    // may be missed or counted twice for that moment.
+    static LatencySnapshot merged(const LatencySegment &latency, LatencyOp op);
+};
+
+// Records the time until the scope is left, whichever way it is left
+class LatencyScope {
+private:
+    LatencyOp op;
+    uint64_t startNs;
+
+public:
+    explicit LatencyScope(LatencyOp op) : op(op), startNs(Metrics::nowNs()) {}
+
+    ~LatencyScope() {
+        LatencyHistograms::record(op, Metrics::nowNs() - startNs);
+    }
+
+    LatencyScope(const LatencyScope &) = delete;
+
+    LatencyScope &operator=(const LatencyScope &) = delete;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "lease.h"
+#include "metrics.h"
+#include "shared_segment.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <pthread.h>
+#include <unistd.h>
+
+std::atomic<ClientLease *> Leases::processLease(nullptr);
+
+namespace {
+    bool processGone(int32_t pid) {
+        return kill(pid, 0) == -1 && errno == ESRCH;
+    }
+}
+
+ClientLease *Leases::claimSlot() {
+    static bool forkHandlerInstalled = false;
+    if (!forkHandlerInstalled) {
+        forkHandlerInstalled = true;
+        pthread_atfork(nullptr, nullptr, [] {
+            processLease.store(nullptr, std::memory_order_relaxed);
+        });
+        atexit(release);
+    }
+
+    SharedMemory *shm = SharedSegment::get();
+    if (!shm) {
+        return nullptr;
+    }
+
+    int32_t pid = getpid();
+    ClientLease *claimed = nullptr;
+    for (auto &slot: shm->leases.slots) {
+        int32_t expected = 0;
+        if (slot.pid.load(std::memory_order_relaxed) == 0 &&
+            slot.pid.compare_exchange_strong(expected, pid, std::memory_order_acq_rel)) {
+            claimed = &slot;
+            break;
+        }
+    }
+
+    // All taken: the slot of an exited process is free again, its places are reclaimed by pid anyway
+    for (int i = 0; !claimed && i < LeaseTable::SLOT_COUNT; i++) {
+        ClientLease &slot = shm->leases.slots[i];
+        int32_t owner = slot.pid.load(std::memory_order_relaxed);
+        if (owner > 0 && processGone(owner) &&
+            slot.pid.compare_exchange_strong(owner, pid, std::memory_order_acq_rel)) {
+            claimed = &slot;
+        }
+    }
+
+    if (claimed) {
+        claimed->heartbeatNs.store(Metrics::nowNs(), std::memory_order_relaxed);
+        processLease.store(claimed, std::memory_order_release);
+    }
+    return claimed;
+}
+
+void Leases::hold() {
+    ClientLease *lease = processLease.load(std::memory_order_acquire);
+    if (!lease) {
+        claimSlot();
+        return;
+    }
+    lease->heartbeatNs.store(Metrics::nowNs(), std::memory_order_relaxed);
+}
+
+void Leases::renew() {
+    if (ClientLease *lease = processLease.load(std::memory_order_relaxed)) {
+        lease->heartbeatNs.store(Metrics::nowNs(), std::memory_order_relaxed);
+    }
+}
+
+void Leases::release() {
+    ClientLease *lease = processLease.exchange(nullptr, std::memory_order_acq_rel);
+    if (!lease) {
+        return;
+    }
+    // Only if the reaper did not hand the slot to another process meanwhile
+    int32_t pid = getpid();
+    lease->pid.compare_exchange_strong(pid, 0, std::memory_order_acq_rel);
+}
+
+LeaseCheck::LeaseCheck(const LeaseTable &table, uint64_t nowNs) : nowNs(nowNs) {
+    for (const auto &slot: table.slots) {
+        int32_t pid = slot.pid.load(std::memory_order_acquire);
+        if (pid > 0) {
+            heartbeats[pid] = slot.heartbeatNs.load(std::memory_order_relaxed);
+        }
+    }
+    for (const auto &heartbeat: heartbeats) {
+        judge(heartbeat.first);
+    }
+}
+
+void LeaseCheck::judge(int32_t pid) {
+    if (pid <= 0 || verdicts.count(pid)) {
+        return;
+    }
+    // A process without a slot (the table was full) is only judged by whether it still runs
+    bool isExpired = processGone(pid);
+    auto heartbeat = heartbeats.find(pid);
+    if (!isExpired && heartbeat != heartbeats.end()) {
+        isExpired = nowNs > heartbeat->second && nowNs - heartbeat->second > Leases::TTL_NS;
+    }
+    verdicts[pid] = isExpired;
+}
+
+void LeaseCheck::judgeOwners(const PoolState &pool) {
+    int count = std::clamp(pool.currentCount, 0, PoolState::MAX_CLIENTS);
+    for (int i = 0; i < count; i++) {
+        judge(pool.ownerPids[i]);
+    }
+}
+
+bool LeaseCheck::expired(int32_t pid) const {
+    auto verdict = verdicts.find(pid);
+    return verdict != verdicts.end() && verdict->second;
+}
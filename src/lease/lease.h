@@ -0,0 +1,58 @@
+#ifndef SWIMMING_POOL_LEASE_H
+#define SWIMMING_POOL_LEASE_H
+
+#include "shared_memory.h"
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+// Places in the pools are leased to the process that took them. The process holds a slot of the
+// lease table and renews its heartbeat with one relaxed store; a reaper (see Pool::reclaimExpired)
+// gives back the places of processes that died or stopped renewing, so a SIGKILLed visitor does not
+// keep its place until the pool is evacuated.
+class Leases {
+private:
+    static std::atomic<ClientLease *> processLease;
+
+    static ClientLease *claimSlot();
+
+public:
+    // Real time without a heartbeat after which a lease is taken as expired
+    static constexpr uint64_t TTL_NS = 5000000000ull;
+
+    // Claims the process's lease on its first place and renews it. Called before the pool semaphore
+    // is taken, so the slot search never runs inside the critical section.
+    static void hold();
+
+    // Cheap enough for every pass of a visitor's loop; does nothing before hold()
+    static void renew();
+
+    // Gives the slot back once the visitor has left for good; also run at process exit
+    static void release();
+};
+
+// Verdicts on the owners of pool places for one reaper pass. Built from a copy of the lease table,
+// so every pool is judged against the same moment. All kill(pid, 0) calls happen while judging, before
+// the pool semaphore is taken; under it expired() only looks the verdict up.
+class LeaseCheck {
+private:
+    uint64_t nowNs;
+    std::unordered_map<int32_t, uint64_t> heartbeats;
+    std::unordered_map<int32_t, bool> verdicts;
+
+    void judge(int32_t pid);
+
+public:
+    // Judges every process holding a slot of the table
+    LeaseCheck(const LeaseTable &table, uint64_t nowNs);
+
+    // Judges the owners of the pool's places from an unlocked look at its roster, which catches the
+    // processes without a slot (the table was full)
+    void judgeOwners(const PoolState &pool);
+
+    // An owner whose process is gone, or whose lease went without a heartbeat for TTL_NS. 0 (no owner)
+    // and owners admitted after judging never expire in this pass.
+    bool expired(int32_t pid) const;
+};
+
+#endif
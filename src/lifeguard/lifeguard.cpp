@@ -1,6 +1,13 @@
 #include "lifeguard.h"
 #include "working_hours_manager.h"
 #include "error_handler.h"
+#include "metrics.h"
+#include "event_log.h"
+#include "tracer.h"
+#include "latency_histogram.h"
+#include "sim_clock.h"
+#include "shutdown_coordinator.h"
+#include "heartbeat.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -8,16 +15,18 @@
 #include <unistd.h>
 #include <csignal>
 #include <cstdlib>
+#include <poll.h>
 
 Lifeguard::Lifeguard(Pool *pool) : pool(pool), poolClosed(false), isEmergency(false), shouldRun(true), isMaintenance(false) {
     try {
         checkSystemCall(pthread_mutex_init(&stateMutex, nullptr),
                         "Failed to initialize state mutex");
 
-        semId = semget(SEM_KEY, SEM_COUNT, 0666);
+        semId = semget(IpcKeys::key(SEM_KEY), SEM_COUNT, 0666);
         checkSystemCall(semId, "semget failed in Lifeguard");
 
         setupSocketServer();
+        setupHandoffSocket();
         acceptThread = std::thread(&Lifeguard::acceptClientLoop, this);
 
     } catch (const std::exception &e) {
@@ -36,11 +45,13 @@ Lifeguard::~Lifeguard() {
         close(socket);
     }
     close(serverSocket);
+    close(handoffSocket);
     std::filesystem::remove(socketPath);
+    std::filesystem::remove(handoffPath);
 }
 
 std::string Lifeguard::generateSocketPath() {
-    return "/tmp/pool_" + std::to_string(static_cast<int>(pool->getType())) + ".sock";
+    return IpcKeys::socketPath(static_cast<int>(pool->getType()));
 }
 
 void Lifeguard::setupSocketServer() {
@@ -68,9 +79,119 @@ void Lifeguard::setupSocketServer() {
     }
 }
 
+void Lifeguard::setupHandoffSocket() {
+    handoffPath = IpcKeys::handoffPath(static_cast<int>(pool->getType()));
+    std::filesystem::remove(handoffPath);
+
+    handoffSocket = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (handoffSocket == -1) {
+        throw PoolError("Nie można utworzyć socketa przekazywania klientów");
+    }
+
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, handoffPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (bind(handoffSocket, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        close(handoffSocket);
+        throw PoolError("Nie można dowiązać socketa przekazywania klientów");
+    }
+}
+
+bool Lifeguard::handOff(int clientSocket, int targetPool) {
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::string path = IpcKeys::handoffPath(targetPool);
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    char payload = 0;
+    struct iovec iov{&payload, sizeof(payload)};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+    struct msghdr message{};
+    message.msg_name = &addr;
+    message.msg_namelen = sizeof(addr);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &clientSocket, sizeof(int));
+
+    if (sendmsg(handoffSocket, &message, MSG_NOSIGNAL) != sizeof(payload)) {
+        EventLog::log(LOG_HANDOFF_FAILED, pool->getType(), targetPool, errno, errno);
+        return false;
+    }
+    return true;
+}
+
+void Lifeguard::adoptConnection() {
+    char payload;
+    struct iovec iov{&payload, sizeof(payload)};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+    struct msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    if (recvmsg(handoffSocket, &message, MSG_DONTWAIT) <= 0) {
+        return;
+    }
+    struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+    if (!header || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+        return;
+    }
+    int clientSocket;
+    memcpy(&clientSocket, CMSG_DATA(header), sizeof(int));
+
+    std::lock_guard<std::mutex> lock(clientSocketsMutex);
+    clientSockets.push_back(clientSocket);
+
+    // The visitor was let in before the pool closed, but may have missed the notice while in transit
+    if (poolClosed.load()) {
+        int action = pool->getState()->isUnderMaintenance ? LIFEGUARD_ACTION_MAINTENANCE : LIFEGUARD_ACTION_EVAC;
+        LifeguardMessage msg{static_cast<LifeguardMessage::Action>(action), static_cast<int>(pool->getType())};
+        send(clientSocket, &msg, sizeof(msg), MSG_NOSIGNAL);
+    }
+}
+
+void Lifeguard::handleRequest(int clientSocket) {
+    std::lock_guard<std::mutex> lock(clientSocketsMutex);
+    auto it = std::find(clientSockets.begin(), clientSockets.end(), clientSocket);
+    if (it == clientSockets.end()) {
+        return;
+    }
+
+    LifeguardRequest request{};
+    ssize_t received = recv(clientSocket, &request, sizeof(request), MSG_DONTWAIT);
+    if (received == sizeof(request) && request.action == LIFEGUARD_REQUEST_HANDOFF) {
+        if (request.poolId == static_cast<int>(pool->getType()) || request.poolId < 0 ||
+            request.poolId >= POOL_COUNT) {
+            return;
+        }
+        // The visitor already listens for the new pool; if the descriptor cannot be passed on, hanging
+        // up makes it reconnect there rather than stay subscribed to a pool it has left
+        handOff(clientSocket, request.poolId);
+    } else if (received != 0 && (received != -1 || errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    }
+    // Handed off (the descriptor in flight keeps the connection open), handoff failed or hung up
+    close(clientSocket);
+    clientSockets.erase(it);
+}
+
 void Lifeguard::notifyClients(int action) {
+    LatencyScope latency(LATENCY_OP_NOTIFY_CLIENTS);
+    TraceScope trace(TRACE_NOTIFY_CLIENTS, static_cast<int>(pool->getType()), action);
     std::lock_guard<std::mutex> lock(clientSocketsMutex);
     std::vector<int> socketsToRemove;
+    trace.setResult(static_cast<int64_t>(clientSockets.size()));
 
     try {
         if (action == LIFEGUARD_ACTION_RETURN) {
@@ -107,9 +228,7 @@ void Lifeguard::notifyClients(int action) {
             if (it != clientSockets.end()) {
                 close(socketToRemove);
                 clientSockets.erase(it);
-                std::cout << "Removed disconnected client socket from pool "
-                          << pool->getName() << ". Remaining clients: "
-                          << clientSockets.size() << std::endl;
+                EventLog::log(LOG_SOCKET_REMOVED, pool->getType(), clientSockets.size());
             }
         }
     } catch (const std::exception &e) {
@@ -140,7 +259,7 @@ void Lifeguard::removeInactiveClients() {
 }
 
 void Lifeguard::handleEmergency() {
-    std::cout << "EMERGENCY: Immediate pool evacuation required for pool " << pool->getName() << std::endl;
+    EventLog::log(LOG_EMERGENCY_STARTED, pool->getType());
     closePool();
     isEmergency.store(true);
 
@@ -148,11 +267,11 @@ void Lifeguard::handleEmergency() {
     int waitTime = 0;
 
     while (!pool->isEmpty() && waitTime < EMERGENCY_WAIT_TIME) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        SimClock::sleepFor(std::chrono::seconds(1));
         waitTime++;
     }
 
-    std::cout << "EMERGENCY: Emergency ended for pool " << pool->getName() << std::endl;
+    EventLog::log(LOG_EMERGENCY_ENDED, pool->getType());
 
     isEmergency.store(false);
     openPool();
@@ -164,9 +283,9 @@ void Lifeguard::handleEmergency() {
 
 void Lifeguard::closePool() {
     if (pool->getState()->isUnderMaintenance) {
-        std::cout << "Ratownik: zamykanie basenu " << pool->getName() << " z powodu nadchodzącej konserwacji" << std::endl;
+        EventLog::log(LOG_POOL_CLOSING_FOR_MAINTENANCE, pool->getType());
     } else {
-        std::cout << "Ratownik: Ewakuacja basenu " << pool->getName() << "!" << std::endl;
+        EventLog::log(LOG_POOL_EVACUATION, pool->getType());
     }
     poolClosed.store(true);
 
@@ -175,20 +294,24 @@ void Lifeguard::closePool() {
     pthread_mutex_unlock(&stateMutex);
 
     int action = pool->getState()->isUnderMaintenance ? LIFEGUARD_ACTION_MAINTENANCE : LIFEGUARD_ACTION_EVAC;
+    if (action == LIFEGUARD_ACTION_EVAC) {
+        Metrics::evacuation(static_cast<int>(pool->getType()));
+        Tracer::instant(TRACE_EVACUATION, 0, static_cast<int>(pool->getType()));
+    }
     notifyClients(action);
 }
 
 void Lifeguard::openPool() {
     if (!WorkingHoursManager::isOpen()) {
-        std::cout << "Cannot open pool - outside working hours" << std::endl;
+        EventLog::log(LOG_POOL_CANNOT_OPEN_HOURS);
         return;
     }
 
     if (isEmergency.load()) {
-        std::cout << "Cannot open pool - emergency situation active" << std::endl;
+        EventLog::log(LOG_POOL_CANNOT_OPEN_EMERGENCY);
         return;
     }
-    std::cout << "Ratownik: Ponowne otwarcie " << pool->getName() << "!" << std::endl;
+    EventLog::log(LOG_POOL_REOPENED, pool->getType());
 
     poolClosed.store(false);
 
@@ -200,26 +323,25 @@ void Lifeguard::openPool() {
 }
 
 void Lifeguard::run() {
-    signal(SIGTERM, [](int) { exit(0); });
     bool hasGivenSomeTime = false;
 
     try {
-        while (true) {
+        while (!ShutdownCoordinator::stopRequested()) {
             if (pool->getState()->isUnderMaintenance) {
                 isMaintenance.store(true);
-                std::cout << "Zamykamy basen na konserwacje!" << std::endl;
+                EventLog::log(LOG_POOL_MAINTENANCE);
                 closePool();
-                std::this_thread::sleep_for(std::chrono::seconds (1));
+                SimClock::sleepFor(std::chrono::seconds(1));
                 continue;
             } else if (poolClosed.load()) {
                 openPool();
-                std::this_thread::sleep_for(std::chrono::seconds (1));
+                SimClock::sleepFor(std::chrono::seconds(1));
                 continue;
             }
             if (!WorkingHoursManager::isOpen()) {
-                std::cout << "Poza godzinami pracy" << std::endl;
+                EventLog::log(LOG_OUTSIDE_WORKING_HOURS);
                 pool->getState()->isClosed = true;
-                std::this_thread::sleep_for(std::chrono::seconds (1));
+                SimClock::sleepFor(std::chrono::seconds(1));
                 continue;
             }
             if (!isMaintenance && !pool->getState()->isUnderMaintenance && !isEmergency && pool->getState()->isClosed) {
@@ -228,7 +350,7 @@ void Lifeguard::run() {
 
             if (!hasGivenSomeTime) {
 //    give the clients some time before closing the pool
-                sleep(5);
+                SimClock::sleepFor(std::chrono::seconds(5));
                 hasGivenSomeTime = true;
             }
 
@@ -240,7 +362,7 @@ void Lifeguard::run() {
             if (!isEmergency.load()) {
                 if (rand() % 100 < 10 && !poolClosed.load()) {
                     closePool();
-                    std::this_thread::sleep_for(std::chrono::seconds(5));
+                    SimClock::sleepFor(std::chrono::seconds(5));
                     openPool();
                 }
 
@@ -249,7 +371,7 @@ void Lifeguard::run() {
                 }
             }
 
-            std::this_thread::sleep_for(std::chrono::seconds(3));
+            SimClock::sleepFor(std::chrono::seconds(3));
         }
     } catch (const std::exception &e) {
         std::cerr << "Fatal error in lifeguard: " << e.what() << std::endl;
@@ -258,19 +380,34 @@ void Lifeguard::run() {
 }
 
 void Lifeguard::acceptClientLoop() {
-    fd_set readfds;
-    struct timeval tv;
+    std::vector<struct pollfd> fds;
+    auto watched = static_cast<WatchedRole>(WATCH_LIFEGUARD_OLYMPIC + static_cast<int>(pool->getType()));
+    Heartbeat::attach(watched);
 
     while (shouldRun.load()) {
-        FD_ZERO(&readfds);
-        FD_SET(serverSocket, &readfds);
+        Heartbeat::beat(watched);
+        fds.clear();
+        fds.push_back({serverSocket, POLLIN, 0});
+        fds.push_back({handoffSocket, POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> lock(clientSocketsMutex);
+            for (int clientSocket: clientSockets) {
+                fds.push_back({clientSocket, POLLIN, 0});
+            }
+        }
 
-        tv.tv_sec = 1;
-        tv.tv_usec = 0;
+        int result = poll(fds.data(), fds.size(), 1000);
 
-        int result = select(serverSocket + 1, &readfds, nullptr, nullptr, &tv);
+        if (result > 0 && (fds[1].revents & POLLIN)) {
+            adoptConnection();
+        }
+        for (size_t i = 2; result > 0 && i < fds.size(); i++) {
+            if (fds[i].revents) {
+                handleRequest(fds[i].fd);
+            }
+        }
 
-        if (result > 0 && FD_ISSET(serverSocket, &readfds)) {
+        if (result > 0 && (fds[0].revents & POLLIN)) {
             struct sockaddr_un clientAddr{};
             socklen_t clientLen = sizeof(clientAddr);
 
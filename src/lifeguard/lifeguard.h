@@ -26,14 +26,20 @@ private:
     std::string socketPath;
     std::string generateSocketPath();
     void setupSocketServer();
-    void notifyClients(int action);
+
+    // Connections of visitors transferred from other pools arrive here as SCM_RIGHTS descriptors
+    int handoffSocket;
+    std::string handoffPath;
+    void setupHandoffSocket();
+    void adoptConnection();
+    bool handOff(int clientSocket, int targetPool);
+    void handleRequest(int clientSocket);
 
     std::thread acceptThread;
     void acceptClientLoop();
     std::atomic<bool> shouldRun;
 
     std::mutex clientSocketsMutex;
-    void removeInactiveClients();
 
 public:
     explicit Lifeguard(Pool* pool);
@@ -43,6 +49,9 @@ public:
     void run();
     void closePool();
     void openPool();
+    void notifyClients(int action);
+    // Closes the server side of connections whose visitors have hung up
+    void removeInactiveClients();
 
     Lifeguard(const Lifeguard&) = delete;
     Lifeguard& operator=(const Lifeguard&) = delete;
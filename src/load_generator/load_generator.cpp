@@ -0,0 +1,404 @@
+#include "load_generator.h"
+#include "error_handler.h"
+#include "sim_clock.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace {
+    struct ModelSpec {
+        std::string name;
+        std::map<std::string, std::string> params;
+    };
+
+    ModelSpec parseSpec(const std::string &spec) {
+        ModelSpec result;
+        size_t colon = spec.find(':');
+        result.name = spec.substr(0, colon);
+        if (colon == std::string::npos) {
+            return result;
+        }
+
+        std::stringstream params(spec.substr(colon + 1));
+        std::string param;
+        while (std::getline(params, param, ',')) {
+            size_t equals = param.find('=');
+            if (equals == std::string::npos) {
+                throw PoolError("Invalid parameter '" + param + "' in " + spec);
+            }
+            result.params[param.substr(0, equals)] = param.substr(equals + 1);
+        }
+        return result;
+    }
+
+    double numberParam(const ModelSpec &spec, const std::string &name, double defaultValue) {
+        auto it = spec.params.find(name);
+        if (it == spec.params.end()) {
+            return defaultValue;
+        }
+        try {
+            return std::stod(it->second);
+        } catch (const std::exception &) {
+            throw PoolError("Invalid value for " + name + ": " + it->second);
+        }
+    }
+
+    double positiveParam(const ModelSpec &spec, const std::string &name, double defaultValue) {
+        double value = numberParam(spec, name, defaultValue);
+        if (value <= 0) {
+            throw PoolError("Parameter " + name + " of " + spec.name + " must be positive");
+        }
+        return value;
+    }
+
+    double exponential(std::mt19937_64 &rng, double rate) {
+        return std::exponential_distribution<double>(rate)(rng);
+    }
+
+    class PeriodicArrivals : public ArrivalModel {
+        double rate;
+        bool started = false;
+
+    public:
+        explicit PeriodicArrivals(double rate) : rate(rate) {}
+
+        bool next(double now, std::mt19937_64 &, Arrival &arrival) override {
+            arrival.time = started ? now + 1.0 / rate : 0.0;
+            arrival.hasProfile = false;
+            started = true;
+            return true;
+        }
+
+        double targetRate(double) const override { return rate; }
+
+        std::string describe() const override { return "periodic " + std::to_string(rate) + "/s"; }
+    };
+
+    class PoissonArrivals : public ArrivalModel {
+        double rate;
+
+    public:
+        explicit PoissonArrivals(double rate) : rate(rate) {}
+
+        bool next(double now, std::mt19937_64 &rng, Arrival &arrival) override {
+            arrival.time = now + exponential(rng, rate);
+            arrival.hasProfile = false;
+            return true;
+        }
+
+        double targetRate(double) const override { return rate; }
+
+        std::string describe() const override { return "poisson " + std::to_string(rate) + "/s"; }
+    };
+
+    // Two-state Markov-modulated Poisson process: quiet periods alternating with bursts
+    class MmppArrivals : public ArrivalModel {
+        double rates[2];
+        double meanDurations[2];
+        int state = 0;
+        double stateEnd = -1;
+
+    public:
+        MmppArrivals(double lowRate, double highRate, double lowDuration, double highDuration)
+                : rates{lowRate, highRate}, meanDurations{lowDuration, highDuration} {}
+
+        bool next(double now, std::mt19937_64 &rng, Arrival &arrival) override {
+            if (stateEnd < 0) {
+                stateEnd = now + exponential(rng, 1.0 / meanDurations[state]);
+            }
+
+            double time = now;
+            while (true) {
+                double candidate = time + exponential(rng, rates[state]);
+                if (candidate <= stateEnd) {
+                    arrival.time = candidate;
+                    arrival.hasProfile = false;
+                    return true;
+                }
+                time = stateEnd;
+                state = 1 - state;
+                stateEnd = time + exponential(rng, 1.0 / meanDurations[state]);
+            }
+        }
+
+        double targetRate(double) const override {
+            return (rates[0] * meanDurations[0] + rates[1] * meanDurations[1]) /
+                   (meanDurations[0] + meanDurations[1]);
+        }
+
+        std::string describe() const override {
+            return "mmpp " + std::to_string(rates[0]) + "/s <-> " + std::to_string(rates[1]) + "/s";
+        }
+    };
+
+    // Non-homogeneous Poisson process over the local hour of day, sampled by thinning
+    class TimeOfDayArrivals : public ArrivalModel {
+        double hourlyRates[24];
+        double maxRate;
+        mutable time_t startWallClock;      // -1 until the first use reads the simulated clock
+
+        int hourAt(double time) const {
+            if (startWallClock < 0) {
+                startWallClock = SimClock::now();
+            }
+            time_t wallClock = startWallClock + static_cast<time_t>(time);
+            struct tm timeinfo{};
+            localtime_r(&wallClock, &timeinfo);
+            return timeinfo.tm_hour;
+        }
+
+    public:
+        TimeOfDayArrivals(const std::map<int, double> &rateFromHour, time_t startWallClock)
+                : startWallClock(startWallClock) {
+            for (int hour = 0; hour < 24; hour++) {
+                auto it = rateFromHour.upper_bound(hour);
+                hourlyRates[hour] = it == rateFromHour.begin() ? rateFromHour.rbegin()->second
+                                                               : std::prev(it)->second;
+            }
+            maxRate = *std::max_element(hourlyRates, hourlyRates + 24);
+        }
+
+        bool next(double now, std::mt19937_64 &rng, Arrival &arrival) override {
+            if (maxRate <= 0) {
+                return false;
+            }
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            double time = now;
+            do {
+                time += exponential(rng, maxRate);
+            } while (uniform(rng) * maxRate > hourlyRates[hourAt(time)]);
+
+            arrival.time = time;
+            arrival.hasProfile = false;
+            return true;
+        }
+
+        double targetRate(double now) const override { return hourlyRates[hourAt(now)]; }
+
+        std::string describe() const override { return "time-of-day profile, peak " + std::to_string(maxRate) + "/s"; }
+    };
+
+    // Replays "<offset seconds> [age vip childAge childHasDiaper]" lines; childAge 0 means no child
+    class TraceArrivals : public ArrivalModel {
+        std::vector<Arrival> arrivals;
+        size_t position = 0;
+        std::string path;
+
+    public:
+        explicit TraceArrivals(const std::string &path) : path(path) {
+            std::ifstream trace(path);
+            if (!trace) {
+                throw PoolError("Cannot open arrival trace " + path);
+            }
+
+            std::string line;
+            while (std::getline(trace, line)) {
+                if (line.empty() || line[0] == '#') {
+                    continue;
+                }
+                std::istringstream fields(line);
+                Arrival arrival{};
+                if (!(fields >> arrival.time)) {
+                    throw PoolError("Invalid arrival trace line: " + line);
+                }
+                int vip = 0;
+                int childDiaper = 0;
+                if (fields >> arrival.profile.age >> vip >> arrival.profile.childAge >> childDiaper) {
+                    arrival.hasProfile = true;
+                    arrival.profile.isVip = vip != 0;
+                    arrival.profile.isGuardian = arrival.profile.childAge > 0;
+                    arrival.profile.childHasSwimDiaper = childDiaper != 0;
+                }
+                arrivals.push_back(arrival);
+            }
+
+            std::stable_sort(arrivals.begin(), arrivals.end(), [](const Arrival &a, const Arrival &b) {
+                return a.time < b.time;
+            });
+        }
+
+        bool next(double, std::mt19937_64 &, Arrival &arrival) override {
+            if (position >= arrivals.size()) {
+                return false;
+            }
+            arrival = arrivals[position++];
+            return true;
+        }
+
+        double targetRate(double) const override {
+            if (arrivals.empty() || arrivals.back().time <= 0) {
+                return 0.0;
+            }
+            return arrivals.size() / arrivals.back().time;
+        }
+
+        std::string describe() const override {
+            return "trace " + path + " (" + std::to_string(arrivals.size()) + " arrivals)";
+        }
+    };
+}
+
+std::unique_ptr<ArrivalModel> ArrivalModel::create(const std::string &spec, time_t startWallClock) {
+    ModelSpec parsed = parseSpec(spec);
+
+    if (parsed.name == "periodic") {
+        return std::make_unique<PeriodicArrivals>(positiveParam(parsed, "rate", 1.0));
+    }
+    if (parsed.name == "poisson") {
+        return std::make_unique<PoissonArrivals>(positiveParam(parsed, "rate", 1.0));
+    }
+    if (parsed.name == "mmpp") {
+        return std::make_unique<MmppArrivals>(positiveParam(parsed, "low", 0.5),
+                                              positiveParam(parsed, "high", 5.0),
+                                              positiveParam(parsed, "low-duration", 60.0),
+                                              positiveParam(parsed, "high-duration", 10.0));
+    }
+    if (parsed.name == "profile") {
+        std::map<int, double> rateFromHour;
+        for (const auto &param: parsed.params) {
+            int hour = atoi(param.first.c_str());
+            if (hour < 0 || hour > 23) {
+                throw PoolError("Invalid hour in arrival profile: " + param.first);
+            }
+            rateFromHour[hour] = std::max(0.0, numberParam(parsed, param.first, 0.0));
+        }
+        if (rateFromHour.empty()) {
+            throw PoolError("Arrival profile needs at least one hour=rate entry");
+        }
+        return std::make_unique<TimeOfDayArrivals>(rateFromHour, startWallClock);
+    }
+    if (parsed.name == "trace") {
+        auto file = parsed.params.find("file");
+        if (file == parsed.params.end()) {
+            throw PoolError("Trace arrival model needs file=path");
+        }
+        return std::make_unique<TraceArrivals>(file->second);
+    }
+
+    throw PoolError("Unknown arrival model: " + parsed.name);
+}
+
+DemographicMix DemographicMix::parse(const std::string &spec) {
+    ModelSpec parsed = parseSpec("mix:" + spec);
+    DemographicMix mix;
+    for (const auto &param: parsed.params) {
+        double share = numberParam(parsed, param.first, 0.0);
+        if (share < 0 || share > 1) {
+            throw PoolError("Share " + param.first + " must be between 0 and 1");
+        }
+        if (param.first == "guardian") {
+            mix.guardianShare = share;
+        } else if (param.first == "vip") {
+            mix.vipShare = share;
+        } else if (param.first == "diaper-forget") {
+            mix.diaperForgetShare = share;
+        } else {
+            throw PoolError("Unknown demographic share: " + param.first);
+        }
+    }
+    return mix;
+}
+
+void DemographicMix::fill(VisitorProfile &profile, std::mt19937_64 &rng) const {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    profile.isGuardian = uniform(rng) < guardianShare;
+    profile.age = profile.isGuardian ? 18 + static_cast<int>(rng() % 52) : 10 + static_cast<int>(rng() % 60);
+    profile.isVip = uniform(rng) < vipShare;
+    profile.childAge = 1 + static_cast<int>(rng() % 9);
+    profile.childHasSwimDiaper = profile.childAge <= 3 && uniform(rng) >= diaperForgetShare;
+}
+
+LoadGenerator::LoadGenerator(std::unique_ptr<ArrivalModel> model, const DemographicMix &mix, uint64_t seed,
+                             double reportIntervalS)
+        : model(std::move(model)), mix(mix), rng(seed), start(Clock::now()), speed(SimClock::speed()),
+          pending{}, hasPending(false),
+          reportIntervalS(reportIntervalS), windowStart(0), windowScheduled(0), windowSpawned(0), windowDropped(0),
+          windowTargetSum(0), windowTargetSamples(0), windowMaxLagMs(0), windowLagSumMs(0) {
+    std::cout << "Arrival model: " << this->model->describe() << std::endl;
+}
+
+double LoadGenerator::elapsed() const {
+    return std::chrono::duration<double>(Clock::now() - start).count() * speed;
+}
+
+bool LoadGenerator::sleepUntil(double time, const std::atomic<bool> &shouldRun) const {
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(time / speed));
+    while (shouldRun.load()) {
+        auto now = Clock::now();
+        if (now >= deadline) {
+            return true;
+        }
+        // Bounded absolute sleeps keep the wake-up precise while still noticing shutdown
+        std::this_thread::sleep_until(std::min(deadline, now + std::chrono::milliseconds(200)));
+    }
+    return false;
+}
+
+bool LoadGenerator::waitForNextVisitor(int &nextId, VisitorProfile &profile, const std::atomic<bool> &shouldRun) {
+    if (!hasPending) {
+        double previous = pending.time;
+        if (!model->next(previous, rng, pending)) {
+            return false;
+        }
+        hasPending = true;
+    }
+
+    if (!sleepUntil(pending.time, shouldRun)) {
+        return false;
+    }
+    hasPending = false;
+
+    double now = elapsed();
+    // Lag is what spawning costs, so it is reported in real time
+    double lagMs = (now - pending.time) * 1000.0 / speed;
+    windowScheduled++;
+    windowLagSumMs += lagMs;
+    windowMaxLagMs = std::max(windowMaxLagMs, lagMs);
+    windowTargetSum += model->targetRate(pending.time);
+    windowTargetSamples++;
+
+    if (pending.hasProfile) {
+        profile = pending.profile;
+    } else {
+        mix.fill(profile, rng);
+    }
+    profile.id = nextId++;
+    profile.childId = profile.isGuardian ? nextId++ : -1;
+    return true;
+}
+
+void LoadGenerator::recordSpawn(bool spawned, bool dropped) {
+    if (spawned) {
+        windowSpawned++;
+    } else if (dropped) {
+        windowDropped++;
+    }
+
+    double now = elapsed();
+    if (now - windowStart >= reportIntervalS * speed) {
+        report(now);
+    }
+}
+
+void LoadGenerator::report(double now) {
+    double window = now - windowStart;
+    std::cout << "Arrivals over " << window << " s: target " << windowTargetSum / std::max<uint64_t>(1, windowTargetSamples)
+              << "/s, scheduled " << windowScheduled / window << "/s, spawned " << windowSpawned / window << "/s, dropped " << windowDropped / window
+              << "/s, spawn lag avg " << windowLagSumMs / std::max<uint64_t>(1, windowScheduled)
+              << " ms, max " << windowMaxLagMs << " ms" << std::endl;
+
+    windowStart = now;
+    windowScheduled = 0;
+    windowSpawned = 0;
+    windowDropped = 0;
+    windowTargetSum = 0;
+    windowTargetSamples = 0;
+    windowMaxLagMs = 0;
+    windowLagSumMs = 0;
+}
@@ -0,0 +1,99 @@
+#ifndef SWIMMING_POOL_LOAD_GENERATOR_H
+#define SWIMMING_POOL_LOAD_GENERATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+struct VisitorProfile {
+    int id;
+    int age;
+    bool isVip;
+    bool isGuardian;
+    int childId;
+    int childAge;
+    bool childHasSwimDiaper;
+};
+
+struct DemographicMix {
+    double guardianShare = 0.2;
+    double vipShare = 0.2;
+    double diaperForgetShare = 0.2;
+
+    static DemographicMix parse(const std::string &spec);
+
+    // Draws age, VIP status and an optional accompanied child
+    void fill(VisitorProfile &profile, std::mt19937_64 &rng) const;
+};
+
+struct Arrival {
+    double time;                // seconds since the generator started
+    bool hasProfile;            // trace arrivals may carry their own demographics
+    VisitorProfile profile;
+};
+
+class ArrivalModel {
+public:
+    virtual ~ArrivalModel() = default;
+
+    // Returns false once the model has no further arrivals
+    virtual bool next(double now, std::mt19937_64 &rng, Arrival &arrival) = 0;
+
+    virtual double targetRate(double now) const = 0;
+
+    virtual std::string describe() const = 0;
+
+    // periodic:rate=1, poisson:rate=2, mmpp:low=0.5,high=5,low-duration=60,high-duration=10,
+    // profile:8=1,12=4,17=2 (visitors/s from the given local hour), trace:file=arrivals.txt.
+    // Time 0 of the model is startWallClock, by default the simulated time when the model is first
+    // asked for an arrival, so it may be created before SimClock::initialize().
+    static std::unique_ptr<ArrivalModel> create(const std::string &spec, time_t startWallClock = -1);
+};
+
+// Schedules visitor arrivals from an ArrivalModel on absolute monotonic deadlines, so spawn latency
+// does not accumulate into drift, and periodically reports the achieved versus the target rate.
+// Arrival times and rates are in simulated seconds, compressed by the SimClock speed.
+class LoadGenerator {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::unique_ptr<ArrivalModel> model;
+    DemographicMix mix;
+    std::mt19937_64 rng;
+    Clock::time_point start;
+    double speed;
+    Arrival pending;
+    bool hasPending;
+
+    double reportIntervalS;
+    double windowStart;
+    uint64_t windowScheduled;
+    uint64_t windowSpawned;
+    uint64_t windowDropped;
+    double windowTargetSum;
+    uint64_t windowTargetSamples;
+    double windowMaxLagMs;
+    double windowLagSumMs;
+
+    double elapsed() const;
+
+    bool sleepUntil(double time, const std::atomic<bool> &shouldRun) const;
+
+    void report(double now);
+
+public:
+    LoadGenerator(std::unique_ptr<ArrivalModel> model, const DemographicMix &mix, uint64_t seed,
+                  double reportIntervalS = 10.0);
+
+    bool waitForNextVisitor(int &nextId, VisitorProfile &profile, const std::atomic<bool> &shouldRun);
+
+    // dropped: turned away by the spawner's backpressure; counted apart from spawned, so the report
+    // shows how much of the scheduled load actually arrived
+    void recordSpawn(bool spawned, bool dropped = false);
+};
+
+#endif
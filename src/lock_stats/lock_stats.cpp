@@ -0,0 +1,98 @@
+#include "lock_stats.h"
+#include "metrics.h"
+#include <cerrno>
+#include <unistd.h>
+
+#if POOL_LOCK_STATS
+namespace {
+    int bucketOf(uint64_t ns) {
+        int bucket = ns < 2 ? 0 : 63 - __builtin_clzll(ns);
+        return bucket < LockHistogram::BUCKETS ? bucket : LockHistogram::BUCKETS - 1;
+    }
+
+    void add(LockHistogram &histogram, uint64_t ns) {
+        histogram.counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        histogram.sumNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    int currentRole = static_cast<int>(ProcessRole::Main);
+
+    // Per thread, as the thread that takes a semaphore is the one that gives it back
+    thread_local uint64_t acquiredAtNs[SEM_COUNT];
+}
+
+void LockStats::setRole(ProcessRole role) {
+    currentRole = static_cast<int>(role);
+}
+
+int LockStats::acquire(int semId, unsigned short semaphore, short flags) {
+    uint64_t start = Metrics::nowNs();
+    struct sembuf op = {semaphore, -1, static_cast<short>(flags | IPC_NOWAIT)};
+    bool contended = false;
+    int result = semop(semId, &op, 1);
+    if (result == -1 && errno == EAGAIN && !(flags & IPC_NOWAIT)) {
+        contended = true;
+        op.sem_flg = flags;
+        result = semop(semId, &op, 1);
+    }
+    if (result == -1) {
+        return result;
+    }
+
+    uint64_t acquired = Metrics::nowNs();
+    acquiredAtNs[semaphore] = acquired;
+    Metrics::lockWait(semaphore, acquired - start);
+
+    SharedMemory *shm = SharedSegment::get();
+    if (shm && semaphore < SEM_COUNT) {
+        LockCounters &lock = shm->locks[semaphore];
+        lock.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (contended) {
+            lock.contended.fetch_add(1, std::memory_order_relaxed);
+        }
+        add(lock.wait, acquired - start);
+        lock.acquisitionsByRole[currentRole].fetch_add(1, std::memory_order_relaxed);
+        lock.holderRole.store(currentRole, std::memory_order_relaxed);
+        lock.holderPid.store(getpid(), std::memory_order_relaxed);
+    }
+    return result;
+}
+
+int LockStats::release(int semId, unsigned short semaphore, short flags) {
+    SharedMemory *shm = SharedSegment::get();
+    if (shm && semaphore < SEM_COUNT) {
+        uint64_t held = Metrics::nowNs() - acquiredAtNs[semaphore];
+        LockCounters &lock = shm->locks[semaphore];
+        add(lock.hold, held);
+        lock.holdNsByRole[currentRole].fetch_add(held, std::memory_order_relaxed);
+        lock.holderPid.store(0, std::memory_order_relaxed);
+    }
+
+    struct sembuf op = {semaphore, 1, flags};
+    return semop(semId, &op, 1);
+}
+#endif
+
+uint64_t LockStats::count(const LockHistogram &histogram) {
+    uint64_t total = 0;
+    for (const auto &bucket: histogram.counts) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t LockStats::percentileNs(const LockHistogram &histogram, double fraction) {
+    uint64_t total = count(histogram);
+    if (total == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(fraction * static_cast<double>(total));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < LockHistogram::BUCKETS; bucket++) {
+        seen += histogram.counts[bucket].load(std::memory_order_relaxed);
+        if (seen > rank || seen == total) {
+            return 2ull << bucket;
+        }
+    }
+    return 2ull << (LockHistogram::BUCKETS - 1);
+}
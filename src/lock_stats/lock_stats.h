@@ -0,0 +1,47 @@
+#ifndef SWIMMING_POOL_LOCK_STATS_H
+#define SWIMMING_POOL_LOCK_STATS_H
+
+#include "shared_memory.h"
+#include "process_role.h"
+#include <sys/sem.h>
+
+// Set by CMake (-DPOOL_LOCK_STATS=OFF compiles the instrumentation out)
+#ifndef POOL_LOCK_STATS
+#define POOL_LOCK_STATS 1
+#endif
+
+// The lock layer of the pool and queue semaphores. Every P/V on them goes through acquire/release,
+// which record acquisitions, contended acquisitions, wait and hold time histograms and the holder's
+// role in the shared segment for the monitor. Built without POOL_LOCK_STATS both are a bare semop.
+class LockStats {
+public:
+#if POOL_LOCK_STATS
+    static void setRole(ProcessRole role);
+
+    // semop(-1) on one semaphore of the set; the result and errno are semop's
+    static int acquire(int semId, unsigned short semaphore, short flags);
+
+    static int release(int semId, unsigned short semaphore, short flags);
+#else
+    static void setRole(ProcessRole) {}
+
+    static int acquire(int semId, unsigned short semaphore, short flags) {
+        struct sembuf op = {semaphore, -1, flags};
+        return semop(semId, &op, 1);
+    }
+
+    static int release(int semId, unsigned short semaphore, short flags) {
+        struct sembuf op = {semaphore, 1, flags};
+        return semop(semId, &op, 1);
+    }
+#endif
+
+    static constexpr bool enabled() { return POOL_LOCK_STATS != 0; }
+
+    // Upper bound of the bucket holding that fraction of the samples, 0 without samples
+    static uint64_t percentileNs(const LockHistogram &histogram, double fraction);
+
+    static uint64_t count(const LockHistogram &histogram);
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "log_drain.h"
+#include "error_handler.h"
+#include "metrics.h"
+#include "shutdown_coordinator.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    bool hasExited(int32_t owner) {
+        return owner != 0 && kill(owner, 0) == -1 && errno == ESRCH;
+    }
+
+    // Empties every claimed ring into batch, ordered by timestamp. With reclaimExited the rings of
+    // exited processes are handed back; a record the process was writing when it died never gets
+    // its sequence, so the next owner resets the ring instead of the drain waiting for it.
+    template<typename Ring, size_t Count, typename Entry>
+    void collect(Ring (&rings)[Count], bool reclaimExited, std::vector<Entry> &batch, std::string &notes) {
+        for (auto &ring: rings) {
+            int32_t owner = ring.owner.load(std::memory_order_acquire);
+            if (owner == 0) {
+                continue;
+            }
+            bool exited = reclaimExited && hasExited(owner);
+
+            Entry entry{};
+            while (ring.pop(entry)) {
+                batch.push_back(entry);
+            }
+
+            uint64_t dropped = ring.dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                notes += "[log] dropped " + std::to_string(dropped) + " records of process " +
+                         std::to_string(owner) + "\n";
+            }
+
+            if (exited) {
+                ring.owner.store(0, std::memory_order_release);
+            }
+        }
+
+        std::stable_sort(batch.begin(), batch.end(), [](const Entry &a, const Entry &b) {
+            return a.timestampNs < b.timestampNs;
+        });
+    }
+
+    void writeAll(int fd, const std::string &data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t result = write(fd, data.data() + written, data.size() - written);
+            if (result <= 0) {
+                if (result == -1 && errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            written += result;
+        }
+    }
+
+    std::string processName(int32_t pid) {
+        std::ifstream comm("/proc/" + std::to_string(pid) + "/comm");
+        std::string name;
+        std::getline(comm, name);
+        return name.empty() ? "process " + std::to_string(pid) : name;
+    }
+}
+
+LogDrain::LogDrain(const std::string &path, const std::string &tracePath)
+        : fd(STDOUT_FILENO), ownsFd(false), startNs(Metrics::nowNs()), tracePath(tracePath), traceFd(-1) {
+    if (!path.empty()) {
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        checkSystemCall(fd, "Cannot open log file " + path);
+        ownsFd = true;
+    }
+
+    // The trace file is created with the first traced span, a stale one from an earlier run goes now
+    if (!tracePath.empty()) {
+        unlink(tracePath.c_str());
+    }
+}
+
+LogDrain::~LogDrain() {
+    if (ownsFd) {
+        close(fd);
+    }
+    if (traceFd != -1) {
+        close(traceFd);
+    }
+}
+
+bool LogDrain::openTrace() {
+    if (traceFd != -1) {
+        return true;
+    }
+    if (tracePath.empty()) {
+        return false;
+    }
+
+    traceFd = open(tracePath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (traceFd == -1) {
+        return false;
+    }
+
+    struct stat info{};
+    if (fstat(traceFd, &info) == 0 && info.st_size == 0) {
+        writeAll(traceFd, "[\n");
+    }
+    return true;
+}
+
+size_t LogDrain::drainTrace(bool reclaimExited) {
+    TraceSegment *segment = Tracer::getSegment();
+    if (!segment) {
+        return 0;
+    }
+
+    traceBatch.clear();
+    std::string notes;
+    collect(segment->rings, reclaimExited, traceBatch, notes);
+    if (traceBatch.empty() || !openTrace()) {
+        return traceBatch.size();
+    }
+
+    std::string json;
+    for (const auto &entry: traceBatch) {
+        if (namedProcesses.insert(entry.pid).second) {
+            json += R"({"name":"process_name","ph":"M","pid":)" + std::to_string(entry.pid) +
+                    R"(,"args":{"name":")" + processName(entry.pid) + "\"}},\n";
+        }
+        json += Tracer::toJson(entry);
+        json += ",\n";
+    }
+    writeAll(traceFd, json);
+    return traceBatch.size();
+}
+
+size_t LogDrain::drainOnce(bool reclaimExited) {
+    size_t drained = drainTrace(reclaimExited);
+
+    LogSegment *segment = EventLog::getSegment();
+    if (!segment) {
+        return drained;
+    }
+
+    batch.clear();
+    buffer.clear();
+    collect(segment->rings, reclaimExited, batch, buffer);
+
+    for (const auto &entry: batch) {
+        if (ownsFd) {
+            char prefix[48];
+            snprintf(prefix, sizeof(prefix), "%12.6f [%d] ",
+                     static_cast<double>(entry.timestampNs - std::min(entry.timestampNs, startNs)) / 1e9,
+                     entry.pid);
+            buffer += prefix;
+        }
+        buffer += EventLog::format(entry.event, entry.args, entry.argCount);
+        buffer += '\n';
+    }
+
+    writeAll(fd, buffer);
+    return drained + batch.size();
+}
+
+void LogDrain::finishTrace() {
+    if (tracePath.empty() || access(tracePath.c_str(), F_OK) != 0 || !openTrace()) {
+        return;
+    }
+
+    // A closing marker event keeps the array valid JSON despite the trailing separator
+    char closing[160];
+    snprintf(closing, sizeof(closing), R"({"name":"trace_end","ph":"i","s":"g","ts":%.3f,"pid":%d,"tid":%d})" "\n]\n",
+             static_cast<double>(Metrics::nowNs()) / 1000.0, getpid(), getpid());
+    writeAll(traceFd, closing);
+}
+
+void LogDrain::run() {
+    auto lastReclaim = std::chrono::steady_clock::now();
+
+    while (!ShutdownCoordinator::stopRequested()) {
+        auto now = std::chrono::steady_clock::now();
+        bool reclaim = now - lastReclaim >= std::chrono::seconds(1);
+        if (reclaim) {
+            lastReclaim = now;
+        }
+
+        if (drainOnce(reclaim) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    drainOnce();
+}
@@ -0,0 +1,51 @@
+#ifndef SWIMMING_POOL_LOG_DRAIN_H
+#define SWIMMING_POOL_LOG_DRAIN_H
+
+#include "event_log.h"
+#include "tracer.h"
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// The only consumer of the log and trace rings: collects the records of all processes, orders them
+// by timestamp and writes the formatted lines with one write() per pass. Trace spans are appended
+// to a Chrome trace JSON file. Rings of processes that have exited are drained one last time and
+// handed back to the pool.
+class LogDrain {
+private:
+    int fd;
+    bool ownsFd;
+    uint64_t startNs;
+    std::vector<LogEntry> batch;
+    std::string buffer;
+
+    std::string tracePath;
+    int traceFd;
+    std::vector<TraceEntry> traceBatch;
+    std::unordered_set<int32_t> namedProcesses;
+
+    bool openTrace();
+
+    size_t drainTrace(bool reclaimExited);
+
+public:
+    // Writes to the terminal when path is empty, otherwise appends timestamped lines to the file
+    LogDrain(const std::string &path, const std::string &tracePath);
+
+    ~LogDrain();
+
+    LogDrain(const LogDrain &) = delete;
+
+    LogDrain &operator=(const LogDrain &) = delete;
+
+    // Returns the number of records written; with reclaimExited the rings of exited processes are freed
+    size_t drainOnce(bool reclaimExited = false);
+
+    // Terminates the JSON array of the trace file, if anything was traced
+    void finishTrace();
+
+    // Runs until the stop event, the main process drains what is left during shutdown
+    void run();
+};
+
+#endif
@@ -9,38 +9,39 @@
 #include <iostream>
 #include "maintenance_manager.h"
 #include "signal_handler.h"
-#include <sys/wait.h>
+#include "process_registry.h"
+#include "process_reaper.h"
+#include "shutdown_coordinator.h"
+#include "config.h"
+#include "load_generator.h"
+#include "client_spawner.h"
+#include "process_role.h"
+#include "event_log.h"
+#include "log_drain.h"
+#include "tracer.h"
+#include "sim_clock.h"
+#include "lock_stats.h"
+#include "latency_histogram.h"
+#include "lease.h"
+#include "metrics.h"
+#include "watchdog.h"
+#include "queue_policy.h"
+#include "cpu_placement.h"
+#include "shared_segment.h"
 
-#ifdef __APPLE__
-
-#include <pthread.h>
-
-#else
-#include <sys/prctl.h>
-#endif
-
-void setProcessName(const char *name) {
-#ifdef __APPLE__
-    pthread_setname_np(name);
-#else
-    prctl(PR_SET_NAME, name);
-#endif
-}
-
-int shmId = -1;
 int semId = -1;
 int msgId = -1;
 
-std::vector<pid_t> processes;
+ProcessRegistry processes;
 std::atomic<bool> shouldRun(true);
 
-void initializeIPC() {
-    semId = semget(SEM_KEY, SEM_COUNT, 0666);
+void initializeIPC(const SegmentOptions &segment) {
+    semId = semget(IpcKeys::key(SEM_KEY), SEM_COUNT, 0666);
 
-    semId = semget(SEM_KEY, SEM_COUNT, IPC_CREAT | IPC_EXCL | 0666);
+    semId = semget(IpcKeys::key(SEM_KEY), SEM_COUNT, IPC_CREAT | IPC_EXCL | 0666);
     if (semId < 0) {
         if (errno == EEXIST) {
-            semId = semget(SEM_KEY, SEM_COUNT, 0666);
+            semId = semget(IpcKeys::key(SEM_KEY), SEM_COUNT, 0666);
         }
         checkSystemCall(semId, "semget failed with errno=");
     }
@@ -59,17 +60,17 @@ void initializeIPC() {
 
     checkSystemCall(semctl(semId, 0, SETALL, arg), "semctl SETALL failed with errno=");
 
-    shmId = shmget(SHM_KEY, sizeof(SharedMemory), IPC_CREAT | 0666);
-    if (shmId < 0) {
-        perror("shmget failed");
-        exit(1);
-    }
+    SharedSegment::create(segment);
 
-    msgId = msgget(CASHIER_MSG_KEY, IPC_CREAT | 0666);
+    msgId = msgget(IpcKeys::key(CASHIER_MSG_KEY), IPC_CREAT | 0666);
     if (msgId < 0) {
         perror("msgget failed");
         exit(1);
     }
+
+    EventLog::createSegment();
+    Tracer::createSegment();
+    LatencyHistograms::createSegment();
 }
 
 pid_t createLifeguard(Pool::PoolType poolType) {
@@ -77,9 +78,9 @@ pid_t createLifeguard(Pool::PoolType poolType) {
     if (pid == 0) {
         Pool *pool = PoolManager::getInstance()->getPool(poolType);
         setProcessName(std::string("lifeguard_" + pool->getName()).c_str());
+        LockStats::setRole(ProcessRole::Lifeguard);
+        CpuPlacement::apply(ProcessRole::Lifeguard);
         SignalHandler::setChildProcess();
-        SignalHandler::setChildCleanupHandler([poolType]() {
-        });
         Lifeguard lifeguard(pool);
         lifeguard.run();
         exit(0);
@@ -91,10 +92,11 @@ pid_t createCashier() {
     pid_t pid = fork();
     if (pid == 0) {
         setProcessName("cashier");
+        LockStats::setRole(ProcessRole::Cashier);
+        CpuPlacement::apply(ProcessRole::Cashier);
         try {
             Cashier cashier;
             SignalHandler::setChildProcess();
-            SignalHandler::setChildCleanupHandler([]() {});
             cashier.run();
             exit(0);
         } catch (const std::exception &e) {
@@ -105,58 +107,14 @@ pid_t createCashier() {
     return pid;
 }
 
-pid_t createClientWithPossibleDependent(int &clientId) {
-    if (!WorkingHoursManager::isOpen()) {
-        return -1;
-    }
-
-    int guardianId = clientId++;
-    srand(guardianId);
-
-    int childrenId = -1;
-    bool isGuardian = (rand() % 100 < 20);
-    if (isGuardian) {
-        childrenId = clientId++;
-    }
-
+pid_t createLogDrain(LogDrain &drain) {
     pid_t pid = fork();
     if (pid == 0) {
-        setProcessName(std::string("client_" + std::to_string(guardianId)).c_str());
-        try {
-            SignalHandler::setChildProcess();
-
-            int age;
-
-            if (isGuardian) {
-                age = 18 + (rand() % 52);
-            } else {
-                age = 10 + (rand() % 60);
-            }
-
-            bool isVip = (rand() % 100 < 20);
-
-            Client *client = new Client(guardianId, age, isVip);
-            client->setAsGuardian(isGuardian);
-
-            if (isGuardian && childrenId != -1) {
-                int childAge = (rand() % 9) + 1;
-                bool needsDiaper = childAge <= 3;
-                int hasDiaper = needsDiaper && (rand() % 100 < 80); //20% of clients forget to take one
-                Client *child = new Client(childrenId, childAge, isVip, hasDiaper, true, client->getId());
-                client->addDependent(child);
-            }
-
-            SignalHandler::setChildCleanupHandler([client]() {
-                delete client;
-            });
-
-            client->run();
-            delete client;
-            exit(0);
-        } catch (const std::exception &e) {
-            std::cerr << "Error in client process: " << e.what() << std::endl;
-            exit(1);
-        }
+        setProcessName("log_drain");
+        LockStats::setRole(ProcessRole::LogDrain);
+        SignalHandler::setChildProcess();
+        drain.run();
+        exit(0);
     }
     return pid;
 }
@@ -165,59 +123,141 @@ void runMaintenanceThread() {
     auto maintenanceManager = MaintenanceManager::getInstance();
 
     while (shouldRun) {
-        std::this_thread::sleep_for(std::chrono::minutes(2));
+        SimClock::sleepFor(std::chrono::minutes(2));
         maintenanceManager->startMaintenance();
-        std::this_thread::sleep_for(std::chrono::seconds(10));
+        SimClock::sleepFor(std::chrono::seconds(10));
         maintenanceManager->endMaintenance();
-        std::this_thread::sleep_for(std::chrono::minutes(2));
+        SimClock::sleepFor(std::chrono::minutes(2));
     }
 }
 
-void initializeWorkingHours() {
-    auto *shm = (SharedMemory *) shmat(shmId, nullptr, 0);
-    if (shm == (void *) -1) {
-        perror("shmat failed in initializeWorkingHours");
-        exit(1);
+// Frees the places of visitors that died or hung inside a pool and reports the capacity won back
+// per simulated hour
+void runLeaseReaperThread() {
+    SharedMemory *shm = SharedSegment::get();
+    if (!shm) {
+        return;
     }
+    auto poolManager = PoolManager::getInstance();
+    const int64_t HOUR_NS = 3600 * 1000000000LL;
+    int64_t startNs = SimClock::nowNs();
+    int64_t hourStartNs = startNs;
+    int hourReclaimed = 0;
+    long totalReclaimed = 0;
 
+    while (shouldRun) {
+        // Leases are renewed in real time, so the reaper runs in real time as well
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        try {
+            LeaseCheck check(shm->leases, Metrics::nowNs());
+            for (auto poolType: {Pool::PoolType::Olympic, Pool::PoolType::Recreational, Pool::PoolType::Children}) {
+                hourReclaimed += poolManager->getPool(poolType)->reclaimExpired(check);
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Lease reaper: " << e.what() << std::endl;
+        }
+
+        if (SimClock::nowNs() - hourStartNs >= HOUR_NS) {
+            EventLog::log(LOG_LEASES_HOURLY, hourReclaimed);
+            totalReclaimed += hourReclaimed;
+            hourReclaimed = 0;
+            hourStartNs += HOUR_NS;
+        }
+    }
+
+    totalReclaimed += hourReclaimed;
+    double hours = static_cast<double>(SimClock::nowNs() - startNs) / static_cast<double>(HOUR_NS);
+    std::cout << "Lease reaper: " << totalReclaimed << " places reclaimed, "
+              << (hours > 0 ? static_cast<double>(totalReclaimed) / hours : 0) << " per simulated hour" << std::endl;
+}
+
+void initializeWorkingHours() {
+    SharedMemory *shm = SharedSegment::get();
     shm->workingHours[0] = 8;  // Tp
     shm->workingHours[1] = 24; // Tk
-
-    shmdt(shm);
 }
 
-std::mutex terminationMutex;
+void initializeEntranceQueue(const QueueSettings &settings) {
+    settings.apply(SharedSegment::get()->entranceQueue);
+}
 
-void processCollector() {
-    while (shouldRun) {
-        int status;
-        pid_t pid;
-        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-            std::lock_guard<std::mutex> lock(terminationMutex);
-            auto it = std::find(processes.begin(), processes.end(), pid);
-            if (it != processes.end()) {
-                processes.erase(it);
-            }
+int main(int argc, char *argv[]) {
+    auto config = Config::getInstance();
+    std::unique_ptr<ArrivalModel> arrivalModel;
+    DemographicMix demographicMix;
+    std::unique_ptr<ClientSpawner> spawner;
+    QueueSettings queueSettings;
+    SegmentOptions segmentOptions;
+    try {
+        config->parse(argc, argv);
+        arrivalModel = ArrivalModel::create(config->arrivalModel);
+        spawner = ClientSpawner::create(config->clientSpawner);
+        queueSettings = QueueSettings::parse(config->queuePolicy, config->queueSlo);
+        segmentOptions = SegmentOptions::parse(config->shmBackend, config->shmPrefault, config->shmSize);
+        CpuPlacement::configure(config->lifeguardCpus, config->cashierCpus, config->clientCpus,
+                                config->lifeguardPriority, config->clientNice);
+        if (!config->demographicMix.empty()) {
+            demographicMix = DemographicMix::parse(config->demographicMix);
         }
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        Config::printUsage(argv[0]);
+        return 1;
+    }
+
+    if (config->privateIpc) {
+        IpcKeys::usePrivate();
     }
-}
 
-int main() {
-    SignalHandler::initialize(&processes, &shouldRun);
     SignalHandler::setupSignalHandling();
     srand(time(nullptr));
+    uint64_t seed = config->seed ? config->seed : static_cast<uint64_t>(time(nullptr));
 
     try {
-        initializeIPC();
+        LogDrain logDrain(config->logFile, config->traceFile);
+        initializeIPC(segmentOptions);
+        segmentOptions.backend = SharedSegment::backend();
         initializeWorkingHours();
-
-        auto processesCollectorThread = std::thread(&processCollector);
-        auto maintenanceThread = std::thread(&runMaintenanceThread);
-
+        initializeEntranceQueue(queueSettings);
+        ShutdownCoordinator::reset();
+        Tracer::setEnabled(config->trace);
+        SimClock::initialize(config->clockSpeed, config->simStartHour, config->simStartMinute);
 
         auto poolManager = PoolManager::getInstance();
         poolManager->initialize();
+        Client::cashierQueueId();
+        Client::setPoolHopping(config->poolHopping);
+
+        pid_t logDrainPid = createLogDrain(logDrain);
+        checkSystemCall(logDrainPid, "Could not create log drain process");
+        processes.add(logDrainPid, ProcessRole::LogDrain);
+
+        // The zygote is forked before any thread exists, so it stays a small single-threaded template
+        pid_t zygotePid = spawner->start();
+        if (zygotePid > 0) {
+            processes.add(zygotePid, ProcessRole::Zygote);
+        }
+
+        ProcessReaper reaper(processes, shouldRun, SignalHandler::managedSignals());
+        ShutdownCoordinator coordinator(processes, reaper, config->shutdownGraceS, config->shutdownDeadlineS);
+        SignalHandler::initialize(&coordinator, &shouldRun, &logDrain);
+        reaper.setTerminationHandler(&SignalHandler::shutdown);
+        auto reaperThread = std::thread(&ProcessReaper::run, &reaper);
+        auto maintenanceThread = std::thread(&runMaintenanceThread);
+        auto leaseReaperThread = std::thread(&runLeaseReaperThread);
+
+        ClientSpawner *spawnerForRestart = spawner.get();
+        Watchdog watchdog(processes, shouldRun, config->watchdogS, [spawnerForRestart](WatchedRole role) {
+            switch (role) {
+                case WATCH_CASHIER:
+                    return createCashier();
+                case WATCH_ZYGOTE:
+                    return spawnerForRestart->restart();
+                default:
+                    return createLifeguard(static_cast<Pool::PoolType>(role - WATCH_LIFEGUARD_OLYMPIC));
+            }
+        });
+        auto watchdogThread = std::thread(&Watchdog::run, &watchdog);
 
         for (auto poolType: {Pool::PoolType::Olympic, Pool::PoolType::Recreational, Pool::PoolType::Children}) {
             pid_t pid = createLifeguard(poolType);
@@ -226,7 +266,7 @@ int main() {
                 shouldRun = false;
                 break;
             }
-            processes.push_back(pid);
+            processes.add(pid, ProcessRole::Lifeguard);
         }
 
         pid_t cashierPid = createCashier();
@@ -234,40 +274,70 @@ int main() {
             perror("Critical error: Could not create cashier process");
             shouldRun = false;
         } else {
-            processes.push_back(cashierPid);
+            processes.add(cashierPid, ProcessRole::Cashier);
         }
 
+        LoadGenerator generator(std::move(arrivalModel), demographicMix, seed);
+        std::cout << "Client spawner: " << spawner->describe() << std::endl;
+        std::cout << "Entrance queue: " << queueSettings.describe() << std::endl;
+        std::cout << "CPU placement: " << CpuPlacement::describe() << std::endl;
+        std::cout << "Shared memory: " << segmentOptions.describe() << ", " << SharedSegment::mappedBytes()
+                  << " bytes" << std::endl;
+        if (config->clockSpeed != 1.0 || config->simStartHour >= 0) {
+            time_t simulated = SimClock::now();
+            char start[32];
+            strftime(start, sizeof(start), "%H:%M", localtime(&simulated));
+            std::cout << "Simulated clock: x" << config->clockSpeed << " from " << start << std::endl;
+        }
         int clientId = 1;
         int consecutiveErrors = 0;
         const int MAX_CONSECUTIVE_ERRORS = 5;
+        VisitorProfile profile{};
+
+        while (shouldRun && generator.waitForNextVisitor(clientId, profile, shouldRun)) {
+            if (!WorkingHoursManager::isOpen()) {
+                generator.recordSpawn(false);
+                continue;
+            }
 
-        while (shouldRun) {
-            if (WorkingHoursManager::isOpen()) {
-                pid_t clientPid = createClientWithPossibleDependent(clientId);
-                if (clientPid == -1) {
-                    consecutiveErrors++;
-                    if (consecutiveErrors >= MAX_CONSECUTIVE_ERRORS) {
-                        perror("Critical error: Too many consecutive fork failures");
-                        shouldRun = false;
-                        break;
-                    }
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                } else if (clientPid > 0) {
-                    consecutiveErrors = 0;
-                    processes.push_back(clientPid);
+            pid_t clientPid = 0;
+            SpawnResult result = spawner->spawn(profile, clientPid);
+            generator.recordSpawn(result == SPAWN_STARTED, result == SPAWN_DROPPED);
+            if (result == SPAWN_DROPPED) {
+                // Load, not a fault: the visitor is turned away and the schedule goes on
+                Metrics::visitorDropped();
+            } else if (result == SPAWN_FAILED) {
+                consecutiveErrors++;
+                if (consecutiveErrors >= MAX_CONSECUTIVE_ERRORS) {
+                    perror("Critical error: Too many consecutive client spawn failures");
+                    shouldRun = false;
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            } else {
+                consecutiveErrors = 0;
+                if (clientPid > 0) {
+                    processes.add(clientPid, ProcessRole::Client);
                 }
             }
-            sleep(1);
         }
 
-        if (processesCollectorThread.joinable()) {
-            processesCollectorThread.join();
+        if (reaperThread.joinable()) {
+            reaperThread.join();
         }
 
         if (maintenanceThread.joinable()) {
             maintenanceThread.join();
         }
 
+        if (leaseReaperThread.joinable()) {
+            leaseReaperThread.join();
+        }
+
+        if (watchdogThread.joinable()) {
+            watchdogThread.join();
+        }
+
         return 0;
     } catch (const std::exception &e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
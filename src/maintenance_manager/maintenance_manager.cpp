@@ -1,5 +1,6 @@
 #include "maintenance_manager.h"
 #include "error_handler.h"
+#include "sim_clock.h"
 #include <iostream>
 
 MaintenanceManager *MaintenanceManager::instance = nullptr;
@@ -45,7 +46,7 @@ void MaintenanceManager::startMaintenance() {
             if (pools[0]->isEmpty() && pools[1]->isEmpty() && pools[2]->isEmpty()) {
                 break;
             }
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+            SimClock::sleepFor(std::chrono::seconds(1));
             waitTime++;
         }
 
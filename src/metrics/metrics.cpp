@@ -0,0 +1,164 @@
+#include "metrics.h"
+#include "latency_histogram.h"
+#include <sstream>
+
+namespace {
+    const char *const POOL_LABELS[POOL_COUNT] = {"olympic", "recreational", "children"};
+    const char *const QUEUE_CLASS_LABELS[QUEUE_CLASS_COUNT] = {"regular", "vip"};
+    const char *const LOCK_LABELS[SEM_COUNT] = {"olympic", "recreational", "kids", "entrance_queue", "init"};
+    const char *const REFUSAL_LABELS[REFUSAL_REASON_COUNT] = {
+            "no_swim_diaper", "closed", "full", "no_child", "average_age", "age_limit", "no_guardian"
+    };
+
+    void header(std::ostringstream &out, const char *name, const char *type, const char *help) {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+    }
+
+    void histogram(std::ostringstream &out, const char *name, const char *lock, const LockHistogram &values) {
+        uint64_t cumulative = 0;
+        for (int bucket = 0; bucket < LockHistogram::BUCKETS; bucket++) {
+            cumulative += values.counts[bucket].load(std::memory_order_relaxed);
+            out << name << "_bucket{lock=\"" << lock << "\",le=\"" << static_cast<double>(2ull << bucket) / 1e9
+                << "\"} " << cumulative << "\n";
+        }
+        out << name << "_bucket{lock=\"" << lock << "\",le=\"+Inf\"} " << cumulative << "\n"
+            << name << "_sum{lock=\"" << lock << "\"} "
+            << static_cast<double>(values.sumNs.load(std::memory_order_relaxed)) / 1e9 << "\n"
+            << name << "_count{lock=\"" << lock << "\"} " << cumulative << "\n";
+    }
+}
+
+const char *Metrics::refusalLabel(int reason) {
+    return reason >= 0 && reason < REFUSAL_REASON_COUNT ? REFUSAL_LABELS[reason] : "unknown";
+}
+
+const char *Metrics::lockLabel(int lock) {
+    return lock >= 0 && lock < SEM_COUNT ? LOCK_LABELS[lock] : "unknown";
+}
+
+std::string Metrics::renderLockPrometheus(const LockCounters locks[SEM_COUNT]) {
+    std::ostringstream out;
+
+    header(out, "pool_lock_contended_total", "counter", "Semaphore acquisitions that found it taken.");
+    for (int lock = 0; lock < SEM_COUNT; lock++) {
+        out << "pool_lock_contended_total{lock=\"" << LOCK_LABELS[lock] << "\"} "
+            << locks[lock].contended.load(std::memory_order_relaxed) << "\n";
+    }
+
+    header(out, "pool_lock_wait_seconds", "histogram", "Time from asking for a semaphore until holding it.");
+    for (int lock = 0; lock < SEM_COUNT; lock++) {
+        histogram(out, "pool_lock_wait_seconds", LOCK_LABELS[lock], locks[lock].wait);
+    }
+
+    header(out, "pool_lock_hold_seconds", "histogram", "Time a semaphore was held.");
+    for (int lock = 0; lock < SEM_COUNT; lock++) {
+        histogram(out, "pool_lock_hold_seconds", LOCK_LABELS[lock], locks[lock].hold);
+    }
+
+    header(out, "pool_lock_acquisitions_by_role_total", "counter", "Semaphore acquisitions, by holder role.");
+    for (int lock = 0; lock < SEM_COUNT; lock++) {
+        for (int role = 0; role < ROLE_COUNT; role++) {
+            out << "pool_lock_acquisitions_by_role_total{lock=\"" << LOCK_LABELS[lock] << "\",role=\""
+                << processRoleName(static_cast<ProcessRole>(role)) << "\"} "
+                << locks[lock].acquisitionsByRole[role].load(std::memory_order_relaxed) << "\n";
+        }
+    }
+
+    return out.str();
+}
+
+std::string Metrics::renderLatencyPrometheus(const LatencySegment &latency) {
+    std::ostringstream out;
+    const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+    header(out, "pool_operation_latency_seconds", "summary",
+           "Duration of pool, visitor, cashier and lifeguard calls.");
+    for (int op = 0; op < LATENCY_OP_COUNT; op++) {
+        LatencySnapshot snapshot = LatencyHistograms::merged(latency, static_cast<LatencyOp>(op));
+        const char *name = LatencyHistograms::opName(op);
+        for (double quantile: quantiles) {
+            out << "pool_operation_latency_seconds{op=\"" << name << "\",quantile=\"" << quantile << "\"} "
+                << static_cast<double>(snapshot.percentileNs(quantile)) / 1e9 << "\n";
+        }
+        out << "pool_operation_latency_seconds_sum{op=\"" << name << "\"} "
+            << static_cast<double>(snapshot.sumNs) / 1e9 << "\n"
+            << "pool_operation_latency_seconds_count{op=\"" << name << "\"} " << snapshot.total << "\n";
+    }
+
+    return out.str();
+}
+
+std::string Metrics::renderPrometheus(const MetricsRegistry &registry) {
+    std::ostringstream out;
+
+    header(out, "pool_admissions_total", "counter", "Visitors admitted to a pool.");
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        out << "pool_admissions_total{pool=\"" << POOL_LABELS[pool] << "\"} "
+            << registry.admissions[pool].load(std::memory_order_relaxed) << "\n";
+    }
+
+    header(out, "pool_refusals_total", "counter", "Pool entries refused, by reason.");
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        for (int reason = 0; reason < REFUSAL_REASON_COUNT; reason++) {
+            out << "pool_refusals_total{pool=\"" << POOL_LABELS[pool] << "\",reason=\"" << REFUSAL_LABELS[reason]
+                << "\"} " << registry.refusals[pool][reason].load(std::memory_order_relaxed) << "\n";
+        }
+    }
+
+    header(out, "pool_evacuations_total", "counter", "Evacuations ordered by a lifeguard.");
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        out << "pool_evacuations_total{pool=\"" << POOL_LABELS[pool] << "\"} "
+            << registry.evacuations[pool].load(std::memory_order_relaxed) << "\n";
+    }
+
+    header(out, "pool_lease_reclaimed_total", "counter", "Places freed because their lease expired.");
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        out << "pool_lease_reclaimed_total{pool=\"" << POOL_LABELS[pool] << "\"} "
+            << registry.leaseReclaims[pool].load(std::memory_order_relaxed) << "\n";
+    }
+
+    header(out, "pool_tickets_issued_total", "counter", "Tickets issued by the cashier.");
+    out << "pool_tickets_issued_total " << registry.ticketsIssued.load(std::memory_order_relaxed) << "\n";
+
+    header(out, "pool_tickets_refused_total", "counter", "Visitors turned away because the queue was full.");
+    out << "pool_tickets_refused_total " << registry.ticketsRefused.load(std::memory_order_relaxed) << "\n";
+
+    header(out, "pool_visitors_dropped_total", "counter", "Arrivals dropped because no client worker was free.");
+    out << "pool_visitors_dropped_total " << registry.visitorsDropped.load(std::memory_order_relaxed) << "\n";
+
+    header(out, "pool_entrance_queue_depth", "gauge", "Visitors waiting in the entrance queue.");
+    out << "pool_entrance_queue_depth " << registry.queueDepth.load(std::memory_order_relaxed) << "\n";
+
+    header(out, "pool_queue_served_total", "counter", "Visitors served by the cashier, by class.");
+    for (int queueClass = 0; queueClass < QUEUE_CLASS_COUNT; queueClass++) {
+        out << "pool_queue_served_total{class=\"" << QUEUE_CLASS_LABELS[queueClass] << "\"} "
+            << registry.queueServed[queueClass].load(std::memory_order_relaxed) << "\n";
+    }
+
+    header(out, "pool_queue_wait_seconds_total", "counter", "Simulated time spent in the entrance queue, by class.");
+    for (int queueClass = 0; queueClass < QUEUE_CLASS_COUNT; queueClass++) {
+        out << "pool_queue_wait_seconds_total{class=\"" << QUEUE_CLASS_LABELS[queueClass] << "\"} "
+            << registry.queueWaitS[queueClass].load(std::memory_order_relaxed) << "\n";
+    }
+
+    header(out, "pool_queue_slo_missed_total", "counter", "Visitors who waited longer than their class's wait SLO.");
+    for (int queueClass = 0; queueClass < QUEUE_CLASS_COUNT; queueClass++) {
+        out << "pool_queue_slo_missed_total{class=\"" << QUEUE_CLASS_LABELS[queueClass] << "\"} "
+            << registry.queueSloMissed[queueClass].load(std::memory_order_relaxed) << "\n";
+    }
+
+    header(out, "pool_lock_acquisitions_total", "counter", "Semaphore acquisitions.");
+    for (int lock = 0; lock < SEM_COUNT; lock++) {
+        out << "pool_lock_acquisitions_total{lock=\"" << LOCK_LABELS[lock] << "\"} "
+            << registry.lockAcquisitions[lock].load(std::memory_order_relaxed) << "\n";
+    }
+
+    header(out, "pool_lock_wait_seconds_total", "counter", "Time spent waiting for a semaphore.");
+    for (int lock = 0; lock < SEM_COUNT; lock++) {
+        out << "pool_lock_wait_seconds_total{lock=\"" << LOCK_LABELS[lock] << "\"} "
+            << static_cast<double>(registry.lockWaitNs[lock].load(std::memory_order_relaxed)) / 1e9 << "\n";
+    }
+
+    return out.str();
+}
@@ -0,0 +1,86 @@
+#ifndef SWIMMING_POOL_METRICS_H
+#define SWIMMING_POOL_METRICS_H
+
+#include "shared_memory.h"
+#include "shared_segment.h"
+#include <string>
+#include <ctime>
+
+struct LatencySegment;
+
+class Metrics {
+public:
+    static MetricsRegistry *registry() {
+        SharedMemory *shm = SharedSegment::get();
+        return shm ? &shm->metrics : nullptr;
+    }
+
+    static uint64_t nowNs() {
+        struct timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    static void admission(int pool) {
+        if (auto *r = registry()) r->admissions[pool].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void refusal(int pool, RefusalReason reason) {
+        if (auto *r = registry()) r->refusals[pool][reason].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void evacuation(int pool) {
+        if (auto *r = registry()) r->evacuations[pool].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void ticketIssued() {
+        if (auto *r = registry()) r->ticketsIssued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void ticketRefused() {
+        if (auto *r = registry()) r->ticketsRefused.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void visitorDropped() {
+        if (auto *r = registry()) r->visitorsDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void queueDepth(int depth) {
+        if (auto *r = registry()) r->queueDepth.store(depth, std::memory_order_relaxed);
+    }
+
+    static void queueWait(int queueClass, uint64_t waitS, bool sloMissed) {
+        if (auto *r = registry()) {
+            r->queueServed[queueClass].fetch_add(1, std::memory_order_relaxed);
+            r->queueWaitS[queueClass].fetch_add(waitS, std::memory_order_relaxed);
+            if (sloMissed) {
+                r->queueSloMissed[queueClass].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static void leaseReclaimed(int pool, int places) {
+        if (auto *r = registry()) r->leaseReclaims[pool].fetch_add(places, std::memory_order_relaxed);
+    }
+
+    static void lockWait(int semaphore, uint64_t waitNs) {
+        if (auto *r = registry()) {
+            r->lockAcquisitions[semaphore].fetch_add(1, std::memory_order_relaxed);
+            r->lockWaitNs[semaphore].fetch_add(waitNs, std::memory_order_relaxed);
+        }
+    }
+
+    static std::string renderPrometheus(const MetricsRegistry &registry);
+
+    static const char *refusalLabel(int reason);
+
+    static const char *lockLabel(int lock);
+
+    // Contention counters and wait/hold histograms of LockStats
+    static std::string renderLockPrometheus(const LockCounters locks[SEM_COUNT]);
+
+    // Merged LatencyHistograms of every operation as summaries
+    static std::string renderLatencyPrometheus(const LatencySegment &latency);
+};
+
+#endif
@@ -1,5 +1,22 @@
 #include "monitor.h"
+#include "metrics.h"
+#include "lock_stats.h"
+#include "latency_histogram.h"
+#include "recorder.h"
+#include "tracer.h"
+#include "working_hours_manager.h"
 #include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+const char *const DEFAULT_METRICS_SOCKET = "/tmp/pool_metrics.sock";
+
+volatile sig_atomic_t recordingInterrupted = 0;
 
 Monitor::Monitor() : shouldRun(true) {
     uiManager = UIManager::getInstance();
@@ -38,14 +55,209 @@ void Monitor::run() {
     }
 }
 
+std::string Monitor::scrapeMetrics() {
+    MetricsRegistry *registry = Metrics::registry();
+    if (!registry) {
+        throw std::runtime_error("Metrics registry is not available");
+    }
+    std::string exposition =
+            Metrics::renderPrometheus(*registry) + Metrics::renderLockPrometheus(SharedSegment::get()->locks);
+    if (LatencySegment *latency = LatencyHistograms::getSegment()) {
+        exposition += Metrics::renderLatencyPrometheus(*latency);
+    }
+    return exposition;
+}
+
+void Monitor::serveMetrics(const std::string &socketPath) {
+    if (!UIManager::checkIfMainProcessRunning()) {
+        throw std::runtime_error("Main process is not running");
+    }
+
+    unlink(socketPath.c_str());
+    int serverSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serverSocket == -1) {
+        throw std::runtime_error("Cannot create metrics socket");
+    }
+
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (bind(serverSocket, (struct sockaddr *) &addr, sizeof(addr)) == -1 || listen(serverSocket, 16) == -1) {
+        close(serverSocket);
+        throw std::runtime_error("Cannot bind metrics socket " + socketPath);
+    }
+
+    std::cout << "Serving metrics on " << socketPath << std::endl;
+
+    while (shouldRun.load() && UIManager::checkIfMainProcessRunning()) {
+        struct pollfd serverPoll = {serverSocket, POLLIN, 0};
+        if (poll(&serverPoll, 1, 1000) <= 0) {
+            continue;
+        }
+
+        int clientSocket = accept(serverSocket, nullptr, nullptr);
+        if (clientSocket == -1) {
+            continue;
+        }
+
+        // Plain readers get the bare exposition, HTTP clients (curl --unix-socket) get a response header
+        char request[512];
+        ssize_t received = 0;
+        struct pollfd clientPoll = {clientSocket, POLLIN, 0};
+        if (poll(&clientPoll, 1, 100) > 0) {
+            received = recv(clientSocket, request, sizeof(request), 0);
+        }
+
+        std::string body = scrapeMetrics();
+        std::string response;
+        if (received >= 4 && strncmp(request, "GET ", 4) == 0) {
+            response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                       + std::to_string(body.size()) + "\r\n\r\n";
+        }
+        response += body;
+
+        send(clientSocket, response.data(), response.size(), MSG_NOSIGNAL);
+        close(clientSocket);
+    }
+
+    close(serverSocket);
+    unlink(socketPath.c_str());
+}
+
+void Monitor::writeMetrics(const std::string &filePath, int intervalMs) {
+    if (!UIManager::checkIfMainProcessRunning()) {
+        throw std::runtime_error("Main process is not running");
+    }
+
+    std::string tmpPath = filePath + ".tmp";
+    while (shouldRun.load() && UIManager::checkIfMainProcessRunning()) {
+        {
+            std::ofstream out(tmpPath, std::ios::trunc);
+            out << scrapeMetrics();
+        }
+        if (rename(tmpPath.c_str(), filePath.c_str()) == -1) {
+            perror("rename failed in writeMetrics");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+    }
+}
+
+void Monitor::record(const std::string &filePath, int rateHz) {
+    if (!UIManager::checkIfMainProcessRunning()) {
+        throw std::runtime_error("Main process is not running");
+    }
+
+    SharedMemory *shm = SharedSegment::get();
+    if (!shm) {
+        throw std::runtime_error("Failed to attach shared memory for recording");
+    }
+
+    auto poolManager = PoolManager::getInstance();
+    poolManager->initialize();
+    int capacities[POOL_COUNT];
+    for (int i = 0; i < POOL_COUNT; i++) {
+        capacities[i] = poolManager->getPool(static_cast<Pool::PoolType>(i))->getCapacity();
+    }
+
+    auto wallClockMs = []() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    };
+
+    signal(SIGINT, [](int) { recordingInterrupted = 1; });
+    signal(SIGTERM, [](int) { recordingInterrupted = 1; });
+
+    OccupancyRecorder recorder(filePath, rateHz, capacities, wallClockMs());
+    std::cout << "Recording " << rateHz << " samples/s to " << filePath << std::endl;
+
+    Snapshot::Fields fields{};
+    auto period = std::chrono::nanoseconds(1000000000 / rateHz);
+    auto nextSample = std::chrono::steady_clock::now();
+    bool facilityOpen = false;
+    uint64_t samples = 0;
+
+    // Main process liveness looks the segment up by name, so poll it and the facility status once per second
+    while (shouldRun.load() && !recordingInterrupted) {
+        if (samples % rateHz == 0) {
+            if (!UIManager::checkIfMainProcessRunning()) {
+                break;
+            }
+            facilityOpen = WorkingHoursManager::isOpen();
+        }
+
+        Snapshot::capture(*shm, facilityOpen, fields);
+        recorder.append(wallClockMs(), fields);
+        samples++;
+
+        nextSample += period;
+        std::this_thread::sleep_until(nextSample);
+    }
+
+    std::cout << "\nRecorded " << samples << " samples (" << recorder.bytesWritten() << " bytes)" << std::endl;
+}
+
 void Monitor::stop() {
     shouldRun.store(false);
 }
 
-int main() {
+void printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [--metrics-socket [path]] [--metrics-file path [--interval ms]]"
+              << " [--record path [--rate hz]] [--trace on|off]" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::string metricsSocket;
+    std::string metricsFile;
+    int intervalMs = 1000;
+    std::string recordingFile;
+    int rateHz = 10;
+    std::string trace;
+    LockStats::setRole(ProcessRole::Monitor);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+        if (arg == "--metrics-socket") {
+            metricsSocket = hasValue ? argv[++i] : DEFAULT_METRICS_SOCKET;
+        } else if (arg == "--metrics-file" && hasValue) {
+            metricsFile = argv[++i];
+        } else if (arg == "--interval" && hasValue) {
+            intervalMs = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--record" && hasValue) {
+            recordingFile = argv[++i];
+        } else if (arg == "--rate" && hasValue) {
+            rateHz = std::clamp(atoi(argv[++i]), 1, 1000);
+        } else if (arg == "--trace" && hasValue && (std::string(argv[i + 1]) == "on" || std::string(argv[i + 1]) == "off")) {
+            trace = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Flips the switch of the running simulation, the log drain picks the spans up from there
+    if (!trace.empty()) {
+        if (!SharedSegment::get()) {
+            std::cerr << "Symulacja nie jest uruchomiona" << std::endl;
+            return 1;
+        }
+        Tracer::setEnabled(trace == "on");
+        std::cout << "Tracing " << trace << std::endl;
+        return 0;
+    }
+
     try {
         Monitor monitor;
-        monitor.run();
+        if (!metricsSocket.empty()) {
+            monitor.serveMetrics(metricsSocket);
+        } else if (!metricsFile.empty()) {
+            monitor.writeMetrics(metricsFile, intervalMs);
+        } else if (!recordingFile.empty()) {
+            monitor.record(recordingFile, rateHz);
+        } else {
+            monitor.run();
+        }
         return 0;
     } catch (const std::exception &e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
@@ -3,6 +3,7 @@
 
 #include <atomic>
 #include <csignal>
+#include <string>
 #include "ui_manager.h"
 
 class Monitor {
@@ -12,10 +13,15 @@ private:
 
     static void setupSignalHandling();
 
+    static std::string scrapeMetrics();
+
 public:
     Monitor();
     void run();
+    void serveMetrics(const std::string &socketPath);
+    void writeMetrics(const std::string &filePath, int intervalMs);
+    void record(const std::string &filePath, int rateHz);
     void stop();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,189 @@
+#ifndef SWIMMING_POOL_ADMISSION_H
+#define SWIMMING_POOL_ADMISSION_H
+
+#include "shared_memory.h"
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <utility>
+
+enum PoolIndex {
+    POOL_OLYMPIC = 0,
+    POOL_RECREATIONAL = 1,
+    POOL_CHILDREN = 2
+};
+
+struct PoolRules {
+    int capacity;
+    int minAge;
+    int maxAge;
+    double maxAverageAge;
+};
+
+// Facility configuration, indexed by PoolIndex
+const PoolRules POOL_RULES[POOL_COUNT] = {
+        {100, 18, 70, 100},
+        {40,  0,  70, 40},
+        {20,  0,  5,  100},
+};
+
+// What admission needs to know about a pool; ageSum is only filled in for policies that read it
+struct PoolOccupancy {
+    int count;
+    long ageSum;
+    bool isClosed;
+};
+
+struct AdmissionRequest {
+    int age;
+    bool hasSwimDiaper;
+    bool hasGuardian;
+    bool isGuardian;
+    int companionAge;   // a party member judged just before and counted in the occupancy but not its age sum
+};
+
+const int ADMITTED = -1;
+
+// Admission rules. Each one is a predicate with the RefusalReason it reports and says whether it
+// reads the age sum of the occupancy, which Pool::enter otherwise skips computing. Predicates are
+// templates over the request and only use comparisons, & and |, so the same rule judges one
+// AdmissionRequest or eight visitors at once as the vector lanes of AdmissionBatch.
+struct SwimDiaperRule {
+    static constexpr RefusalReason reason = REFUSAL_NO_SWIM_DIAPER;
+    static constexpr bool usesAgeSum = false;
+
+    template<typename Request>
+    static auto admits(const PoolRules &, const PoolOccupancy &, const Request &visitor) {
+        return (visitor.age > 3) | visitor.hasSwimDiaper;
+    }
+};
+
+struct OpenRule {
+    static constexpr RefusalReason reason = REFUSAL_POOL_CLOSED;
+    static constexpr bool usesAgeSum = false;
+
+    template<typename Request>
+    static bool admits(const PoolRules &, const PoolOccupancy &occupancy, const Request &) {
+        return !occupancy.isClosed;
+    }
+};
+
+struct CapacityRule {
+    static constexpr RefusalReason reason = REFUSAL_POOL_FULL;
+    static constexpr bool usesAgeSum = false;
+
+    template<typename Request>
+    static bool admits(const PoolRules &rules, const PoolOccupancy &occupancy, const Request &) {
+        return occupancy.count < rules.capacity;
+    }
+};
+
+// Children under 10 only come in with an adult
+struct SupervisionRule {
+    static constexpr RefusalReason reason = REFUSAL_NO_GUARDIAN;
+    static constexpr bool usesAgeSum = false;
+
+    template<typename Request>
+    static auto admits(const PoolRules &, const PoolOccupancy &, const Request &visitor) {
+        return (visitor.age >= 10) | visitor.hasGuardian;
+    }
+};
+
+struct AgeRangeRule {
+    static constexpr RefusalReason reason = REFUSAL_AGE_LIMIT;
+    static constexpr bool usesAgeSum = false;
+
+    template<typename Request>
+    static auto admits(const PoolRules &rules, const PoolOccupancy &, const Request &visitor) {
+        return (visitor.age >= rules.minAge) & (visitor.age <= rules.maxAge);
+    }
+};
+
+// Above maxAge only the guardians of the children in the pool are let in
+struct GuardianOnlyAboveMaxAgeRule {
+    static constexpr RefusalReason reason = REFUSAL_NO_CHILD_IN_KIDS_POOL;
+    static constexpr bool usesAgeSum = false;
+
+    template<typename Request>
+    static auto admits(const PoolRules &rules, const PoolOccupancy &, const Request &visitor) {
+        return (visitor.age <= rules.maxAge) | visitor.isGuardian;
+    }
+};
+
+struct AverageAgeRule {
+    static constexpr RefusalReason reason = REFUSAL_AVERAGE_AGE;
+    static constexpr bool usesAgeSum = true;
+
+    static double newAverageAge(const PoolOccupancy &occupancy, const AdmissionRequest &visitor) {
+        return static_cast<double>(occupancy.ageSum + visitor.age) / (occupancy.count + 1);
+    }
+
+    // The highest age that keeps the average within the limit; ages are whole years
+    static int ageHeadroom(const PoolRules &rules, const PoolOccupancy &occupancy) {
+        double headroom = std::floor(rules.maxAverageAge * (occupancy.count + 1)) - static_cast<double>(occupancy.ageSum);
+        return static_cast<int>(std::clamp(headroom, -1.0, static_cast<double>(INT_MAX)));
+    }
+
+    template<typename Request>
+    static auto admits(const PoolRules &rules, const PoolOccupancy &occupancy, const Request &visitor) {
+        return visitor.age + visitor.companionAge <= ageHeadroom(rules, occupancy);
+    }
+};
+
+// Rules are checked in the order given and the first refusal wins
+template<typename... Rules>
+struct AdmissionPolicy {
+    static constexpr bool usesAgeSum = (Rules::usesAgeSum || ...);
+
+    static int tryAdmit(const PoolRules &rules, const PoolOccupancy &occupancy, const AdmissionRequest &visitor) {
+        int decision = ADMITTED;
+        (void) ((Rules::admits(rules, occupancy, visitor) || (decision = Rules::reason, false)) && ...);
+        return decision;
+    }
+
+    // Every rule is evaluated, without the early exit. With vector lanes the result is nonzero in
+    // the lanes that would be admitted.
+    template<typename Request>
+    static auto admits(const PoolRules &rules, const PoolOccupancy &occupancy, const Request &visitor) {
+        return (Rules::admits(rules, occupancy, visitor) & ...);
+    }
+};
+
+// The rule set of every pool kind, fixed at compile time. A new kind of pool needs a PoolIndex,
+// its POOL_RULES entry and a specialisation here.
+template<int Pool>
+struct PoolPolicy;
+
+template<>
+struct PoolPolicy<POOL_OLYMPIC>
+        : AdmissionPolicy<SwimDiaperRule, OpenRule, CapacityRule, AgeRangeRule> {
+};
+
+template<>
+struct PoolPolicy<POOL_RECREATIONAL>
+        : AdmissionPolicy<SwimDiaperRule, OpenRule, CapacityRule, SupervisionRule, AgeRangeRule, AverageAgeRule> {
+};
+
+template<>
+struct PoolPolicy<POOL_CHILDREN>
+        : AdmissionPolicy<SwimDiaperRule, OpenRule, CapacityRule, SupervisionRule, GuardianOnlyAboveMaxAgeRule> {
+};
+
+using AdmitFunction = int (*)(const PoolRules &, const PoolOccupancy &, const AdmissionRequest &);
+
+struct AdmissionEntry {
+    AdmitFunction tryAdmit;
+    bool usesAgeSum;
+};
+
+template<int... Pools>
+constexpr std::array<AdmissionEntry, sizeof...(Pools)> admissionTable(std::integer_sequence<int, Pools...>) {
+    return {{{&PoolPolicy<Pools>::tryAdmit, PoolPolicy<Pools>::usesAgeSum}...}};
+}
+
+// tryAdmit of every pool, indexed by PoolIndex; used by Pool::enter and pool_sim
+constexpr std::array<AdmissionEntry, POOL_COUNT> ADMISSION_POLICIES =
+        admissionTable(std::make_integer_sequence<int, POOL_COUNT>());
+
+#endif
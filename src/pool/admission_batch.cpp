@@ -0,0 +1,123 @@
+#include "admission_batch.h"
+#include "roster_scan.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    using ByteLane = uint8_t __attribute__((vector_size(AdmissionBatch::LANES)));
+    using SmallLane = int8_t __attribute__((vector_size(AdmissionBatch::LANES)));
+
+    AdmissionLane loadInts(const int32_t *values) {
+        AdmissionLane lane;
+        memcpy(&lane, values, sizeof(lane));
+        return lane;
+    }
+
+    AdmissionLane loadBytes(const uint8_t *values) {
+        ByteLane bytes;
+        memcpy(&bytes, values, sizeof(bytes));
+        return __builtin_convertvector(bytes, AdmissionLane);
+    }
+
+    // A policy made only of pool-wide rules yields one bool for all lanes; this spreads it
+    AdmissionLane toMask(AdmissionLane admitted) { return admitted != 0; }
+
+    [[maybe_unused]] AdmissionLane toMask(bool admitted) { return AdmissionLane{} - (admitted ? 1 : 0); }
+
+    // A guardian goes in first and the child is judged with the guardian already counted, as in
+    // Client::moveToAnotherPool
+    AdmissionLane hasFlag(AdmissionLane flags, ClientFlags flag) { return (flags & static_cast<int32_t>(flag)) != 0; }
+
+    template<int Pool>
+    AdmissionLane admitParty(const PoolOccupancy &occupancy, AdmissionLane age, AdmissionLane flags,
+                             AdmissionLane childAge) {
+        const PoolRules &rules = POOL_RULES[Pool];
+        const AdmissionLane zero = {};
+        AdmissionLane hasChild = childAge != 0;
+
+        AdmissionLanes adult{age, hasFlag(flags, CLIENT_SWIM_DIAPER), hasFlag(flags, CLIENT_HAS_GUARDIAN), hasChild,
+                             zero};
+        AdmissionLanes child{childAge, hasFlag(flags, CLIENT_CHILD_SWIM_DIAPER), hasChild, zero, age};
+        PoolOccupancy withAdult{occupancy.count + 1, occupancy.ageSum, occupancy.isClosed};
+
+        return toMask(PoolPolicy<Pool>::admits(rules, occupancy, adult)) &
+               ((hasChild == 0) | toMask(PoolPolicy<Pool>::admits(rules, withAdult, child)));
+    }
+
+    template<int... Pools>
+    AdmissionLane eligiblePools(const PoolOccupancy occupancy[], AdmissionLane age, AdmissionLane flags,
+                                AdmissionLane childAge, std::integer_sequence<int, Pools...>) {
+        return ((admitParty<Pools>(occupancy[Pools], age, flags, childAge) & (1 << Pools)) | ...);
+    }
+}
+
+void AdmissionBatch::clear() {
+    count = 0;
+    std::fill(ages, ages + CAPACITY, 0);
+    std::fill(childAges, childAges + CAPACITY, 0);
+    std::fill(flags, flags + CAPACITY, 0);
+}
+
+bool AdmissionBatch::add(int age, uint8_t clientFlags, int childAge) {
+    if (count >= MAX_VISITORS) {
+        return false;
+    }
+    ages[count] = age;
+    flags[count] = clientFlags;
+    childAges[count] = childAge;
+    count++;
+    return true;
+}
+
+void AdmissionBatch::addQueueHead(const EntranceQueue &queue) {
+    if (queue.queueSize <= 0) {
+        return;
+    }
+    const EntranceQueue::QueueEntry &entry = queue.queue[0];
+    uint8_t entryFlags = (entry.isVip ? CLIENT_VIP : 0) | (entry.hasSwimDiaper ? CLIENT_SWIM_DIAPER : 0) |
+                         (entry.hasGuardian ? CLIENT_HAS_GUARDIAN : 0) |
+                         (entry.childHasSwimDiaper ? CLIENT_CHILD_SWIM_DIAPER : 0);
+    add(entry.age, entryFlags, entry.childAge);
+}
+
+void AdmissionBatch::evaluate(const PoolOccupancy occupancy[POOL_COUNT]) {
+    const AdmissionLane none = AdmissionLane{} - 1;
+    const AdmissionLane olympic = AdmissionLane{} + static_cast<int32_t>(POOL_OLYMPIC);
+    const AdmissionLane recreationalPool = AdmissionLane{} + static_cast<int32_t>(POOL_RECREATIONAL);
+    const AdmissionLane children = AdmissionLane{} + static_cast<int32_t>(POOL_CHILDREN);
+
+    for (int i = 0; i < count; i += LANES) {
+        AdmissionLane age = loadInts(ages + i);
+        AdmissionLane childAge = loadInts(childAges + i);
+        AdmissionLane mask = eligiblePools(occupancy, age, loadBytes(flags + i), childAge,
+                                           std::make_integer_sequence<int, POOL_COUNT>());
+
+        // The pool the visitor would head for, as the client chooses it: small children go to the
+        // children's pool, other parties with a child and teenagers to the recreational one, and
+        // adults on their own to the olympic pool or, when it would refuse them, the recreational one
+        AdmissionLane toChildren = (childAge > 0) & (childAge <= 5);
+        AdmissionLane toRecreational = (toChildren == 0) & ((childAge > 0) | (age < 18));
+        AdmissionLane olympicOk = (mask & (1 << POOL_OLYMPIC)) != 0;
+        AdmissionLane recreationalOk = (mask & (1 << POOL_RECREATIONAL)) != 0;
+        AdmissionLane childrenOk = (mask & (1 << POOL_CHILDREN)) != 0;
+
+        AdmissionLane recreational = recreationalOk ? recreationalPool : none;
+        AdmissionLane choice = olympicOk ? olympic : recreational;
+        choice = toRecreational ? recreational : choice;
+        choice = toChildren ? (childrenOk ? children : none) : choice;
+
+        ByteLane eligibleBytes = __builtin_convertvector(mask, ByteLane);
+        SmallLane choiceBytes = __builtin_convertvector(choice, SmallLane);
+        memcpy(eligible + i, &eligibleBytes, sizeof(eligibleBytes));
+        memcpy(suggested + i, &choiceBytes, sizeof(choiceBytes));
+    }
+}
+
+void AdmissionBatch::readOccupancy(const SharedMemory &shm, PoolOccupancy occupancy[POOL_COUNT]) {
+    const PoolState *pools[POOL_COUNT] = {&shm.olympic, &shm.recreational, &shm.kids};
+    for (int p = 0; p < POOL_COUNT; p++) {
+        int count = std::clamp(pools[p]->currentCount, 0, PoolState::MAX_CLIENTS);
+        occupancy[p] = {count, ADMISSION_POLICIES[p].usesAgeSum ? RosterScan::sumAges(pools[p]->ages, count) : 0,
+                        pools[p]->isClosed};
+    }
+}
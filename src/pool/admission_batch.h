@@ -0,0 +1,54 @@
+#ifndef SWIMMING_POOL_ADMISSION_BATCH_H
+#define SWIMMING_POOL_ADMISSION_BATCH_H
+
+#include "admission.h"
+#include "shared_memory.h"
+
+// Four visitors in the vector lanes of one request, one SSE2/NEON register per field; the rules of
+// admission.h compile to vector compares on it. Boolean fields are lane masks, nonzero meaning true.
+using AdmissionLane = int32_t __attribute__((vector_size(16)));
+
+struct AdmissionLanes {
+    AdmissionLane age;
+    AdmissionLane hasSwimDiaper;
+    AdmissionLane hasGuardian;
+    AdmissionLane isGuardian;
+    AdmissionLane companionAge;
+};
+
+// Admission of a block of waiting visitors against every pool at once. Visitors are held as
+// structure of arrays (ages and ClientFlags) and each pool's policy runs over four of them per
+// step in the vector lanes, so the cashier can tell a visitor which pool would take them when the
+// ticket is issued instead of the visitor trying pools one enter() at a time.
+//
+// Visitors are judged independently against the same occupancy; the result is advice, the
+// pool's own admission under its lock stays authoritative.
+class AdmissionBatch {
+public:
+    static constexpr int LANES = sizeof(AdmissionLane) / sizeof(int32_t);
+    static constexpr int MAX_VISITORS = EntranceQueue::MAX_QUEUE_SIZE;
+    // Arrays are padded to whole vectors; lanes past count hold zeros and their results are ignored
+    static constexpr int CAPACITY = (MAX_VISITORS + LANES - 1) / LANES * LANES;
+
+    int count = 0;
+    int32_t ages[CAPACITY] = {};
+    int32_t childAges[CAPACITY] = {};   // 0 without a child
+    uint8_t flags[CAPACITY] = {};       // ClientFlags
+    uint8_t eligible[CAPACITY] = {};    // bit per PoolIndex
+    int8_t suggested[CAPACITY] = {};    // PoolIndex, -1 when no pool would admit
+
+    void clear();
+
+    bool add(int age, uint8_t clientFlags, int childAge);
+
+    // The visitor the cashier serves next. The queue is a heap by priorityKey, so only its root is in
+    // a known position; entries past it are not in serving order.
+    void addQueueHead(const EntranceQueue &queue);
+
+    void evaluate(const PoolOccupancy occupancy[POOL_COUNT]);
+
+    // The aggregates admission needs, read without the pool semaphores; good enough for advice
+    static void readOccupancy(const SharedMemory &shm, PoolOccupancy occupancy[POOL_COUNT]);
+};
+
+#endif
@@ -3,11 +3,19 @@
 #include <sys/sem.h>
 #include <iostream>
 #include "error_handler.h"
-
-Pool::Pool(Pool::PoolType poolType, int capacity, int minAge, int maxAge,
-           double maxAverageAge, bool needsSupervision)
+#include "metrics.h"
+#include "event_log.h"
+#include "tracer.h"
+#include "roster_scan.h"
+#include "lock_stats.h"
+#include "latency_histogram.h"
+#include "lease.h"
+#include "shared_segment.h"
+#include <unistd.h>
+
+Pool::Pool(Pool::PoolType poolType, int capacity, int minAge, int maxAge, double maxAverageAge)
         : poolType(poolType), capacity(capacity), minAge(minAge), maxAge(maxAge),
-          maxAverageAge(maxAverageAge), needsSupervision(needsSupervision) {
+          maxAverageAge(maxAverageAge), admission(ADMISSION_POLICIES[static_cast<int>(poolType)]) {
 
 
     try {
@@ -18,7 +26,6 @@ Pool::Pool(Pool::PoolType poolType, int capacity, int minAge, int maxAge,
         this->minAge = minAge;
         this->maxAge = maxAge;
         this->maxAverageAge = maxAverageAge;
-        this->needsSupervision = needsSupervision;
 
         checkSystemCall(pthread_mutex_init(&avgAgeMutex, nullptr),
                         "Failed to initialize average age mutex");
@@ -26,12 +33,9 @@ Pool::Pool(Pool::PoolType poolType, int capacity, int minAge, int maxAge,
         checkSystemCall(pthread_mutex_init(&stateMutex, nullptr),
                         "Failed to initialize state mutex");
 
-        shmId = shmget(SHM_KEY, sizeof(SharedMemory), 0666);
-        checkSystemCall(shmId, "shmget failed in Pool");
-
-        auto *shm = (SharedMemory *) shmat(shmId, nullptr, 0);
-        if (shm == (void *) -1) {
-            throw PoolSystemError("shmat failed in Pool");
+        SharedMemory *shm = SharedSegment::get();
+        if (!shm) {
+            throw PoolSystemError("Shared memory segment not found in Pool");
         }
 
         switch (poolType) {
@@ -46,10 +50,9 @@ Pool::Pool(Pool::PoolType poolType, int capacity, int minAge, int maxAge,
                 break;
         }
 
-        semId = semget(SEM_KEY, SEM_COUNT, 0666);
+        semId = semget(IpcKeys::key(SEM_KEY), SEM_COUNT, 0666);
         if (semId < 0) {
             perror("semget failed in Pool");
-            shmdt(shm);
             pthread_mutex_destroy(&avgAgeMutex);
             pthread_mutex_destroy(&stateMutex);
             exit(1);
@@ -60,124 +63,298 @@ Pool::Pool(Pool::PoolType poolType, int capacity, int minAge, int maxAge,
 }
 
 
-bool Pool::enter(Client &client) {
-    struct sembuf lock = {static_cast<unsigned short>(getPoolSemaphore()), -1, SEM_UNDO};
-    struct sembuf unlock = {static_cast<unsigned short>(getPoolSemaphore()), 1, SEM_UNDO};
+int Pool::tryAdmit(Client &client, const PoolOccupancy &occupancy, int companionAge) {
+    int poolIndex = static_cast<int>(poolType);
+    PoolRules rules{capacity, minAge, maxAge, maxAverageAge};
+    AdmissionRequest request{client.getAge(), client.getHasSwimDiaper(), client.getHasGuardian(),
+                             client.getIsGuardian(), companionAge};
+    int decision = admission.tryAdmit(rules, occupancy, request);
+
+    switch (decision) {
+        case ADMITTED:
+            return decision;
+        case REFUSAL_NO_SWIM_DIAPER:
+            EventLog::log(LOG_REFUSED_NO_SWIM_DIAPER, client.getId());
+            break;
+        case REFUSAL_POOL_CLOSED:
+            EventLog::log(LOG_REFUSED_POOL_CLOSED, poolIndex);
+            break;
+        case REFUSAL_POOL_FULL:
+            EventLog::log(LOG_REFUSED_POOL_FULL, poolIndex, state->currentCount, capacity);
+            break;
+        case REFUSAL_NO_CHILD_IN_KIDS_POOL:
+            EventLog::log(LOG_REFUSED_NO_CHILD, client.getId(), client.getAge());
+            break;
+        case REFUSAL_AVERAGE_AGE:
+            EventLog::log(LOG_REFUSED_AVERAGE_AGE, client.getId(),
+                          AverageAgeRule::newAverageAge(occupancy, request), maxAverageAge);
+            break;
+        case REFUSAL_AGE_LIMIT:
+            EventLog::log(LOG_REFUSED_AGE_LIMIT, client.getId(), client.getAge(), poolIndex);
+            break;
+        case REFUSAL_NO_GUARDIAN:
+            EventLog::log(LOG_REFUSED_NO_GUARDIAN, client.getId(), client.getAge(), poolIndex);
+            break;
+    }
+    Metrics::refusal(poolIndex, static_cast<RefusalReason>(decision));
+    return decision;
+}
+
+void Pool::addMember(Client &client) {
+    client.setCurrentPool(this);
+    client.connectToPool();
+
+    uint8_t flags = (client.getIsVip() ? CLIENT_VIP : 0) | (client.getHasSwimDiaper() ? CLIENT_SWIM_DIAPER : 0) |
+                    (client.getHasGuardian() ? CLIENT_HAS_GUARDIAN : 0);
+    state->add(client.getId(), client.getAge(), flags, client.getGuardianId(), getpid());
+    Leases::renew();
+    Metrics::admission(static_cast<int>(poolType));
+}
+
+void Pool::addTransferred(Client &client) {
+    client.setCurrentPool(this);
+
+    uint8_t flags = (client.getIsVip() ? CLIENT_VIP : 0) | (client.getHasSwimDiaper() ? CLIENT_SWIM_DIAPER : 0) |
+                    (client.getHasGuardian() ? CLIENT_HAS_GUARDIAN : 0);
+    state->add(client.getId(), client.getAge(), flags, client.getGuardianId(), getpid());
+    Metrics::admission(static_cast<int>(poolType));
+}
 
-    if (semop(semId, &lock, 1) == -1) {
-        std::cout << "Failed to acquire semaphore for pool " << getName()
-                  << ", errno: " << errno << " (" << strerror(errno) << ")" << std::endl;
+bool Pool::admitsParty(Client &client, Client *dependent) {
+    PoolOccupancy occupancy = readOccupancy();
+    if (tryAdmit(client, occupancy, 0) != ADMITTED) {
         return false;
     }
+    if (!dependent) {
+        return true;
+    }
+    // The child is judged with the guardian already counted, as AdmissionBatch does
+    PoolOccupancy withGuardian{occupancy.count + 1, occupancy.ageSum, occupancy.isClosed};
+    return tryAdmit(*dependent, withGuardian, client.getAge()) == ADMITTED;
+}
+
+PoolOccupancy Pool::readOccupancy() const {
+    PoolOccupancy occupancy{state->currentCount, 0, state->isClosed};
+    if (admission.usesAgeSum) {
+        occupancy.ageSum = RosterScan::sumAges(state->ages, state->currentCount);
+    }
+    return occupancy;
+}
+
+bool Pool::enter(Client &client) {
+    auto semaphore = static_cast<unsigned short>(getPoolSemaphore());
+    int poolIndex = static_cast<int>(poolType);
 
-    if (client.getAge() <= 3 && !client.getHasSwimDiaper()) {
-        std::cout << "Klient " << client.getId() << " nie może wejść na basen bez pieluch do pływania" << std::endl;
+    LatencyScope latency(LATENCY_OP_POOL_ENTER);
+    TraceScope trace(TRACE_POOL_ENTER, client.getId(), poolIndex);
+    trace.setResult(0);
+
+    Leases::hold();
+    if (LockStats::acquire(semId, semaphore, SEM_UNDO) == -1) {
+        EventLog::log(LOG_POOL_LOCK_FAILED, poolIndex, errno, errno);
         return false;
     }
 
     try {
         ScopedLock stateLock(stateMutex);
 
-        if (state->isClosed) {
-            std::cout << "Próba wejścia na zamknięty basen " << getName() << " - odmowa!" << std::endl;
-            semop(semId, &unlock, 1);
+        if (tryAdmit(client, readOccupancy(), 0) != ADMITTED) {
+            LockStats::release(semId, semaphore, SEM_UNDO);
             return false;
         }
+        addMember(client);
 
-        if (state->currentCount >= capacity) {
-            std::cout << "Basen " << getName() << " jest pełny: "
-                      << state->currentCount << "/" << capacity << std::endl;
-            semop(semId, &unlock, 1);
-            return false;
+        if (LockStats::release(semId, semaphore, SEM_UNDO) == -1) {
+            EventLog::log(LOG_POOL_UNLOCK_FAILED, poolIndex, errno, errno);
+            throw PoolSystemError("Failed to release pool semaphore in enter()");
         }
 
-        if (poolType == PoolType::Children) {
-            if (client.getAge() > this->maxAge && !client.getHasGuardian()) {
-                std::cout << "Klient " << client.getId() << " w wieku " << client.getAge()
-                          << " bez dziecka próbował wejść do brodzika"
-                          << std::endl;
-                return false;
-            }
-        }
+        trace.setResult(1);
+        return true;
+    } catch (const std::exception &e) {
+        std::cout << "Exception in enter() for pool " << getName()
+                  << ": " << e.what() << std::endl;
+        LockStats::release(semId, semaphore, SEM_UNDO);
+        throw;
+    }
+}
 
-        if (poolType == PoolType::Recreational) {
-            double totalAge = client.getAge();
-            for (int i = 0; i < state->currentCount; i++) {
-                totalAge += state->clients[i].age;
-            }
-            double newAverageAge = totalAge / (state->currentCount + 1);
+bool Pool::enterWithDependent(Client &client, Client &dependent) {
+    auto semaphore = static_cast<unsigned short>(getPoolSemaphore());
+    int poolIndex = static_cast<int>(poolType);
 
-            if (newAverageAge > maxAverageAge) {
-                std::cout << "Klient " << client.getId() << " podwyższył by średnią wieku poza limit ("
-                          << newAverageAge << " > " << maxAverageAge << ")" << std::endl;
-                semop(semId, &unlock, 1);
-                return false;
-            }
-        }
-        client.setCurrentPool(this);
-        client.connectToPool();
+    LatencyScope latency(LATENCY_OP_POOL_ENTER);
+    TraceScope trace(TRACE_POOL_ENTER, client.getId(), poolIndex);
+    trace.setResult(0);
 
-        ClientData &newClient = state->clients[state->currentCount];
-        newClient.id = client.getId();
-        newClient.age = client.getAge();
-        newClient.isVip = client.getIsVip();
-        newClient.hasSwimDiaper = client.getHasSwimDiaper();
-        newClient.hasGuardian = client.getHasGuardian();
-        newClient.guardianId = client.getGuardianId();
+    Leases::hold();
+    if (LockStats::acquire(semId, semaphore, SEM_UNDO) == -1) {
+        EventLog::log(LOG_POOL_LOCK_FAILED, poolIndex, errno, errno);
+        return false;
+    }
 
-        state->currentCount++;
+    try {
+        ScopedLock stateLock(stateMutex);
 
+        if (!admitsParty(client, &dependent)) {
+            LockStats::release(semId, semaphore, SEM_UNDO);
+            return false;
+        }
+        addMember(client);
+        addMember(dependent);
 
-        if (semop(semId, &unlock, 1) == -1) {
-            std::cout << "Failed to release semaphore for pool " << getName()
-                      << ", errno: " << errno << " (" << strerror(errno) << ")" << std::endl;
-            throw PoolSystemError("Failed to release pool semaphore in enter()");
+        if (LockStats::release(semId, semaphore, SEM_UNDO) == -1) {
+            EventLog::log(LOG_POOL_UNLOCK_FAILED, poolIndex, errno, errno);
+            throw PoolSystemError("Failed to release pool semaphore in enterWithDependent()");
         }
 
+        trace.setResult(1);
         return true;
     } catch (const std::exception &e) {
-        std::cout << "Exception in enter() for pool " << getName()
+        std::cout << "Exception in enterWithDependent() for pool " << getName()
                   << ": " << e.what() << std::endl;
-        semop(semId, &unlock, 1);
+        LockStats::release(semId, semaphore, SEM_UNDO);
         throw;
     }
 }
 
 void Pool::leave(int clientId) {
-    struct sembuf lock = {static_cast<unsigned short>(getPoolSemaphore()), -1, SEM_UNDO};
-    if (semop(semId, &lock, 1) == -1) {
+    LatencyScope latency(LATENCY_OP_POOL_LEAVE);
+    TraceScope trace(TRACE_POOL_LEAVE, clientId, static_cast<int>(poolType));
+    auto semaphore = static_cast<unsigned short>(getPoolSemaphore());
+    if (LockStats::acquire(semId, semaphore, SEM_UNDO) == -1) {
         throw PoolSystemError("Failed to acquire pool semaphore in leave()");
     }
 
     try {
         ScopedLock stateLock(stateMutex);
-        std::vector<int> clientsToRemove;
 
-        for (int i = 0; i < state->currentCount; i++) {
-            if (state->clients[i].id == clientId || state->clients[i].guardianId == clientId) {
-                clientsToRemove.push_back(i);
-            }
+        // The client and the children they brought in
+        int index;
+        while ((index = RosterScan::findMember(state->ids, state->guardianIds, state->currentCount, clientId)) >= 0) {
+            state->removeAt(index);
+        }
+
+        if (LockStats::release(semId, semaphore, SEM_UNDO) == -1) {
+            throw PoolSystemError("Failed to release pool semaphore in leave()");
         }
 
-        std::sort(clientsToRemove.begin(), clientsToRemove.end(), std::greater<>());
+    } catch (const std::exception &e) {
+        LockStats::release(semId, semaphore, SEM_UNDO);
+        throw;
+    }
+}
+
+int Pool::reclaimExpired(LeaseCheck &check) {
+    auto semaphore = static_cast<unsigned short>(getPoolSemaphore());
+    int poolIndex = static_cast<int>(poolType);
+    check.judgeOwners(*state);
+    if (LockStats::acquire(semId, semaphore, SEM_UNDO) == -1) {
+        throw PoolSystemError("Failed to acquire pool semaphore in reclaimExpired()");
+    }
 
-        for (int index: clientsToRemove) {
-            if (index < state->currentCount) {
-                state->clients[index] = state->clients[state->currentCount - 1];
-                state->currentCount--;
+    int reclaimed = 0;
+    try {
+        ScopedLock stateLock(stateMutex);
+
+        int expired = 0;
+        while (expired < state->currentCount) {
+            int32_t owner = state->ownerPids[expired];
+            if (!check.expired(owner)) {
+                expired++;
+                continue;
+            }
+            // The same lookup as leave(), so a reclaimed guardian does not leave their child behind
+            int32_t clientId = state->ids[expired];
+            int index;
+            while ((index = RosterScan::findMember(state->ids, state->guardianIds, state->currentCount,
+                                                   clientId)) >= 0) {
+                EventLog::log(LOG_LEASE_RECLAIMED, state->ids[index], poolIndex, owner);
+                state->removeAt(index);
+                reclaimed++;
             }
+            // removeAt moved other entries into the gaps, so look at the same index again
         }
 
-        struct sembuf unlock = {static_cast<unsigned short>(getPoolSemaphore()), 1, SEM_UNDO};
-        if (semop(semId, &unlock, 1) == -1) {
-            throw PoolSystemError("Failed to release pool semaphore in leave()");
+        if (LockStats::release(semId, semaphore, SEM_UNDO) == -1) {
+            throw PoolSystemError("Failed to release pool semaphore in reclaimExpired()");
         }
+    } catch (const std::exception &e) {
+        LockStats::release(semId, semaphore, SEM_UNDO);
+        throw;
+    }
+
+    if (reclaimed > 0) {
+        Metrics::leaseReclaimed(poolIndex, reclaimed);
+    }
+    return reclaimed;
+}
+
+bool Pool::transferTo(Pool &destination, Client &client, Client *dependent) {
+    if (&destination == this) {
+        return false;
+    }
+
+    LatencyScope latency(LATENCY_OP_POOL_TRANSFER);
+    auto sourceSemaphore = static_cast<unsigned short>(getPoolSemaphore());
+    auto destinationSemaphore = static_cast<unsigned short>(destination.getPoolSemaphore());
+
+    // Every path that holds two pool semaphores takes them in this order
+    Pool &first = sourceSemaphore < destinationSemaphore ? *this : destination;
+    Pool &second = sourceSemaphore < destinationSemaphore ? destination : *this;
+    auto firstSemaphore = static_cast<unsigned short>(first.getPoolSemaphore());
+    auto secondSemaphore = static_cast<unsigned short>(second.getPoolSemaphore());
+
+    Leases::hold();
+    if (LockStats::acquire(semId, firstSemaphore, SEM_UNDO) == -1) {
+        EventLog::log(LOG_POOL_LOCK_FAILED, static_cast<int>(first.poolType), errno, errno);
+        return false;
+    }
+    if (LockStats::acquire(semId, secondSemaphore, SEM_UNDO) == -1) {
+        EventLog::log(LOG_POOL_LOCK_FAILED, static_cast<int>(second.poolType), errno, errno);
+        LockStats::release(semId, firstSemaphore, SEM_UNDO);
+        return false;
+    }
 
+    bool moved = false;
+    try {
+        ScopedLock firstLock(first.stateMutex);
+        ScopedLock secondLock(second.stateMutex);
+
+        // Evacuated or reclaimed meanwhile
+        const int32_t *ids = state->ids;
+        const int32_t *end = ids + state->currentCount;
+        bool present = std::find(ids, end, client.getId()) != end;
+
+        if (present && destination.admitsParty(client, dependent)) {
+            int index;
+            while ((index = RosterScan::findMember(state->ids, state->guardianIds, state->currentCount,
+                                                   client.getId())) >= 0) {
+                state->removeAt(index);
+            }
+            destination.addTransferred(client);
+            if (dependent) {
+                destination.addTransferred(*dependent);
+            }
+            Leases::renew();
+            moved = true;
+        }
     } catch (const std::exception &e) {
-        struct sembuf unlock = {static_cast<unsigned short>(getPoolSemaphore()), 1, SEM_UNDO};
-        semop(semId, &unlock, 1);
+        LockStats::release(semId, secondSemaphore, SEM_UNDO);
+        LockStats::release(semId, firstSemaphore, SEM_UNDO);
         throw;
     }
+
+    if (LockStats::release(semId, secondSemaphore, SEM_UNDO) == -1 ||
+        LockStats::release(semId, firstSemaphore, SEM_UNDO) == -1) {
+        throw PoolSystemError("Failed to release pool semaphores in transferTo()");
+    }
+    return moved;
+}
+
+void Pool::resetLocksAfterFork() {
+    pthread_mutex_init(&avgAgeMutex, nullptr);
+    pthread_mutex_init(&stateMutex, nullptr);
 }
 
 bool Pool::isEmpty() const {
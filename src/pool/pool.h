@@ -4,6 +4,7 @@
 struct PoolState;
 
 #include "shared_memory.h"
+#include "admission.h"
 #include <string>
 #include <mutex>
 #include <vector>
@@ -13,6 +14,7 @@ struct PoolState;
 #include "error_handler.h"
 
 class Client;
+class LeaseCheck;
 
 class Pool {
 public:
@@ -22,15 +24,33 @@ public:
         Children = 2
     };
 
-    Pool(PoolType poolType, int capacity, int minAge, int maxAge,
-         double maxAverageAge = 100, bool needsSupervision = false);
+    Pool(PoolType poolType, int capacity, int minAge, int maxAge, double maxAverageAge = 100);
 
     bool enter(Client &client);
 
+    // A guardian and their child under one hold of the pool semaphore, so neither is ever in the
+    // pool without the other; false when either would be refused
+    bool enterWithDependent(Client &client, Client &dependent);
+
     void leave(int clientId);
 
+    // Moves the client, with their dependent if any, from this pool to the destination in one step:
+    // both semaphores are taken in semaphore order, the destination judges the party as enterWithDependent
+    // would, and the party is never in neither pool or in both. false when the destination refuses or
+    // the client is no longer here.
+    bool transferTo(Pool &destination, Client &client, Client *dependent);
+
+    // Gives back the places whose lease expired, with the children their owners brought in; returns
+    // how many places were freed
+    int reclaimExpired(LeaseCheck &check);
+
     bool isEmpty() const;
 
+    // In a child right after fork(): another thread of the parent (lease reaper, maintenance) may
+    // have held a mutex at the moment of the fork, and the child's copy would stay locked forever.
+    // Pool state shared between processes is guarded by the pool semaphore, not by these.
+    void resetLocksAfterFork();
+
     PoolType getType();
 
     PoolState *getState() { return state; }
@@ -58,7 +78,6 @@ public:
 
 
 private:
-    int shmId;
     int semId;
     PoolState *state;
     PoolType poolType;
@@ -66,7 +85,7 @@ private:
     int minAge;
     int maxAge;
     double maxAverageAge;
-    bool needsSupervision;
+    AdmissionEntry admission;
     mutable pthread_mutex_t avgAgeMutex;
     mutable pthread_mutex_t stateMutex;
 
@@ -86,7 +105,17 @@ private:
         ScopedLock &operator=(const ScopedLock &) = delete;
     };
 
-    bool enterWithDependent(Client &client, Client &dependent);
+    // Decision of the pool's policy; refusals are logged and counted
+    int tryAdmit(Client &client, const PoolOccupancy &occupancy, int companionAge);
+
+    void addMember(Client &client);
+
+    void addTransferred(Client &client);
+
+    // Decision on the whole party; the dependent is judged with the client already counted
+    bool admitsParty(Client &client, Client *dependent);
+
+    PoolOccupancy readOccupancy() const;
 };
 
 #endif //SO_PROJEKT_BASEN_POOL_H
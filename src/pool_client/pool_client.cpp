@@ -0,0 +1,72 @@
+#include "client.h"
+#include "client_launch.h"
+#include "client_spawner.h"
+#include "cpu_placement.h"
+#include "pool_manager.h"
+#include "shared_segment.h"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
+// One visitor, started by swimming_pool --spawner exec. Everything else a forked visitor would have
+// inherited is looked up again: the IPC objects by key, the per-run settings from the environment.
+namespace {
+    void handleStopSignal(int) {
+        _exit(0);
+    }
+
+    // As SignalHandler::setChildProcess(), without linking the shutdown code of the main process
+    void installSignalHandlers() {
+        struct sigaction sa{};
+        sa.sa_handler = handleStopSignal;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, nullptr);
+        sigaction(SIGTERM, &sa, nullptr);
+        sigaction(SIGQUIT, &sa, nullptr);
+        signal(SIGPIPE, SIG_IGN);
+    }
+
+    const char *setting(const char *name, const char *defaultValue) {
+        const char *value = getenv(name);
+        return value ? value : defaultValue;
+    }
+
+    void applySettings() {
+        const char *owner = getenv(ClientLaunch::IPC_OWNER_ENV);
+        if (owner) {
+            IpcKeys::usePrivate(static_cast<pid_t>(atol(owner)));
+        }
+        Client::setPoolHopping(atof(setting(ClientLaunch::POOL_HOPPING_ENV, "0")));
+
+        int prefault = atoi(setting(ClientLaunch::SHM_PREFAULT_ENV, "0"));
+        if (prefault > PREFAULT_OFF && prefault < PREFAULT_COUNT) {
+            SharedSegment::setPrefault(static_cast<SegmentPrefault>(prefault));
+        }
+        CpuPlacement::configure("", "", setting(ClientLaunch::CLIENT_CPUS_ENV, ""), "normal",
+                                atoi(setting(ClientLaunch::CLIENT_NICE_ENV, "0")));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    VisitorProfile profile{};
+    if (argc != 2 || !ClientLaunch::parse(argv[1], profile)) {
+        fprintf(stderr, "Usage: %s id,age,flags,childId,childAge (started by swimming_pool --spawner exec)\n",
+                argv[0]);
+        return 1;
+    }
+
+    installSignalHandlers();
+    try {
+        applySettings();
+        if (!SharedSegment::get()) {
+            fprintf(stderr, "pool_client: shared memory not found - is swimming_pool running?\n");
+            return 1;
+        }
+        PoolManager::getInstance()->initialize();
+    } catch (const std::exception &e) {
+        fprintf(stderr, "pool_client: %s\n", e.what());
+        return 1;
+    }
+    return runVisitor(profile) ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+#include "latency_histogram.h"
+#include "shared_memory.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Limit {
+        int op;
+        double fraction;
+        std::string quantile;
+        double maxMs;
+    };
+
+    struct DumpOptions {
+        pid_t ipcOwner = 0;
+        bool json = false;
+        bool perProcess = false;
+        bool buckets = false;
+        std::vector<Limit> limits;
+    };
+
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --format text|json     output format (text)\n"
+                  << "  --per-process on|off   also list every process's own histograms (off)\n"
+                  << "  --buckets on|off       include the non-empty buckets in JSON output (off)\n"
+                  << "  --ipc-owner pid        read a swimming_pool started with --private-ipc on by pid\n"
+                  << "  --limit op:pNN=ms      fail (exit 2) when the merged percentile of op exceeds ms,\n"
+                  << "                         e.g. --limit pool_enter:p99=5; may be repeated\n"
+                  << "Operations: ";
+        for (int op = 0; op < LATENCY_OP_COUNT; op++) {
+            std::cerr << (op ? ", " : "") << LatencyHistograms::opName(op);
+        }
+        std::cerr << std::endl;
+    }
+
+    bool parseLimit(const std::string &text, Limit &limit) {
+        size_t colon = text.find(':');
+        size_t equals = text.find('=', colon);
+        if (colon == std::string::npos || equals == std::string::npos || text[colon + 1] != 'p') {
+            return false;
+        }
+
+        std::string name = text.substr(0, colon);
+        limit.op = -1;
+        for (int op = 0; op < LATENCY_OP_COUNT; op++) {
+            if (name == LatencyHistograms::opName(op)) {
+                limit.op = op;
+            }
+        }
+        std::string digits = text.substr(colon + 2, equals - colon - 2);
+        if (limit.op < 0 || digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        // p99 is 0.99, p999 is 0.999
+        limit.quantile = "p" + digits;
+        limit.fraction = std::stod("0." + digits);
+        limit.maxMs = std::stod(text.substr(equals + 1));
+        return true;
+    }
+
+    bool parseOptions(int argc, char *argv[], DumpOptions &options) {
+        for (int i = 1; i < argc; i++) {
+            std::string option = argv[i];
+            if (i + 1 >= argc) {
+                return false;
+            }
+            std::string value = argv[++i];
+
+            if (option == "--format" && (value == "text" || value == "json")) {
+                options.json = value == "json";
+            } else if (option == "--per-process" && (value == "on" || value == "off")) {
+                options.perProcess = value == "on";
+            } else if (option == "--buckets" && (value == "on" || value == "off")) {
+                options.buckets = value == "on";
+            } else if (option == "--ipc-owner") {
+                options.ipcOwner = static_cast<pid_t>(std::stol(value));
+            } else if (option == "--limit") {
+                Limit limit{};
+                if (!parseLimit(value, limit)) {
+                    return false;
+                }
+                options.limits.push_back(limit);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void printText(const std::string &title, const LatencySnapshot snapshots[LATENCY_OP_COUNT], bool skipEmpty) {
+        std::cout << title << "\n";
+        printf("  %-16s %10s %10s %10s %10s %10s %10s %10s\n", "operation", "calls", "mean_us", "p50_us", "p90_us",
+               "p99_us", "p99.9_us", "max_us");
+        for (int op = 0; op < LATENCY_OP_COUNT; op++) {
+            const LatencySnapshot &snapshot = snapshots[op];
+            if (skipEmpty && snapshot.total == 0) {
+                continue;
+            }
+            printf("  %-16s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", LatencyHistograms::opName(op),
+                   static_cast<unsigned long long>(snapshot.total), snapshot.meanNs() / 1e3,
+                   static_cast<double>(snapshot.percentileNs(0.50)) / 1e3,
+                   static_cast<double>(snapshot.percentileNs(0.90)) / 1e3,
+                   static_cast<double>(snapshot.percentileNs(0.99)) / 1e3,
+                   static_cast<double>(snapshot.percentileNs(0.999)) / 1e3,
+                   static_cast<double>(snapshot.maxNs) / 1e3);
+        }
+        fflush(stdout);
+    }
+
+    void printJson(const LatencySnapshot snapshots[LATENCY_OP_COUNT], bool buckets) {
+        std::cout << "[";
+        for (int op = 0; op < LATENCY_OP_COUNT; op++) {
+            const LatencySnapshot &snapshot = snapshots[op];
+            std::cout << (op ? "," : "") << "{\"op\":\"" << LatencyHistograms::opName(op)
+                      << "\",\"count\":" << snapshot.total << ",\"mean\":" << snapshot.meanNs()
+                      << ",\"p50\":" << snapshot.percentileNs(0.50) << ",\"p90\":" << snapshot.percentileNs(0.90)
+                      << ",\"p99\":" << snapshot.percentileNs(0.99) << ",\"p999\":" << snapshot.percentileNs(0.999)
+                      << ",\"max\":" << snapshot.maxNs;
+            if (buckets) {
+                // [highest value of the bucket, count], enough to merge dumps of separate runs again
+                std::cout << ",\"buckets\":[";
+                bool first = true;
+                for (int bucket = 0; bucket < HdrHistogram::BUCKETS; bucket++) {
+                    if (snapshot.counts[bucket]) {
+                        std::cout << (first ? "" : ",") << "[" << HdrHistogram::bucketUpperNs(bucket) << ","
+                                  << snapshot.counts[bucket] << "]";
+                        first = false;
+                    }
+                }
+                std::cout << "]";
+            }
+            std::cout << "}";
+        }
+        std::cout << "]";
+    }
+
+    void slotSnapshots(const LatencySlot &slot, LatencySnapshot snapshots[LATENCY_OP_COUNT]) {
+        for (int op = 0; op < LATENCY_OP_COUNT; op++) {
+            snapshots[op].add(slot.ops[op]);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    DumpOptions options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception &) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (options.ipcOwner > 0) {
+        IpcKeys::usePrivate(options.ipcOwner);
+    }
+    LatencySegment *latency = LatencyHistograms::getSegment();
+    if (!latency) {
+        std::cerr << "Latency histograms not found - is swimming_pool running?" << std::endl;
+        return 1;
+    }
+
+    LatencySnapshot merged[LATENCY_OP_COUNT];
+    for (int op = 0; op < LATENCY_OP_COUNT; op++) {
+        merged[op] = LatencyHistograms::merged(*latency, static_cast<LatencyOp>(op));
+    }
+
+    if (options.json) {
+        std::cout << "{\"format\":\"pool_latency\",\"version\":1,\"unit\":\"ns\",\"operations\":";
+        printJson(merged, options.buckets);
+    } else {
+        printText("All processes", merged, false);
+    }
+
+    if (options.perProcess) {
+        if (options.json) {
+            std::cout << ",\"processes\":[";
+        }
+        bool first = true;
+        for (const auto &slot: latency->slots) {
+            int32_t owner = slot.owner.load(std::memory_order_acquire);
+            if (owner <= 0) {
+                continue;
+            }
+            LatencySnapshot snapshots[LATENCY_OP_COUNT];
+            slotSnapshots(slot, snapshots);
+            if (options.json) {
+                std::cout << (first ? "" : ",") << "{\"pid\":" << owner << ",\"operations\":";
+                printJson(snapshots, options.buckets);
+                std::cout << "}";
+            } else {
+                printText("Process " + std::to_string(owner), snapshots, true);
+            }
+            first = false;
+        }
+        LatencySnapshot retired[LATENCY_OP_COUNT];
+        slotSnapshots(latency->retired, retired);
+        if (options.json) {
+            std::cout << "],\"retired\":";
+            printJson(retired, options.buckets);
+        } else {
+            printText("Exited processes", retired, true);
+        }
+    }
+    if (options.json) {
+        std::cout << "}" << std::endl;
+    }
+
+    int status = 0;
+    for (const Limit &limit: options.limits) {
+        double ms = static_cast<double>(merged[limit.op].percentileNs(limit.fraction)) / 1e6;
+        if (ms > limit.maxMs) {
+            std::cerr << "Limit exceeded: " << LatencyHistograms::opName(limit.op) << " " << limit.quantile << " "
+                      << ms << " ms > " << limit.maxMs << " ms" << std::endl;
+            status = 2;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,602 @@
+#include "pool_loadtest.h"
+#include "error_handler.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    const char *const LATENCY_NAMES[LATENCY_COUNT] = {"arrival_to_ticket", "ticket_to_entry", "evacuation"};
+    const char *const POOL_NAMES[POOL_COUNT] = {"Olympic", "Recreational", "Children"};
+
+    volatile sig_atomic_t interrupted = 0;
+
+    void onInterrupt(int) {
+        interrupted = 1;
+    }
+
+    double percentile(const std::vector<double> &sorted, double fraction) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        auto index = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+        return sorted[std::min(index == 0 ? 0 : index - 1, sorted.size() - 1)];
+    }
+
+    int64_t number(const std::map<std::string, std::string> &args, const std::string &name, int64_t fallback) {
+        auto it = args.find(name);
+        return it == args.end() ? fallback : std::strtoll(it->second.c_str(), nullptr, 10);
+    }
+
+    const double MEMORY_BUDGET_GIB = 4;
+
+    // Name and parent pid from /proc/<pid>/stat; the name may contain spaces and parentheses
+    bool readStat(pid_t pid, std::string &name, pid_t &parent) {
+        std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+        std::string line;
+        if (!std::getline(stat, line)) {
+            return false;
+        }
+        size_t open = line.find('(');
+        size_t close = line.rfind(')');
+        if (open == std::string::npos || close == std::string::npos) {
+            return false;
+        }
+        name = line.substr(open + 1, close - open - 1);
+        char state = 0;
+        return sscanf(line.c_str() + close + 1, " %c %d", &state, &parent) == 2;
+    }
+
+    // Rss and Pss in kB, summed over all mappings
+    bool readRollup(pid_t pid, double &rssKb, double &pssKb) {
+        std::ifstream rollup("/proc/" + std::to_string(pid) + "/smaps_rollup");
+        std::string line;
+        bool rss = false;
+        bool pss = false;
+        while (std::getline(rollup, line)) {
+            double kb = 0;
+            if (sscanf(line.c_str(), "Rss: %lf kB", &kb) == 1) {
+                rssKb = kb;
+                rss = true;
+            } else if (sscanf(line.c_str(), "Pss: %lf kB", &kb) == 1) {
+                pssKb = kb;
+                pss = true;
+            }
+        }
+        return rss && pss;
+    }
+
+    std::string defaultBinary() {
+        char path[PATH_MAX];
+        ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+        if (length <= 0) {
+            return "./swimming_pool";
+        }
+        std::string self(path, length);
+        return self.substr(0, self.rfind('/') + 1) + "swimming_pool";
+    }
+}
+
+LatencySummary LoadStep::summary(LoadLatency latency) const {
+    std::vector<double> sorted = latenciesMs[latency];
+    std::sort(sorted.begin(), sorted.end());
+    return {sorted.size(), percentile(sorted, 0.50), percentile(sorted, 0.90), percentile(sorted, 0.99),
+            sorted.empty() ? 0 : sorted.back()};
+}
+
+double LoadStep::ticketRefusalRate() const {
+    uint64_t requests = ticketsIssued + ticketsRefused;
+    return requests ? static_cast<double>(ticketsRefused) / requests : 0;
+}
+
+double LoadStep::entryRefusalRate() const {
+    uint64_t refused = 0;
+    for (uint64_t count: refusals) {
+        refused += count;
+    }
+    uint64_t attempts = admissions + refused;
+    return attempts ? static_cast<double>(refused) / attempts : 0;
+}
+
+TraceLatencies::TraceLatencies() {
+    std::fill(lastOrderUs, lastOrderUs + POOL_COUNT, -1.0);
+}
+
+// One event object per line, as Tracer::toJson writes them
+bool TraceLatencies::parse(const std::string &line, Event &event) {
+    size_t name = line.find("\"name\":\"");
+    size_t phase = line.find("\"ph\":\"");
+    size_t ts = line.find("\"ts\":");
+    size_t pid = line.find("\"pid\":");
+    size_t tid = line.find("\"tid\":");
+    if (name == std::string::npos || phase == std::string::npos || ts == std::string::npos ||
+        pid == std::string::npos || tid == std::string::npos) {
+        return false;
+    }
+
+    name += 8;
+    event.name = line.substr(name, line.find('"', name) - name);
+    event.phase = line[phase + 6];
+    event.tsUs = std::strtod(line.c_str() + ts + 5, nullptr);
+    event.pid = static_cast<int>(std::strtol(line.c_str() + pid + 6, nullptr, 10));
+    event.tid = static_cast<int>(std::strtol(line.c_str() + tid + 6, nullptr, 10));
+
+    event.args.clear();
+    size_t args = line.find("\"args\":{");
+    if (args == std::string::npos) {
+        return true;
+    }
+    size_t pos = args + 8;
+    while (pos < line.size() && line[pos] == '"') {
+        size_t keyEnd = line.find('"', pos + 1);
+        if (keyEnd == std::string::npos || keyEnd + 2 >= line.size()) {
+            break;
+        }
+        std::string key = line.substr(pos + 1, keyEnd - pos - 1);
+        size_t valueStart = keyEnd + 2;
+        size_t valueEnd;
+        if (line[valueStart] == '"') {
+            valueEnd = line.find('"', valueStart + 1);
+            event.args[key] = line.substr(valueStart + 1, valueEnd - valueStart - 1);
+            valueEnd++;
+        } else {
+            valueEnd = line.find_first_of(",}", valueStart);
+            event.args[key] = line.substr(valueStart, valueEnd - valueStart);
+        }
+        if (valueEnd >= line.size() || line[valueEnd] != ',') {
+            break;
+        }
+        pos = valueEnd + 1;
+    }
+    return true;
+}
+
+void TraceLatencies::handle(const Event &event, LoadStep &step) {
+    std::pair<int, int> thread{event.pid, event.tid};
+
+    if (event.phase == 'B') {
+        open[thread].push_back({event.name, event.tsUs, number(event.args, "client", 0)});
+        return;
+    }
+
+    if (event.phase == 'i' && event.name == "evacuation") {
+        auto poolArg = event.args.find("pool");
+        auto pool = std::find(POOL_NAMES, POOL_NAMES + POOL_COUNT,
+                              poolArg == event.args.end() ? std::string() : poolArg->second);
+        if (pool == POOL_NAMES + POOL_COUNT) {
+            return;
+        }
+        int poolIndex = static_cast<int>(pool - POOL_NAMES);
+        int64_t client = number(event.args, "client", 0);
+        // The lifeguard's order carries client 0, each visitor that hears it records its own
+        if (client == 0) {
+            lastOrderUs[poolIndex] = event.tsUs;
+        } else if (lastOrderUs[poolIndex] >= 0) {
+            evacuating[thread] = {client, lastOrderUs[poolIndex]};
+        }
+        return;
+    }
+
+    if (event.phase != 'E') {
+        return;
+    }
+    auto stack = open.find(thread);
+    if (stack == open.end() || stack->second.empty()) {
+        return;
+    }
+    OpenSpan span = stack->second.back();
+    stack->second.pop_back();
+
+    if (span.name == "ticket_wait") {
+        // Refused tickets end with -1 and never reach a pool
+        if (number(event.args, "ticket", 0) >= 0) {
+            step.latenciesMs[LATENCY_TICKET].push_back((event.tsUs - span.tsUs) / 1000.0);
+            ticketAtUs[span.client] = event.tsUs;
+        }
+    } else if (span.name == "pool_enter") {
+        auto ticket = ticketAtUs.find(span.client);
+        if (number(event.args, "admitted", 0) == 1 && ticket != ticketAtUs.end()) {
+            step.latenciesMs[LATENCY_ENTRY].push_back((event.tsUs - ticket->second) / 1000.0);
+            ticketAtUs.erase(ticket);
+        }
+    } else if (span.name == "pool_leave") {
+        auto evacuation = evacuating.find(thread);
+        if (evacuation != evacuating.end() && evacuation->second.first == span.client) {
+            step.latenciesMs[LATENCY_EVACUATION].push_back((event.tsUs - evacuation->second.second) / 1000.0);
+            evacuating.erase(evacuation);
+        }
+    }
+}
+
+uint64_t TraceLatencies::read(const std::string &path, LoadStep &step) {
+    std::ifstream in(path);
+    if (!in) {
+        return 0;
+    }
+
+    // Timestamps are monotonic but the drain writes the process rings one after another
+    std::vector<Event> events;
+    std::string line;
+    Event event;
+    while (std::getline(in, line)) {
+        if (parse(line, event)) {
+            events.push_back(event);
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.tsUs < b.tsUs; });
+
+    for (const auto &sorted: events) {
+        handle(sorted, step);
+    }
+    return events.size();
+}
+
+LoadTest::LoadTest(const LoadTestOptions &options) : options(options) {
+    if (this->options.binary.empty()) {
+        this->options.binary = defaultBinary();
+    }
+    if (access(this->options.binary.c_str(), X_OK) != 0) {
+        throw PoolError("Cannot run " + this->options.binary + ", pass --binary");
+    }
+}
+
+VisitorMemory LoadTest::sampleVisitors(pid_t simulation) {
+    VisitorMemory memory{};
+    std::vector<std::pair<pid_t, pid_t>> visitors;      // pid, parent
+    std::map<pid_t, pid_t> parents;
+    for (const auto &entry: std::filesystem::directory_iterator("/proc")) {
+        std::string file = entry.path().filename();
+        if (file.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        pid_t pid = static_cast<pid_t>(std::stol(file));
+        std::string name;
+        pid_t parent = 0;
+        if (!readStat(pid, name, parent)) {
+            continue;
+        }
+        parents[pid] = parent;
+        // client_<id> runs a visitor; idle zygote workers are client_idle
+        if (name.compare(0, 7, "client_") == 0 && name.size() > 7 && isdigit(static_cast<unsigned char>(name[7]))) {
+            visitors.emplace_back(pid, parent);
+        }
+    }
+
+    for (const auto &visitor: visitors) {
+        auto grandparent = parents.find(visitor.second);
+        bool ours = visitor.second == simulation ||
+                    (grandparent != parents.end() && grandparent->second == simulation);
+        double rssKb = 0;
+        double pssKb = 0;
+        if (ours && readRollup(visitor.first, rssKb, pssKb)) {
+            memory.visitors++;
+            memory.rssKb += rssKb;
+            memory.pssKb += pssKb;
+        }
+    }
+    if (memory.visitors) {
+        memory.rssKb /= static_cast<double>(memory.visitors);
+        memory.pssKb /= static_cast<double>(memory.visitors);
+    }
+    return memory;
+}
+
+LoadStep LoadTest::runStep(double rate, bool placed) {
+    std::string tracePath = "/tmp/pool_loadtest_" + std::to_string(getpid()) + "_trace.json";
+    std::ostringstream model;
+    model << options.arrival << ":rate=" << rate;
+
+    std::vector<std::string> args = {options.binary, "--private-ipc", "on", "--trace", "on",
+                                     "--trace-file", tracePath, "--log-file", "/dev/null",
+                                     "--arrival", model.str(), "--speed", std::to_string(options.speed),
+                                     "--sim-start", "9:00", "--seed", std::to_string(options.seed)};
+    if (!options.mix.empty()) {
+        args.emplace_back("--mix");
+        args.push_back(options.mix);
+    }
+    if (placed) {
+        args.insert(args.end(), options.placementArgs.begin(), options.placementArgs.end());
+    }
+    if (!options.spawner.empty()) {
+        args.emplace_back("--spawner");
+        args.push_back(options.spawner);
+    }
+
+    pid_t child = fork();
+    checkSystemCall(child, "fork failed in pool_loadtest");
+    if (child == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        std::vector<char *> argv;
+        for (auto &arg: args) {
+            argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+        execv(options.binary.c_str(), argv.data());
+        _exit(127);
+    }
+
+    LoadStep step{};
+    step.rate = rate;
+    step.placed = placed;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    int status = 0;
+    while (!interrupted && elapsed() < options.durationS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (waitpid(child, &status, WNOHANG) == child) {
+            unlink(tracePath.c_str());
+            throw PoolError("swimming_pool exited early with status " + std::to_string(WEXITSTATUS(status)));
+        }
+    }
+    step.elapsedS = elapsed();
+    step.memory = sampleVisitors(child);
+
+    // The counters live in the simulation's segment, under keys derived from its pid
+    IpcKeys::usePrivate(child);
+    size_t mappedBytes = 0;
+    SharedMemory *shm = SharedSegment::attachReadOnly(mappedBytes);
+    if (shm) {
+        const MetricsRegistry &metrics = shm->metrics;
+        step.ticketsIssued = metrics.ticketsIssued.load();
+        step.ticketsRefused = metrics.ticketsRefused.load();
+        for (int pool = 0; pool < POOL_COUNT; pool++) {
+            step.admissions += metrics.admissions[pool].load();
+            step.evacuations += metrics.evacuations[pool].load();
+            for (int reason = 0; reason < REFUSAL_REASON_COUNT; reason++) {
+                step.refusals[reason] += metrics.refusals[pool][reason].load();
+            }
+        }
+        SharedSegment::detach(shm, mappedBytes);
+    } else {
+        std::cerr << "Cannot attach to the simulation's counters" << std::endl;
+    }
+
+    kill(child, SIGINT);
+    waitpid(child, &status, 0);
+
+    step.traceEvents = TraceLatencies().read(tracePath, step);
+    unlink(tracePath.c_str());
+    return step;
+}
+
+void LoadTest::printStep(const LoadStep &step, std::ostream &out) const {
+    out << std::fixed << std::setprecision(2)
+        << "rate " << step.rate << "/s x" << options.speed << (step.placed ? " with placement" : "") << ": "
+        << std::setprecision(1) << step.elapsedS << " s, tickets " << std::setprecision(2) << step.ticketsPerSecond()
+        << "/s, ticket refusals " << std::setprecision(1) << step.ticketRefusalRate() * 100 << "%, pool refusals "
+        << step.entryRefusalRate() * 100 << "%, evacuations " << step.evacuations << "\n"
+        << "  " << std::left << std::setw(20) << "latency ms" << std::right << std::setw(8) << "count"
+        << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max"
+        << "\n";
+    for (int latency = 0; latency < LATENCY_COUNT; latency++) {
+        LatencySummary summary = step.summary(static_cast<LoadLatency>(latency));
+        out << "  " << std::left << std::setw(20) << LATENCY_NAMES[latency] << std::right << std::setw(8)
+            << summary.count << std::setprecision(1) << std::setw(10) << summary.p50Ms << std::setw(10)
+            << summary.p90Ms << std::setw(10) << summary.p99Ms << std::setw(10) << summary.maxMs << "\n";
+    }
+    if (step.memory.visitors) {
+        out << std::setprecision(0) << "  visitor memory: " << step.memory.visitors << " processes, RSS "
+            << step.memory.rssKb << " kB, PSS " << step.memory.pssKb << " kB each, about "
+            << step.memory.visitorsPerGiB(MEMORY_BUDGET_GIB) << " visitors in " << MEMORY_BUDGET_GIB << " GB\n";
+    }
+    out.flush();
+}
+
+void LoadTest::printPlacementEffect(const LoadStep &unplaced, const LoadStep &placed) const {
+    LatencySummary before = unplaced.summary(LATENCY_EVACUATION);
+    LatencySummary after = placed.summary(LATENCY_EVACUATION);
+    std::cout << std::fixed << std::setprecision(1) << "Placement at " << placed.rate << "/s: evacuation p99 "
+              << before.p99Ms << " -> " << after.p99Ms << " ms, max " << before.maxMs << " -> " << after.maxMs
+              << " ms (" << before.count << " and " << after.count << " visitors evacuated)" << std::endl;
+}
+
+// Names and keys only change together with the version
+void LoadTest::writeReport(const std::vector<LoadStep> &steps, double saturationRate) const {
+    std::ofstream out(options.reportFile);
+    if (!out) {
+        throw PoolError("Cannot write " + options.reportFile);
+    }
+    out << std::setprecision(6)
+        << "{\"format\":\"pool_loadtest\",\"version\":1,\n"
+        << "\"options\":{\"arrival\":\"" << options.arrival << "\",\"speed\":" << options.speed
+        << ",\"duration_s\":" << options.durationS << ",\"seed\":" << options.seed
+        << ",\"ramp_latency\":\"" << options.rampLatency << "\",\"ramp_p99_ms\":" << options.rampP99Ms
+        << ",\"spawner\":\"" << options.spawner << "\",\"placement\":\"";
+    for (size_t i = 0; i < options.placementArgs.size(); i++) {
+        out << (i ? " " : "") << options.placementArgs[i];
+    }
+    out << "\"},\n"
+        << "\"steps\":[";
+    for (size_t i = 0; i < steps.size(); i++) {
+        const LoadStep &step = steps[i];
+        out << (i ? ",\n" : "\n") << "{\"rate\":" << step.rate << ",\"placed\":" << (step.placed ? "true" : "false")
+            << ",\"elapsed_s\":" << step.elapsedS
+            << ",\"tickets_issued\":" << step.ticketsIssued << ",\"tickets_per_s\":" << step.ticketsPerSecond()
+            << ",\"ticket_refusal_rate\":" << step.ticketRefusalRate()
+            << ",\"admissions\":" << step.admissions << ",\"entry_refusal_rate\":" << step.entryRefusalRate()
+            << ",\"evacuations\":" << step.evacuations << ",\"trace_events\":" << step.traceEvents
+            << ",\"visitor_memory\":{\"visitors\":" << step.memory.visitors << ",\"rss_kb\":" << step.memory.rssKb
+            << ",\"pss_kb\":" << step.memory.pssKb << ",\"visitors_per_4gb\":"
+            << step.memory.visitorsPerGiB(MEMORY_BUDGET_GIB) << "}"
+            << ",\"refusals\":{";
+        for (int reason = 0; reason < REFUSAL_REASON_COUNT; reason++) {
+            out << (reason ? "," : "") << "\"" << Metrics::refusalLabel(reason) << "\":" << step.refusals[reason];
+        }
+        out << "},\"latency_ms\":{";
+        for (int latency = 0; latency < LATENCY_COUNT; latency++) {
+            LatencySummary summary = step.summary(static_cast<LoadLatency>(latency));
+            out << (latency ? "," : "") << "\"" << LATENCY_NAMES[latency] << "\":{\"count\":" << summary.count
+                << ",\"p50\":" << summary.p50Ms << ",\"p90\":" << summary.p90Ms << ",\"p99\":" << summary.p99Ms
+                << ",\"max\":" << summary.maxMs << "}";
+        }
+        out << "}}";
+    }
+    out << "\n],\n\"saturation_rate\":";
+    if (saturationRate >= 0) {
+        out << saturationRate;
+    } else {
+        out << "null";
+    }
+    out << "}\n";
+}
+
+int LoadTest::run() {
+    signal(SIGINT, onInterrupt);
+    signal(SIGTERM, onInterrupt);
+
+    LoadLatency rampOn = options.rampLatency == "entry" ? LATENCY_ENTRY : LATENCY_TICKET;
+    std::vector<LoadStep> steps;
+    double sustained = -1;
+    double rate = options.rate;
+
+    while (!interrupted) {
+        if (options.comparePlacement) {
+            steps.push_back(runStep(rate, false));
+            printStep(steps.back(), std::cout);
+            if (interrupted) {
+                break;
+            }
+        }
+        steps.push_back(runStep(rate, !options.placementArgs.empty()));
+        printStep(steps.back(), std::cout);
+        if (options.comparePlacement) {
+            printPlacementEffect(steps[steps.size() - 2], steps.back());
+        }
+        if (options.rampP99Ms <= 0) {
+            break;
+        }
+
+        // Steps up the rate until the chosen p99 breaches the threshold; the last rate below it is the
+        // highest load the facility sustains
+        LatencySummary summary = steps.back().summary(rampOn);
+        if (summary.p99Ms > options.rampP99Ms) {
+            std::cout << "p99 " << LATENCY_NAMES[rampOn] << " " << summary.p99Ms << " ms over "
+                      << options.rampP99Ms << " ms at " << rate << "/s" << std::endl;
+            break;
+        }
+        sustained = rate;
+        rate *= options.rampFactor;
+        if (rate > options.maxRate) {
+            break;
+        }
+    }
+
+    if (options.rampP99Ms > 0) {
+        if (sustained >= 0) {
+            std::cout << "Saturation: sustained " << sustained << " visitors/s" << std::endl;
+        } else {
+            std::cout << "Saturation: threshold breached at the first step" << std::endl;
+        }
+    }
+    writeReport(steps, sustained);
+    std::cout << "Report: " << options.reportFile << std::endl;
+    return 0;
+}
+
+namespace {
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --rate r               visitors per simulated second, the first step when ramping (0.2)\n"
+                  << "  --duration s           real seconds each step runs the facility (60)\n"
+                  << "  --arrival model        periodic or poisson (poisson)\n"
+                  << "  --speed x              simulated clock speed passed to swimming_pool (10)\n"
+                  << "  --mix shares           visitor demographics, as for swimming_pool\n"
+                  << "  --seed n               random seed (1)\n"
+                  << "  --report path          machine-readable JSON report (/tmp/pool_loadtest.json)\n"
+                  << "  --ramp-p99-ms ms       multiply the rate by --ramp-factor (1.5) after each step until\n"
+                  << "                         the p99 of --ramp-latency ticket|entry (ticket) exceeds ms\n"
+                  << "  --max-rate r           stop ramping above this rate (100)\n"
+                  << "  --binary path          swimming_pool to start (next to pool_loadtest)\n"
+                  << "  --lifeguard-cpus list, --cashier-cpus list, --client-cpus list, --lifeguard-priority p,\n"
+                  << "  --client-nice n        CPU placement passed on to swimming_pool\n"
+                  << "  --spawner spec         how swimming_pool starts visitors, e.g. exec (its default)\n"
+                  << "  --compare-placement on|off\n"
+                  << "                         run each rate without and then with the placement and compare\n"
+                  << "                         the evacuation tail latency (off)\n"
+                  << "Latencies are real milliseconds, taken from the trace of a swimming_pool run with\n"
+                  << "--private-ipc on, so a simulation running at the same time is not disturbed.\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    LoadTestOptions options;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string option = argv[i];
+            if (i + 1 >= argc) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[++i];
+
+            if (option == "--rate") {
+                options.rate = std::stod(value);
+            } else if (option == "--duration") {
+                options.durationS = std::stod(value);
+            } else if (option == "--arrival") {
+                options.arrival = value;
+            } else if (option == "--speed") {
+                options.speed = std::stod(value);
+            } else if (option == "--mix") {
+                options.mix = value;
+            } else if (option == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (option == "--report") {
+                options.reportFile = value;
+            } else if (option == "--ramp-p99-ms") {
+                options.rampP99Ms = std::stod(value);
+            } else if (option == "--ramp-latency") {
+                options.rampLatency = value;
+            } else if (option == "--ramp-factor") {
+                options.rampFactor = std::stod(value);
+            } else if (option == "--max-rate") {
+                options.maxRate = std::stod(value);
+            } else if (option == "--binary") {
+                options.binary = value;
+            } else if (option == "--lifeguard-cpus" || option == "--cashier-cpus" || option == "--client-cpus" ||
+                       option == "--lifeguard-priority" || option == "--client-nice") {
+                options.placementArgs.push_back(option);
+                options.placementArgs.push_back(value);
+            } else if (option == "--spawner") {
+                options.spawner = value;
+            } else if (option == "--compare-placement" && (value == "on" || value == "off")) {
+                options.comparePlacement = value == "on";
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        if (options.rate <= 0 || options.durationS <= 0 || options.speed <= 0 || options.rampFactor <= 1 ||
+            (options.arrival != "periodic" && options.arrival != "poisson") ||
+            (options.rampLatency != "ticket" && options.rampLatency != "entry") ||
+            (options.comparePlacement && options.placementArgs.empty())) {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        LoadTest loadTest(options);
+        return loadTest.run();
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
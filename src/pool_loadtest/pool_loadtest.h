@@ -0,0 +1,136 @@
+#ifndef SWIMMING_POOL_POOL_LOADTEST_H
+#define SWIMMING_POOL_POOL_LOADTEST_H
+
+#include "shared_memory.h"
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct LoadTestOptions {
+    std::string binary;             // swimming_pool, next to pool_loadtest by default
+    std::string arrival = "poisson";
+    double rate = 0.2;              // visitors per simulated second
+    double durationS = 60;          // real seconds per step
+    double speed = 10;
+    std::string mix;
+    uint64_t seed = 1;
+    std::string reportFile = "/tmp/pool_loadtest.json";
+    double rampP99Ms = 0;           // 0 runs one step at rate
+    std::string rampLatency = "ticket";
+    double rampFactor = 1.5;
+    double maxRate = 100;
+    std::vector<std::string> placementArgs;    // --lifeguard-cpus and friends, passed on to swimming_pool
+    bool comparePlacement = false;              // run every rate without and then with placementArgs
+    std::string spawner;                        // --spawner of swimming_pool, its default when empty
+};
+
+enum LoadLatency {
+    LATENCY_TICKET,         // visitor at the cashier until the ticket arrives
+    LATENCY_ENTRY,          // ticket until the first admission to a pool
+    LATENCY_EVACUATION,     // lifeguard's evacuation order until the visitor is out of the pool
+    LATENCY_COUNT
+};
+
+struct LatencySummary {
+    size_t count;
+    double p50Ms;
+    double p90Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+// Memory of the visitor processes running when a step ends. PSS splits each shared page among the
+// processes mapping it, so visitors times pssKb is what they cost the machine together.
+struct VisitorMemory {
+    size_t visitors;
+    double rssKb;           // per visitor
+    double pssKb;
+
+    // How many such visitors fit in that much memory, leaving out the rest of the facility
+    double visitorsPerGiB(double gib) const { return pssKb > 0 ? gib * 1024 * 1024 / pssKb : 0; }
+};
+
+struct LoadStep {
+    double rate;
+    bool placed;
+    VisitorMemory memory;
+    double elapsedS;
+    std::vector<double> latenciesMs[LATENCY_COUNT];
+    uint64_t ticketsIssued;
+    uint64_t ticketsRefused;
+    uint64_t admissions;
+    uint64_t refusals[REFUSAL_REASON_COUNT];
+    uint64_t evacuations;
+    uint64_t traceEvents;
+
+    LatencySummary summary(LoadLatency latency) const;
+
+    double ticketsPerSecond() const { return elapsedS > 0 ? ticketsIssued / elapsedS : 0; }
+
+    double ticketRefusalRate() const;
+
+    double entryRefusalRate() const;
+};
+
+// Pairs the begin/end entries of the Chrome trace the log drain writes into per-visitor latencies.
+// Spans are matched per thread, visitors by the client id carried in the span arguments.
+class TraceLatencies {
+private:
+    struct Event {
+        std::string name;
+        char phase;
+        double tsUs;
+        int pid;
+        int tid;
+        std::map<std::string, std::string> args;
+    };
+
+    struct OpenSpan {
+        std::string name;
+        double tsUs;
+        int64_t client;
+    };
+
+    std::map<std::pair<int, int>, std::vector<OpenSpan>> open;
+    std::map<int64_t, double> ticketAtUs;
+    std::map<std::pair<int, int>, std::pair<int64_t, double>> evacuating;
+    double lastOrderUs[POOL_COUNT];
+
+    static bool parse(const std::string &line, Event &event);
+
+    void handle(const Event &event, LoadStep &step);
+
+public:
+    TraceLatencies();
+
+    // Returns the number of trace events read
+    uint64_t read(const std::string &path, LoadStep &step);
+};
+
+// Runs swimming_pool with private IPC keys and tracing on for one step per rate, reads its counters
+// just before stopping it and its trace afterwards
+class LoadTest {
+private:
+    LoadTestOptions options;
+
+    LoadStep runStep(double rate, bool placed);
+
+    // Visitor processes are children of the simulation, or of its zygote
+    static VisitorMemory sampleVisitors(pid_t simulation);
+
+    void printPlacementEffect(const LoadStep &unplaced, const LoadStep &placed) const;
+
+    void printStep(const LoadStep &step, std::ostream &out) const;
+
+    void writeReport(const std::vector<LoadStep> &steps, double saturationRate) const;
+
+public:
+    explicit LoadTest(const LoadTestOptions &options);
+
+    int run();
+};
+
+#endif
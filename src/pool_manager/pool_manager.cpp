@@ -1,4 +1,7 @@
 #include "pool_manager.h"
+#include "admission.h"
+#include "client.h"
+#include <pthread.h>
 
 PoolManager* PoolManager::instance = nullptr;
 
@@ -12,9 +15,27 @@ PoolManager* PoolManager::getInstance() {
 }
 
 void PoolManager::initialize() {
-    olympicPool = std::make_unique<Pool>(Pool::PoolType::Olympic, 100, 18, 70);
-    recreationalPool = std::make_unique<Pool>(Pool::PoolType::Recreational, 40, 0, 70, 40);
-    kidsPool = std::make_unique<Pool>(Pool::PoolType::Children, 20, 0, 70);
+    static bool forkHandlerInstalled = false;
+    if (!forkHandlerInstalled) {
+        forkHandlerInstalled = true;
+        pthread_atfork(nullptr, nullptr, [] {
+            for (auto type: {Pool::PoolType::Olympic, Pool::PoolType::Recreational, Pool::PoolType::Children}) {
+                if (Pool *pool = PoolManager::getInstance()->getPool(type)) {
+                    pool->resetLocksAfterFork();
+                }
+            }
+        });
+    }
+
+    const PoolRules &olympic = POOL_RULES[POOL_OLYMPIC];
+    const PoolRules &recreational = POOL_RULES[POOL_RECREATIONAL];
+    const PoolRules &kids = POOL_RULES[POOL_CHILDREN];
+    olympicPool = std::make_unique<Pool>(Pool::PoolType::Olympic, olympic.capacity, olympic.minAge, olympic.maxAge,
+                                         olympic.maxAverageAge);
+    recreationalPool = std::make_unique<Pool>(Pool::PoolType::Recreational, recreational.capacity,
+                                              recreational.minAge, recreational.maxAge, recreational.maxAverageAge);
+    kidsPool = std::make_unique<Pool>(Pool::PoolType::Children, kids.capacity, kids.minAge, kids.maxAge,
+                                      kids.maxAverageAge);
 }
 
 Pool* PoolManager::getPool(Pool::PoolType type) {
@@ -29,3 +50,12 @@ Pool* PoolManager::getPool(Pool::PoolType type) {
             return nullptr;
     }
 }
+
+bool PoolManager::transfer(Client &client, Client *dependent, Pool::PoolType destination) {
+    Pool *source = client.getCurrentPool();
+    Pool *target = getPool(destination);
+    if (!source || !target || source == target) {
+        return false;
+    }
+    return source->transferTo(*target, client, dependent);
+}
@@ -24,6 +24,10 @@ public:
     }
     Pool* getPool(Pool::PoolType type);
 
+    // Moves a visitor in a pool, with their dependent, to another pool without leaving in between;
+    // false when they are in no pool or the destination refuses them
+    bool transfer(Client &client, Client *dependent, Pool::PoolType destination);
+
     PoolManager(const PoolManager&) = delete;
     PoolManager& operator=(const PoolManager&) = delete;
 
@@ -0,0 +1,535 @@
+#include "pool_sim.h"
+#include "error_handler.h"
+#include "metrics.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    const double DAY_S = 24 * 3600;
+
+    // Timing of the live processes: the cashier's processQueueLoop, Ticket validity, the retry
+    // loop of Client::moveToAnotherPool, Lifeguard::run and runMaintenanceThread
+    const double CASHIER_INTERVAL_S = 2;
+    const double TICKET_VALIDITY_S = 60;
+    const int MAX_ENTER_RETRIES = 3;
+    const double RETRY_WAIT_S = 3;
+    const double CLOSED_WAIT_S = 6;
+    const double EVACUATED_RETRY_S = 1;
+    const double LIFEGUARD_INTERVAL_S = 3;
+    const double LIFEGUARD_WARMUP_S = 5;
+    const double EVACUATION_CLOSED_S = 5;
+    const double EMERGENCY_CLOSED_S = 1;
+    const int EVACUATION_PERCENT = 10;
+    const int EMERGENCY_PERCENT = 1;
+    const double FIRST_MAINTENANCE_S = 120;
+    const double MAINTENANCE_DURATION_S = 10;
+    const double MAINTENANCE_GAP_S = 240;
+
+    const double LANE_DELAYS[LANE_COUNT] = {0, EVACUATED_RETRY_S, RETRY_WAIT_S, CLOSED_WAIT_S, TICKET_VALIDITY_S};
+
+    const char *const POOL_NAMES[POOL_COUNT] = {"Olympic", "Recreational", "Children"};
+
+    time_t firstDayMidnight() {
+        time_t today = time(nullptr);
+        struct tm timeinfo{};
+        localtime_r(&today, &timeinfo);
+        timeinfo.tm_hour = 0;
+        timeinfo.tm_min = 0;
+        timeinfo.tm_sec = 0;
+        timeinfo.tm_isdst = -1;
+        return mktime(&timeinfo);
+    }
+}
+
+PoolSimulation::PoolSimulation(const SimOptions &options)
+        : options(options), rng(options.seed), pendingArrival{}, now(0), entranceQueue{}, pools{},
+          maintenance(false), maintenanceEnd(0), hoursOpen(true), counters{}, processed(0), runSeconds(0) {
+    if (options.days < 1 || options.openHour < 0 || options.closeHour > 24 || options.openHour >= options.closeHour) {
+        throw PoolError("Invalid simulation length or opening hours");
+    }
+
+    startTime = options.openHour * 3600.0;
+    endTime = startTime + options.days * DAY_S;
+    now = startTime;
+
+    queueSettings = QueueSettings::parse(options.queuePolicy, options.queueSlo);
+    queueSettings.apply(entranceQueue);
+
+    arrivalModel = ArrivalModel::create(options.arrivalModel,
+                                        firstDayMidnight() + static_cast<time_t>(startTime));
+    if (!options.demographicMix.empty()) {
+        mix = DemographicMix::parse(options.demographicMix);
+    }
+}
+
+void PoolSimulation::scheduleVisitor(SimLane lane, SimEventType type, uint32_t slot) {
+    events.push(lane, SimEvent{now + LANE_DELAYS[lane], slot, static_cast<uint16_t>(type), visitors[slot].generation});
+}
+
+double PoolSimulation::nextOpening(double time) const {
+    double opening = std::floor(time / DAY_S) * DAY_S + options.openHour * 3600.0;
+    return opening > time ? opening : opening + DAY_S;
+}
+
+void PoolSimulation::refreshClosed(SimPool &pool) {
+    pool.occupancy.isClosed = pool.closedByLifeguard || pool.closedForHours || maintenance;
+}
+
+void PoolSimulation::addPerson(SimPool &pool, int age) {
+    pool.occupancyArea += pool.occupancy.count * (now - pool.lastChange);
+    pool.lastChange = now;
+    pool.occupancy.count++;
+    pool.occupancy.ageSum += age;
+}
+
+void PoolSimulation::removePerson(SimPool &pool, int age) {
+    pool.occupancyArea += pool.occupancy.count * (now - pool.lastChange);
+    pool.lastChange = now;
+    pool.occupancy.count--;
+    pool.occupancy.ageSum -= age;
+}
+
+// Same choice as Client::moveToAnotherPool
+int PoolSimulation::choosePool(const Visitor &visitor) {
+    bool adultWantsToGoToRecreational = rng() % 100 < 25;
+    if (visitor.childAge > 0 && visitor.childAge <= 5) {
+        return POOL_CHILDREN;
+    }
+    if (visitor.childAge > 0 || visitor.age < 18 || adultWantsToGoToRecreational) {
+        return POOL_RECREATIONAL;
+    }
+    return POOL_OLYMPIC;
+}
+
+// A guardian enters first and the child is checked against the occupancy including the guardian,
+// as with the two Pool::enter calls of the live client
+bool PoolSimulation::tryEnter(int pool, uint32_t slot) {
+    Visitor &visitor = visitors[slot];
+    SimPool &target = pools[pool];
+    AdmitFunction tryAdmit = ADMISSION_POLICIES[pool].tryAdmit;
+
+    int decision = tryAdmit(POOL_RULES[pool], target.occupancy,
+                            AdmissionRequest{visitor.age, false, false, visitor.childAge > 0, 0});
+    if (decision != ADMITTED) {
+        counters.refusals[pool][decision]++;
+        return false;
+    }
+    addPerson(target, visitor.age);
+    counters.admissions[pool]++;
+
+    if (visitor.childAge > 0) {
+        decision = tryAdmit(POOL_RULES[pool], target.occupancy,
+                            AdmissionRequest{visitor.childAge, visitor.childHasSwimDiaper, true, false, 0});
+        if (decision != ADMITTED) {
+            counters.refusals[pool][decision]++;
+            removePerson(target, visitor.age);
+            return false;
+        }
+        addPerson(target, visitor.childAge);
+        counters.admissions[pool]++;
+    }
+
+    visitor.pool = static_cast<int8_t>(pool);
+    visitor.memberIndex = static_cast<uint32_t>(target.members.size());
+    target.members.push_back(slot);
+    return true;
+}
+
+void PoolSimulation::leavePool(uint32_t slot) {
+    Visitor &visitor = visitors[slot];
+    SimPool &pool = pools[visitor.pool];
+
+    removePerson(pool, visitor.age);
+    if (visitor.childAge > 0) {
+        removePerson(pool, visitor.childAge);
+    }
+
+    uint32_t moved = pool.members.back();
+    pool.members[visitor.memberIndex] = moved;
+    visitors[moved].memberIndex = visitor.memberIndex;
+    pool.members.pop_back();
+    visitor.pool = -1;
+}
+
+void PoolSimulation::depart(uint32_t slot) {
+    if (visitors[slot].pool >= 0) {
+        leavePool(slot);
+    }
+    visitors[slot].generation++;
+    freeSlots.push_back(slot);
+}
+
+void PoolSimulation::evacuate(int pool, bool leaveFacility) {
+    SimPool &target = pools[pool];
+    while (!target.members.empty()) {
+        uint32_t slot = target.members.back();
+        if (leaveFacility) {
+            counters.leftForMaintenance++;
+            depart(slot);
+        } else {
+            leavePool(slot);
+            visitors[slot].retries = 0;
+            scheduleVisitor(LANE_EVACUATED, SIM_ENTER, slot);
+        }
+    }
+}
+
+void PoolSimulation::onArrival() {
+    Arrival arrival = pendingArrival;
+    if (arrivalModel->next(arrival.time, rng, pendingArrival)) {
+        schedule(startTime + pendingArrival.time, SIM_ARRIVAL);
+    }
+
+    counters.arrivals++;
+    if (!isOpen()) {
+        counters.arrivalsWhileClosed++;
+        return;
+    }
+
+    VisitorProfile profile{};
+    if (arrival.hasProfile) {
+        profile = arrival.profile;
+    } else {
+        mix.fill(profile, rng);
+    }
+
+    uint32_t slot;
+    if (freeSlots.empty()) {
+        slot = static_cast<uint32_t>(visitors.size());
+        visitors.push_back(Visitor{});
+    } else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    Visitor &visitor = visitors[slot];
+    visitor.age = profile.age;
+    visitor.childAge = profile.isGuardian ? profile.childAge : 0;
+    visitor.childHasSwimDiaper = profile.childHasSwimDiaper;
+    visitor.isVip = profile.isVip;
+    visitor.pool = -1;
+    visitor.retries = 0;
+    visitor.arrivalTime = now;
+
+    EntranceQueue::QueueEntry entry{};
+    entry.clientId = static_cast<int>(slot);
+    entry.isVip = profile.isVip;
+    entry.age = profile.age;
+    entry.arrivalTime = static_cast<time_t>(now);
+    if (entranceQueue.insert(entry) < 0) {
+        counters.ticketsRefused++;
+        visitor.generation++;
+        freeSlots.push_back(slot);
+    }
+}
+
+void PoolSimulation::onCashier() {
+    schedule(now + CASHIER_INTERVAL_S, SIM_CASHIER);
+    if (entranceQueue.queueSize == 0) {
+        return;
+    }
+
+    auto slot = static_cast<uint32_t>(entranceQueue.queue[0].clientId);
+    int queueClass = EntranceQueue::classOf(entranceQueue.queue[0]);
+    entranceQueue.removeFront();
+
+    double wait = now - visitors[slot].arrivalTime;
+    double slo = entranceQueue.waitSloS[queueClass];
+    counters.ticketsIssued++;
+    counters.queueWaitSum += wait;
+    counters.queueServed[queueClass]++;
+    counters.queueClassWaitSum[queueClass] += wait;
+    counters.queueWaitMax[queueClass] = std::max(counters.queueWaitMax[queueClass], wait);
+    counters.queueSloMissed[queueClass] += slo > 0 && wait > slo;
+    scheduleVisitor(LANE_EXPIRY, SIM_EXPIRY, slot);
+    scheduleVisitor(LANE_NOW, SIM_ENTER, slot);
+}
+
+void PoolSimulation::onEnter(uint32_t slot) {
+    Visitor &visitor = visitors[slot];
+    if (!isOpen()) {
+        if (maintenance) {
+            counters.leftForMaintenance++;
+            depart(slot);
+        } else {
+            scheduleVisitor(LANE_CLOSED, SIM_ENTER, slot);
+        }
+        return;
+    }
+
+    if (tryEnter(choosePool(visitor), slot)) {
+        return;
+    }
+
+    if (++visitor.retries < MAX_ENTER_RETRIES) {
+        scheduleVisitor(LANE_RETRY, SIM_ENTER, slot);
+    } else {
+        counters.gaveUp++;
+        depart(slot);
+    }
+}
+
+void PoolSimulation::onLifeguard(int pool) {
+    SimPool &target = pools[pool];
+
+    if (!hoursOpen) {
+        target.closedForHours = true;
+        target.waitingForOpening = true;
+        refreshClosed(target);
+        return;
+    }
+    if (maintenance) {
+        schedule(maintenanceEnd + 1, SIM_LIFEGUARD, pool);
+        return;
+    }
+
+    target.closedForHours = false;
+    refreshClosed(target);
+    if (!target.warmedUp) {
+        target.warmedUp = true;
+        schedule(now + LIFEGUARD_WARMUP_S, SIM_LIFEGUARD, pool);
+        return;
+    }
+
+    double closedFor = 0;
+    if (static_cast<int>(rng() % 100) < EVACUATION_PERCENT) {
+        closedFor += EVACUATION_CLOSED_S;
+        counters.evacuations[pool]++;
+    }
+    if (static_cast<int>(rng() % 100) < EMERGENCY_PERCENT) {
+        closedFor += EMERGENCY_CLOSED_S;
+        counters.evacuations[pool]++;
+    }
+
+    if (closedFor > 0) {
+        target.closedByLifeguard = true;
+        refreshClosed(target);
+        evacuate(pool, false);
+        schedule(now + closedFor, SIM_POOL_REOPEN, pool);
+    }
+    schedule(now + closedFor + LIFEGUARD_INTERVAL_S, SIM_LIFEGUARD, pool);
+}
+
+void PoolSimulation::onMaintenanceStart() {
+    maintenance = true;
+    maintenanceEnd = now + MAINTENANCE_DURATION_S;
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        refreshClosed(pools[pool]);
+        evacuate(pool, true);
+    }
+    schedule(maintenanceEnd, SIM_MAINTENANCE_END);
+}
+
+void PoolSimulation::onMaintenanceEnd() {
+    maintenance = false;
+    for (auto &pool: pools) {
+        refreshClosed(pool);
+    }
+    schedule(now + MAINTENANCE_GAP_S, SIM_MAINTENANCE_START);
+}
+
+void PoolSimulation::run() {
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        pools[pool].lastChange = now;
+        schedule(now, SIM_LIFEGUARD, pool);
+    }
+    schedule(now, SIM_CASHIER);
+    schedule(now + FIRST_MAINTENANCE_S, SIM_MAINTENANCE_START);
+    schedule(options.closeHour * 3600.0, SIM_CLOSING);
+    if (arrivalModel->next(0, rng, pendingArrival)) {
+        schedule(startTime + pendingArrival.time, SIM_ARRIVAL);
+    }
+
+    auto wallStart = std::chrono::steady_clock::now();
+    SimEvent event{};
+    while (events.pop(event, endTime)) {
+        now = event.time;
+        processed++;
+
+        switch (event.type) {
+            case SIM_ARRIVAL:
+                onArrival();
+                break;
+            case SIM_CASHIER:
+                onCashier();
+                break;
+            case SIM_ENTER:
+                if (visitors[event.subject].generation == event.generation) {
+                    onEnter(event.subject);
+                }
+                break;
+            case SIM_EXPIRY:
+                if (visitors[event.subject].generation == event.generation) {
+                    counters.expired++;
+                    depart(event.subject);
+                }
+                break;
+            case SIM_LIFEGUARD:
+                onLifeguard(static_cast<int>(event.subject));
+                break;
+            case SIM_POOL_REOPEN:
+                pools[event.subject].closedByLifeguard = false;
+                refreshClosed(pools[event.subject]);
+                break;
+            case SIM_MAINTENANCE_START:
+                onMaintenanceStart();
+                break;
+            case SIM_MAINTENANCE_END:
+                onMaintenanceEnd();
+                break;
+            case SIM_OPENING:
+                hoursOpen = true;
+                schedule(now + (options.closeHour - options.openHour) * 3600.0, SIM_CLOSING);
+                for (int pool = 0; pool < POOL_COUNT; pool++) {
+                    if (pools[pool].waitingForOpening) {
+                        pools[pool].waitingForOpening = false;
+                        schedule(now, SIM_LIFEGUARD, pool);
+                    }
+                }
+                break;
+            case SIM_CLOSING:
+                hoursOpen = false;
+                schedule(nextOpening(now), SIM_OPENING);
+                break;
+        }
+    }
+    runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    now = endTime;
+    for (auto &pool: pools) {
+        pool.occupancyArea += pool.occupancy.count * (now - pool.lastChange);
+        pool.lastChange = now;
+    }
+}
+
+void PoolSimulation::printSummary(std::ostream &out) const {
+    double simulated = endTime - startTime;
+    out << std::fixed << std::setprecision(2);
+    out << "Simulated " << options.days << " days in " << runSeconds << " s: " << processed << " events, "
+        << processed / std::max(runSeconds, 1e-9) / 1e6 << " M events/s\n";
+    out << "Arrival model: " << arrivalModel->describe() << "\n";
+    out << "Visitors: " << counters.arrivals << " arrived, " << counters.arrivalsWhileClosed
+        << " while closed, " << counters.ticketsRefused << " refused by a full queue, " << counters.gaveUp
+        << " gave up after " << MAX_ENTER_RETRIES << " refusals, " << counters.leftForMaintenance
+        << " left for maintenance, " << counters.expired << " stayed until the ticket expired\n";
+    out << "Tickets: " << counters.ticketsIssued << " issued ("
+        << counters.ticketsIssued / (simulated / 3600.0) << "/h), mean queue wait "
+        << counters.queueWaitSum / std::max<uint64_t>(1, counters.ticketsIssued) << " s\n";
+    out << "Entrance queue: " << queueSettings.describe() << "\n";
+    for (int queueClass = 0; queueClass < QUEUE_CLASS_COUNT; queueClass++) {
+        uint64_t served = counters.queueServed[queueClass];
+        out << "  " << std::left << std::setw(8) << QueueSettings::className(queueClass) << std::right << served
+            << " served, mean wait " << counters.queueClassWaitSum[queueClass] / std::max<uint64_t>(1, served)
+            << " s, max " << counters.queueWaitMax[queueClass] << " s, " << counters.queueSloMissed[queueClass]
+            << " over the SLO (" << 100.0 * counters.queueSloMissed[queueClass] / std::max<uint64_t>(1, served)
+            << "%)\n";
+    }
+
+    out << std::left << std::setw(14) << "pool" << std::right << std::setw(12) << "admissions"
+        << std::setw(10) << "diaper" << std::setw(10) << "closed" << std::setw(10) << "full"
+        << std::setw(10) << "no_child" << std::setw(10) << "avg_age" << std::setw(10) << "age_limit"
+        << std::setw(10) << "no_guard" << std::setw(13) << "evacuations"
+        << std::setw(15) << "mean occupancy" << "\n";
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        out << std::left << std::setw(14) << POOL_NAMES[pool] << std::right << std::setw(12)
+            << counters.admissions[pool];
+        for (int reason = 0; reason < REFUSAL_REASON_COUNT; reason++) {
+            out << std::setw(10) << counters.refusals[pool][reason];
+        }
+        out << std::setw(13) << counters.evacuations[pool] << std::setw(15)
+            << pools[pool].occupancyArea / simulated << "\n";
+    }
+}
+
+std::string PoolSimulation::renderMetrics() const {
+    MetricsRegistry registry{};
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        registry.admissions[pool].store(counters.admissions[pool]);
+        registry.evacuations[pool].store(counters.evacuations[pool]);
+        for (int reason = 0; reason < REFUSAL_REASON_COUNT; reason++) {
+            registry.refusals[pool][reason].store(counters.refusals[pool][reason]);
+        }
+    }
+    registry.ticketsIssued.store(counters.ticketsIssued);
+    registry.ticketsRefused.store(counters.ticketsRefused);
+    registry.queueDepth.store(entranceQueue.queueSize);
+    for (int queueClass = 0; queueClass < QUEUE_CLASS_COUNT; queueClass++) {
+        registry.queueServed[queueClass].store(counters.queueServed[queueClass]);
+        registry.queueWaitS[queueClass].store(static_cast<uint64_t>(counters.queueClassWaitSum[queueClass]));
+        registry.queueSloMissed[queueClass].store(counters.queueSloMissed[queueClass]);
+    }
+    return Metrics::renderPrometheus(registry);
+}
+
+namespace {
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --days n               simulated opening days (1)\n"
+                  << "  --arrival model        visitor arrival process, as for swimming_pool (periodic:rate=1)\n"
+                  << "  --mix shares           visitor demographics, as for swimming_pool\n"
+                  << "  --seed n               random seed (1)\n"
+                  << "  --hours open-close     working hours (8-24)\n"
+                  << "  --queue-policy policy  entrance queue order, as for swimming_pool (strict)\n"
+                  << "  --queue-slo waits      queue wait SLO per class, as for swimming_pool (regular=120,vip=30)\n"
+                  << "  --metrics-file path    write the counters in the monitor's Prometheus format\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    SimOptions options;
+    std::string metricsFile;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string option = argv[i];
+            if (i + 1 >= argc) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[++i];
+
+            if (option == "--days") {
+                options.days = std::stoi(value);
+            } else if (option == "--arrival") {
+                options.arrivalModel = value;
+            } else if (option == "--mix") {
+                options.demographicMix = value;
+            } else if (option == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (option == "--hours") {
+                if (sscanf(value.c_str(), "%d-%d", &options.openHour, &options.closeHour) != 2) {
+                    throw PoolError("Invalid working hours: " + value);
+                }
+            } else if (option == "--queue-policy") {
+                options.queuePolicy = value;
+            } else if (option == "--queue-slo") {
+                options.queueSlo = value;
+            } else if (option == "--metrics-file") {
+                metricsFile = value;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+
+        PoolSimulation simulation(options);
+        simulation.run();
+        simulation.printSummary(std::cout);
+
+        if (!metricsFile.empty()) {
+            std::ofstream out(metricsFile);
+            if (!out) {
+                throw PoolError("Cannot write " + metricsFile);
+            }
+            out << simulation.renderMetrics();
+        }
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,218 @@
+#ifndef SWIMMING_POOL_POOL_SIM_H
+#define SWIMMING_POOL_POOL_SIM_H
+
+#include "admission.h"
+#include "load_generator.h"
+#include "queue_policy.h"
+#include "shared_memory.h"
+#include <deque>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+struct SimOptions {
+    int days = 1;
+    std::string arrivalModel = "periodic:rate=1";
+    std::string demographicMix;
+    uint64_t seed = 1;
+    int openHour = 8;
+    int closeHour = 24;
+    std::string queuePolicy = "strict";
+    std::string queueSlo;
+};
+
+enum SimEventType : uint16_t {
+    SIM_ARRIVAL,
+    SIM_CASHIER,
+    SIM_ENTER,
+    SIM_EXPIRY,
+    SIM_LIFEGUARD,
+    SIM_POOL_REOPEN,
+    SIM_MAINTENANCE_START,
+    SIM_MAINTENANCE_END,
+    SIM_OPENING,
+    SIM_CLOSING
+};
+
+// Visitor timers always fire a fixed delay after the current time, so each delay gets its own FIFO
+// lane that stays sorted by itself; the heap only holds the handful of facility timers
+enum SimLane {
+    LANE_NOW,
+    LANE_EVACUATED,
+    LANE_RETRY,
+    LANE_CLOSED,
+    LANE_EXPIRY,
+    LANE_COUNT
+};
+
+struct SimEvent {
+    double time;            // seconds since midnight of the first simulated day
+    uint32_t subject;       // visitor slot or pool index
+    uint16_t type;
+    uint16_t generation;    // events of a visitor slot that has been reused are dropped
+};
+
+class SimEventQueue {
+private:
+    struct Later {
+        bool operator()(const SimEvent &a, const SimEvent &b) const { return a.time > b.time; }
+    };
+
+    std::priority_queue<SimEvent, std::vector<SimEvent>, Later> heap;
+    std::deque<SimEvent> lanes[LANE_COUNT];
+
+public:
+    void push(const SimEvent &event) { heap.push(event); }
+
+    // The caller guarantees that events of one lane are pushed in time order
+    void push(SimLane lane, const SimEvent &event) { lanes[lane].push_back(event); }
+
+    bool pop(SimEvent &event, double until) {
+        int source = -1;
+        double earliest = heap.empty() ? std::numeric_limits<double>::infinity() : heap.top().time;
+        for (int lane = 0; lane < LANE_COUNT; lane++) {
+            if (!lanes[lane].empty() && lanes[lane].front().time < earliest) {
+                earliest = lanes[lane].front().time;
+                source = lane;
+            }
+        }
+        if (earliest >= until) {
+            return false;
+        }
+
+        if (source < 0) {
+            event = heap.top();
+            heap.pop();
+        } else {
+            event = lanes[source].front();
+            lanes[source].pop_front();
+        }
+        return true;
+    }
+};
+
+struct SimCounters {
+    uint64_t admissions[POOL_COUNT];
+    uint64_t refusals[POOL_COUNT][REFUSAL_REASON_COUNT];
+    uint64_t evacuations[POOL_COUNT];
+    uint64_t ticketsIssued;
+    uint64_t ticketsRefused;
+    uint64_t arrivals;
+    uint64_t arrivalsWhileClosed;
+    uint64_t gaveUp;
+    uint64_t leftForMaintenance;
+    uint64_t expired;
+    double queueWaitSum;
+    uint64_t queueServed[QUEUE_CLASS_COUNT];
+    double queueClassWaitSum[QUEUE_CLASS_COUNT];
+    double queueWaitMax[QUEUE_CLASS_COUNT];
+    uint64_t queueSloMissed[QUEUE_CLASS_COUNT];
+};
+
+// The whole facility as a single-threaded discrete-event simulation. Visitors, the cashier, the
+// lifeguards and the maintenance cycle are events on one priority queue, timed like the sleeps
+// of the live processes. Admission goes through ADMISSION_POLICIES and the entrance queue through
+// EntranceQueue::insert, the same code the live pools and cashier run, so the counters can be
+// compared with the live metrics.
+class PoolSimulation {
+private:
+    struct Visitor {
+        int age;
+        int childAge;           // 0 without a child
+        bool childHasSwimDiaper;
+        bool isVip;
+        int8_t pool;            // -1 outside the pools
+        uint8_t retries;
+        uint16_t generation;
+        uint32_t memberIndex;
+        double arrivalTime;
+    };
+
+    struct SimPool {
+        PoolOccupancy occupancy;
+        bool closedByLifeguard;
+        bool closedForHours;
+        bool warmedUp;
+        bool waitingForOpening;
+        double lastChange;
+        double occupancyArea;   // integral of the head count over time
+        std::vector<uint32_t> members;
+    };
+
+    SimOptions options;
+    std::mt19937_64 rng;
+    std::unique_ptr<ArrivalModel> arrivalModel;
+    DemographicMix mix;
+    Arrival pendingArrival;
+    double startTime;
+    double endTime;
+    double now;
+
+    SimEventQueue events;
+    std::vector<Visitor> visitors;
+    std::vector<uint32_t> freeSlots;
+    QueueSettings queueSettings;
+    EntranceQueue entranceQueue;
+    SimPool pools[POOL_COUNT];
+    bool maintenance;
+    double maintenanceEnd;
+    bool hoursOpen;
+
+    SimCounters counters;
+    uint64_t processed;
+    double runSeconds;
+
+    void schedule(double time, SimEventType type, uint32_t subject = 0) {
+        events.push(SimEvent{time, subject, static_cast<uint16_t>(type), 0});
+    }
+
+    void scheduleVisitor(SimLane lane, SimEventType type, uint32_t slot);
+
+    double nextOpening(double time) const;
+
+    bool isOpen() const { return hoursOpen && !maintenance; }
+
+    void refreshClosed(SimPool &pool);
+
+    void addPerson(SimPool &pool, int age);
+
+    void removePerson(SimPool &pool, int age);
+
+    int choosePool(const Visitor &visitor);
+
+    bool tryEnter(int pool, uint32_t slot);
+
+    void leavePool(uint32_t slot);
+
+    void depart(uint32_t slot);
+
+    void evacuate(int pool, bool leaveFacility);
+
+    void onArrival();
+
+    void onCashier();
+
+    void onEnter(uint32_t slot);
+
+    void onLifeguard(int pool);
+
+    void onMaintenanceStart();
+
+    void onMaintenanceEnd();
+
+public:
+    explicit PoolSimulation(const SimOptions &options);
+
+    void run();
+
+    void printSummary(std::ostream &out) const;
+
+    // Same exposition as the live monitor, so both runs can be diffed
+    std::string renderMetrics() const;
+};
+
+#endif
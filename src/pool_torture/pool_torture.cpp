@@ -0,0 +1,532 @@
+#include "pool_torture.h"
+#include "error_handler.h"
+#include "lifeguard.h"
+#include "lock_stats.h"
+#include "metrics.h"
+#include "pool_manager.h"
+#include "private_facility.h"
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/sem.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    const char *const OP_NAMES[TORTURE_OP_COUNT] = {"enter", "leave", "transfer", "evacuate", "maintenance"};
+    const char *const POOL_NAMES[POOL_COUNT] = {"olympic", "recreational", "children"};
+
+    // Per 1000 steps; whatever is not enter, transfer, evacuation or maintenance is a leave
+    const int ENTER_PER_MILLE = 490;
+    const int TRANSFER_PER_MILLE = 150;
+    const int EVACUATE_PER_MILLE = 15;
+    const int MAINTENANCE_PER_MILLE = 5;
+
+    // Visitor ids: a block per worker, the child of a party right after its guardian
+    const int IDS_PER_WORKER = 1000;
+
+    TortureControl *activeControl = nullptr;
+
+    void handleStop(int) {
+        if (activeControl) {
+            activeControl->stop.store(1);
+        }
+    }
+
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --workers n            worker processes (32, at most " << TortureControl::MAX_WORKERS
+                  << ")\n"
+                  << "  --duration s           real seconds to run (10)\n"
+                  << "  --seed n               random seed (1)\n"
+                  << "  --parties n            visitors, alone or with a child, per worker (4)\n"
+                  << "  --close-ms ms          longest an evacuation or maintenance closes a pool (5)\n"
+                  << "Runs on private IPC keys; exits with 1 on the first invariant violation.\n";
+    }
+}
+
+bool TortureControl::fail(int worker, uint64_t step, const std::string &message) {
+    stop.store(1);
+    if (violations.fetch_add(1) != 0) {
+        return false;
+    }
+    violationWorker = worker;
+    violationStep = step;
+    strncpy(violationMessage, message.c_str(), MESSAGE_SIZE - 1);
+    return true;
+}
+
+uint64_t TortureWorker::seedOf(uint64_t seed, int worker) {
+    return seed * 0x9E3779B97F4A7C15ull + static_cast<uint64_t>(worker);
+}
+
+TortureWorker::TortureWorker(int index, const TortureOptions &options, TortureControl &control)
+        : index(index), options(options), control(control), rng(seedOf(options.seed, index)), step(0) {
+    PoolManager *manager = PoolManager::getInstance();
+    pools[POOL_OLYMPIC] = manager->getPool(Pool::PoolType::Olympic);
+    pools[POOL_RECREATIONAL] = manager->getPool(Pool::PoolType::Recreational);
+    pools[POOL_CHILDREN] = manager->getPool(Pool::PoolType::Children);
+
+    semId = semget(IpcKeys::key(SEM_KEY), SEM_COUNT, 0666);
+    checkSystemCall(semId, "semget failed in pool_torture");
+    makeParties();
+}
+
+void TortureWorker::makeParties() {
+    // Adults on their own, teenagers, and guardians with a child for the children's or the recreational pool
+    int firstId = 1 + index * IDS_PER_WORKER;
+    for (int i = 0; i < options.parties; i++) {
+        int id = firstId + 2 * i;
+        Party party;
+        switch (rng() % 4) {
+            case 0:
+                party.visitor = std::make_unique<Client>(id, 18 + static_cast<int>(rng() % 53), false);
+                break;
+            case 1:
+                party.visitor = std::make_unique<Client>(id, 10 + static_cast<int>(rng() % 8), false);
+                break;
+            default: {
+                int childAge = 1 + static_cast<int>(rng() % 9);
+                party.visitor = std::make_unique<Client>(id, 20 + static_cast<int>(rng() % 51), false);
+                party.visitor->setAsGuardian(true);
+                party.child = std::make_unique<Client>(id + 1, childAge, false, childAge <= 3, true, id);
+                party.visitor->addDependent(party.child.get());
+                break;
+            }
+        }
+        parties.push_back(std::move(party));
+    }
+}
+
+TortureWorker::Party *TortureWorker::pickParty(bool inPool) {
+    std::vector<Party *> candidates;
+    for (auto &party: parties) {
+        if ((party.pool != nullptr) == inPool) {
+            candidates.push_back(&party);
+        }
+    }
+    return candidates.empty() ? nullptr : candidates[rng() % candidates.size()];
+}
+
+void TortureWorker::enter(Party &party) {
+    // The pool a visitor of this kind would head for, as Client::moveToAnotherPool chooses it
+    Client &visitor = *party.visitor;
+    int pool;
+    if (party.child) {
+        pool = party.child->getAge() <= 5 ? POOL_CHILDREN : POOL_RECREATIONAL;
+    } else if (visitor.getAge() < 18 || rng() % 4 == 0) {
+        pool = POOL_RECREATIONAL;
+    } else {
+        pool = POOL_OLYMPIC;
+    }
+
+    uint64_t finishedBefore = control.leavesFinished[pool].load();
+    uint64_t startedBefore = control.leavesStarted[pool].load();
+
+    bool admitted = party.child ? pools[pool]->enterWithDependent(visitor, *party.child) : pools[pool]->enter(visitor);
+    control.counts[index].ops[TORTURE_ENTER].fetch_add(1, std::memory_order_relaxed);
+    if (!admitted) {
+        control.counts[index].refused.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    party.pool = pools[pool];
+    control.counts[index].admitted.fetch_add(1, std::memory_order_relaxed);
+    checkAdmittedAverage(pool, visitor.getId(), startedBefore, finishedBefore);
+}
+
+void TortureWorker::checkAdmittedAverage(int pool, int visitorId, uint64_t startedBefore, uint64_t finishedBefore) {
+    // Leaving can raise the average age legitimately; only an admission may not, so the limit is
+    // checked when nobody left the pool between the admission and the snapshot
+    if (POOL_RULES[pool].maxAverageAge < 100) {
+        PoolState state{};
+        snapshot(pool, state);
+        if (finishedBefore == startedBefore && control.leavesStarted[pool].load() == startedBefore &&
+            state.currentCount > 0) {
+            double sum = 0;
+            for (int i = 0; i < state.currentCount; i++) {
+                sum += state.ages[i];
+            }
+            double average = sum / state.currentCount;
+            if (average > POOL_RULES[pool].maxAverageAge) {
+                control.fail(index, step, std::string(POOL_NAMES[pool]) + ": average age " +
+                                          std::to_string(average) + " after admitting visitor " +
+                                          std::to_string(visitorId));
+            }
+        }
+    }
+}
+
+void TortureWorker::transfer(Party &party) {
+    // Between the two pools the party may use, as Client::maybeHop chooses
+    int from = static_cast<int>(party.pool->getType());
+    int to;
+    if (party.child && party.child->getAge() <= 5) {
+        to = from == POOL_CHILDREN ? POOL_RECREATIONAL : POOL_CHILDREN;
+    } else if (!party.child && party.visitor->getAge() >= 18) {
+        to = from == POOL_OLYMPIC ? POOL_RECREATIONAL : POOL_OLYMPIC;
+    } else {
+        return;
+    }
+
+    uint64_t finishedBefore = control.leavesFinished[to].load();
+    uint64_t startedBefore = control.leavesStarted[to].load();
+    control.leavesStarted[from].fetch_add(1);
+    bool moved = party.visitor->transferTo(static_cast<Pool::PoolType>(to));
+    control.leavesFinished[from].fetch_add(1);
+
+    control.counts[index].ops[TORTURE_TRANSFER].fetch_add(1, std::memory_order_relaxed);
+    if (!moved) {
+        control.counts[index].refused.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    party.pool = pools[to];
+    control.counts[index].admitted.fetch_add(1, std::memory_order_relaxed);
+    checkAdmittedAverage(to, party.visitor->getId(), startedBefore, finishedBefore);
+}
+
+void TortureWorker::leave(Party &party) {
+    int pool = static_cast<int>(party.pool->getType());
+    control.leavesStarted[pool].fetch_add(1);
+    // The guardian's leave() takes the child out with them
+    party.pool->leave(party.visitor->getId());
+    control.leavesFinished[pool].fetch_add(1);
+
+    party.visitor->disconnectFromPool();
+    party.visitor->setCurrentPool(nullptr);
+    if (party.child) {
+        party.child->disconnectFromPool();
+        party.child->setCurrentPool(nullptr);
+    }
+    party.pool = nullptr;
+    control.counts[index].ops[TORTURE_LEAVE].fetch_add(1, std::memory_order_relaxed);
+}
+
+void TortureWorker::leaveClosedPools() {
+    for (auto &party: parties) {
+        if (party.pool && party.pool->getState()->isClosed) {
+            leave(party);
+        }
+    }
+}
+
+void TortureWorker::closePool(int pool, bool maintenance) {
+    int expected = 0;
+    if (!control.closedBy[pool].compare_exchange_strong(expected, index + 1)) {
+        return;
+    }
+
+    // As the lifeguard and the maintenance manager do it; the visitors notice at their next step
+    if (maintenance) {
+        pools[pool]->closeForMaintenance();
+    } else {
+        pools[pool]->getState()->isClosed = true;
+    }
+    leaveClosedPools();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.closeMs);
+    while (pools[pool]->getState()->currentCount > 0 && std::chrono::steady_clock::now() < deadline &&
+           !control.stop.load()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    if (maintenance) {
+        pools[pool]->reopenAfterMaintenance();
+    } else {
+        pools[pool]->getState()->isClosed = false;
+    }
+    control.closedBy[pool].store(0);
+    control.counts[index].ops[maintenance ? TORTURE_MAINTENANCE : TORTURE_EVACUATE].fetch_add(
+            1, std::memory_order_relaxed);
+}
+
+void TortureWorker::snapshot(int pool, PoolState &state) {
+    auto semaphore = static_cast<unsigned short>(pools[pool]->getPoolSemaphore());
+    checkSystemCall(LockStats::acquire(semId, semaphore, SEM_UNDO), "semop lock failed in pool_torture");
+    memcpy(&state, pools[pool]->getState(), sizeof(PoolState));
+    checkSystemCall(LockStats::release(semId, semaphore, SEM_UNDO), "semop unlock failed in pool_torture");
+}
+
+bool TortureWorker::checkPool(int pool, const PoolState &state) {
+    std::string name = POOL_NAMES[pool];
+    int count = state.currentCount;
+    if (count < 0 || count > POOL_RULES[pool].capacity) {
+        control.fail(index, step, name + ": currentCount " + std::to_string(count) + " outside 0.." +
+                                  std::to_string(POOL_RULES[pool].capacity));
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        bool guardianPresent = state.guardianIds[i] < 0;
+        bool childPresent = false;
+        for (int j = 0; j < count; j++) {
+            if (j != i && state.ids[j] == state.ids[i]) {
+                control.fail(index, step, name + ": visitor " + std::to_string(state.ids[i]) + " is in the pool twice");
+                return false;
+            }
+            guardianPresent |= state.ids[j] == state.guardianIds[i];
+            childPresent |= state.guardianIds[j] == state.ids[i];
+        }
+
+        if (!guardianPresent) {
+            control.fail(index, step, name + ": child " + std::to_string(state.ids[i]) + " without guardian " +
+                                      std::to_string(state.guardianIds[i]));
+            return false;
+        }
+        if (pool == POOL_CHILDREN && state.ages[i] > POOL_RULES[pool].maxAge && !childPresent) {
+            control.fail(index, step, name + ": adult " + std::to_string(state.ids[i]) + " (age " +
+                                      std::to_string(state.ages[i]) + ") without a child");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TortureWorker::check() {
+    PoolState states[POOL_COUNT];
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        snapshot(pool, states[pool]);
+        if (!checkPool(pool, states[pool])) {
+            return false;
+        }
+    }
+
+    // This worker's own visitors change only in this process, so where they are is known exactly
+    for (auto &party: parties) {
+        Client *members[] = {party.visitor.get(), party.child.get()};
+        for (Client *member: members) {
+            if (!member) {
+                continue;
+            }
+            for (int pool = 0; pool < POOL_COUNT; pool++) {
+                int found = 0;
+                for (int i = 0; i < states[pool].currentCount; i++) {
+                    found += states[pool].ids[i] == member->getId();
+                }
+                int expected = party.pool == pools[pool] ? 1 : 0;
+                if (found != expected) {
+                    control.fail(index, step, "visitor " + std::to_string(member->getId()) + " found " +
+                                              std::to_string(found) + " times in " + POOL_NAMES[pool] +
+                                              ", expected " + std::to_string(expected));
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void TortureWorker::run() {
+    while (!control.go.load() && !control.stop.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    try {
+        while (!control.stop.load()) {
+            step++;
+            leaveClosedPools();
+
+            int roll = static_cast<int>(rng() % 1000);
+            if (roll < EVACUATE_PER_MILLE + MAINTENANCE_PER_MILLE) {
+                closePool(static_cast<int>(rng() % POOL_COUNT), roll < MAINTENANCE_PER_MILLE);
+            } else {
+                roll -= EVACUATE_PER_MILLE + MAINTENANCE_PER_MILLE;
+                bool entering = roll < ENTER_PER_MILLE;
+                Party *party = pickParty(!entering);
+                if (!party) {
+                    party = pickParty(entering);
+                    entering = !entering;
+                }
+                if (entering) {
+                    enter(*party);
+                } else if (roll < ENTER_PER_MILLE + TRANSFER_PER_MILLE) {
+                    transfer(*party);
+                } else {
+                    leave(*party);
+                }
+            }
+
+            if (!check()) {
+                break;
+            }
+        }
+
+        for (auto &party: parties) {
+            if (party.pool) {
+                leave(party);
+            }
+        }
+    } catch (const std::exception &e) {
+        control.fail(index, step, std::string("exception: ") + e.what());
+    }
+}
+
+Torture::Torture(const TortureOptions &options) : options(options) {}
+
+void Torture::report(const TortureControl &control, double elapsedS) const {
+    uint64_t ops[TORTURE_OP_COUNT] = {};
+    uint64_t admitted = 0;
+    uint64_t refused = 0;
+    for (int worker = 0; worker < options.workers; worker++) {
+        for (int op = 0; op < TORTURE_OP_COUNT; op++) {
+            ops[op] += control.counts[worker].ops[op].load();
+        }
+        admitted += control.counts[worker].admitted.load();
+        refused += control.counts[worker].refused.load();
+    }
+
+    uint64_t total = 0;
+    for (uint64_t count: ops) {
+        total += count;
+    }
+    printf("%d workers, %.1f s, seed %llu\n", options.workers, elapsedS,
+           static_cast<unsigned long long>(options.seed));
+    printf("  %-12s %12s %12s\n", "operation", "count", "per_second");
+    for (int op = 0; op < TORTURE_OP_COUNT; op++) {
+        printf("  %-12s %12llu %12.0f\n", OP_NAMES[op], static_cast<unsigned long long>(ops[op]),
+               elapsedS > 0 ? ops[op] / elapsedS : 0);
+    }
+    printf("  %-12s %12llu %12.0f\n", "total", static_cast<unsigned long long>(total),
+           elapsedS > 0 ? total / elapsedS : 0);
+    printf("  admitted %llu, refused %llu\n", static_cast<unsigned long long>(admitted),
+           static_cast<unsigned long long>(refused));
+    fflush(stdout);
+}
+
+int Torture::run() {
+    IpcKeys::usePrivate();
+    PrivateFacility facility;
+
+    void *mapping = mmap(nullptr, sizeof(TortureControl), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw PoolSystemError("mmap failed in pool_torture");
+    }
+    auto *control = new(mapping) TortureControl();
+    activeControl = control;
+    signal(SIGINT, handleStop);
+    signal(SIGTERM, handleStop);
+
+    // Workers are forked before the lifeguards start their threads and wait for go
+    std::vector<pid_t> workers;
+    for (int i = 0; i < options.workers; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            LockStats::setRole(ProcessRole::Client);
+            try {
+                TortureWorker worker(i, options, *control);
+                worker.run();
+            } catch (const std::exception &e) {
+                control->fail(i, 0, std::string("exception: ") + e.what());
+            }
+            _exit(0);
+        }
+        if (pid < 0) {
+            control->stop.store(1);
+            break;
+        }
+        workers.push_back(pid);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double elapsedS;
+    {
+        // Socket servers for connectToPool(); closed connections are pruned as visitors leave
+        PoolManager *manager = PoolManager::getInstance();
+        Lifeguard olympic(manager->getPool(Pool::PoolType::Olympic));
+        Lifeguard recreational(manager->getPool(Pool::PoolType::Recreational));
+        Lifeguard children(manager->getPool(Pool::PoolType::Children));
+        Lifeguard *lifeguards[] = {&olympic, &recreational, &children};
+
+        start = std::chrono::steady_clock::now();
+        control->go.store(1);
+        while (!control->stop.load() && elapsed() < options.durationS) {
+            for (Lifeguard *lifeguard: lifeguards) {
+                lifeguard->removeInactiveClients();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        control->stop.store(1);
+
+        for (pid_t pid: workers) {
+            while (waitpid(pid, nullptr, 0) == -1 && errno == EINTR) {
+            }
+        }
+        elapsedS = elapsed();
+    }
+
+    // Every worker took its visitors out, so anything left is drift
+    const PoolState *states[POOL_COUNT] = {&facility.shm->olympic, &facility.shm->recreational, &facility.shm->kids};
+    for (int pool = 0; pool < POOL_COUNT; pool++) {
+        if (states[pool]->currentCount != 0 && control->violations.load() == 0) {
+            control->fail(-1, 0, std::string(POOL_NAMES[pool]) + ": currentCount " +
+                                 std::to_string(states[pool]->currentCount) + " after every visitor left");
+        }
+    }
+
+    report(*control, elapsedS);
+    int status = 0;
+    if (control->violations.load() > 0) {
+        std::cout << "VIOLATION (" << control->violations.load() << " in total), first: "
+                  << control->violationMessage << "\n";
+        if (control->violationWorker >= 0) {
+            std::cout << "  worker " << control->violationWorker << " at step " << control->violationStep
+                      << ", worker seed " << TortureWorker::seedOf(options.seed, control->violationWorker)
+                      << "; pool_torture --seed " << options.seed << " --workers " << options.workers
+                      << " replays the same operation streams" << std::endl;
+        }
+        status = 1;
+    } else {
+        std::cout << "No invariant violations" << std::endl;
+    }
+
+    activeControl = nullptr;
+    control->~TortureControl();
+    munmap(mapping, sizeof(TortureControl));
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    TortureOptions options;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string option = argv[i];
+            if (i + 1 >= argc) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[++i];
+
+            if (option == "--workers") {
+                options.workers = std::stoi(value);
+            } else if (option == "--duration") {
+                options.durationS = std::stod(value);
+            } else if (option == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (option == "--parties") {
+                options.parties = std::stoi(value);
+            } else if (option == "--close-ms") {
+                options.closeMs = std::stoi(value);
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        if (options.workers < 1 || options.workers > TortureControl::MAX_WORKERS || options.durationS <= 0 ||
+            options.parties < 1 || options.parties > 400 || options.closeMs < 0) {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        Torture torture(options);
+        return torture.run();
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
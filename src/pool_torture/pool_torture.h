@@ -0,0 +1,122 @@
+#ifndef SWIMMING_POOL_POOL_TORTURE_H
+#define SWIMMING_POOL_POOL_TORTURE_H
+
+#include "client.h"
+#include "shared_memory.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+struct TortureOptions {
+    int workers = 32;
+    double durationS = 10;
+    uint64_t seed = 1;
+    int parties = 4;            // visitors (alone or with a child) per worker
+    int closeMs = 5;            // longest an evacuation or maintenance keeps its pool closed
+};
+
+enum TortureOp {
+    TORTURE_ENTER,
+    TORTURE_LEAVE,
+    TORTURE_TRANSFER,
+    TORTURE_EVACUATE,
+    TORTURE_MAINTENANCE,
+    TORTURE_OP_COUNT
+};
+
+// Shared by the torture process and its workers through an anonymous mapping made before the fork
+struct TortureControl {
+    static constexpr int MAX_WORKERS = 256;
+    static constexpr int MESSAGE_SIZE = 256;
+
+    std::atomic<int> go;
+    std::atomic<int> stop;
+    std::atomic<int> closedBy[POOL_COUNT];              // worker + 1 while it evacuates or services the pool
+    std::atomic<uint64_t> leavesStarted[POOL_COUNT];
+    std::atomic<uint64_t> leavesFinished[POOL_COUNT];
+
+    // The first violation; later ones are only counted
+    std::atomic<int> violations;
+    int violationWorker;
+    uint64_t violationStep;
+    char violationMessage[MESSAGE_SIZE];
+
+    struct WorkerCounts {
+        std::atomic<uint64_t> ops[TORTURE_OP_COUNT];
+        std::atomic<uint64_t> admitted;
+        std::atomic<uint64_t> refused;
+    } counts[MAX_WORKERS];
+
+    // Returns false when another violation was first
+    bool fail(int worker, uint64_t step, const std::string &message);
+};
+
+// One forked worker: owns a few visitor parties and moves them in and out of the pools, closes pools
+// for evacuation or maintenance now and then, and checks the pool invariants after every step
+class TortureWorker {
+private:
+    struct Party {
+        std::unique_ptr<Client> visitor;
+        std::unique_ptr<Client> child;
+        Pool *pool = nullptr;
+    };
+
+    int index;
+    const TortureOptions &options;
+    TortureControl &control;
+    std::mt19937_64 rng;
+    std::vector<Party> parties;
+    Pool *pools[POOL_COUNT];
+    int semId;
+    uint64_t step;
+
+    void makeParties();
+
+    Party *pickParty(bool inPool);
+
+    void enter(Party &party);
+
+    void leave(Party &party);
+
+    void transfer(Party &party);
+
+    // Average age limit of the pool right after this worker admitted visitorId to it
+    void checkAdmittedAverage(int pool, int visitorId, uint64_t startedBefore, uint64_t finishedBefore);
+
+    void closePool(int pool, bool maintenance);
+
+    void leaveClosedPools();
+
+    // Copy of a pool's state taken under its semaphore
+    void snapshot(int pool, PoolState &state);
+
+    bool checkPool(int pool, const PoolState &state);
+
+    bool check();
+
+public:
+    static uint64_t seedOf(uint64_t seed, int worker);
+
+    TortureWorker(int index, const TortureOptions &options, TortureControl &control);
+
+    void run();
+};
+
+// Forks the workers on a private facility, keeps the lifeguards' sockets for them, and reports the
+// operation rates and the first invariant violation
+class Torture {
+private:
+    TortureOptions options;
+
+    void report(const TortureControl &control, double elapsedS) const;
+
+public:
+    explicit Torture(const TortureOptions &options);
+
+    int run();
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "process_reaper.h"
+#include "error_handler.h"
+#include <sys/wait.h>
+#include <cerrno>
+#include <unistd.h>
+#include <algorithm>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/signalfd.h>
+#endif
+
+ProcessReaper::ProcessReaper(ProcessRegistry &registry, std::atomic<bool> &shouldRun, const sigset_t &signals)
+        : registry(registry), shouldRun(shouldRun), signals(signals), signalFd(-1) {
+#ifdef __linux__
+    signalFd = signalfd(-1, &this->signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    checkSystemCall(signalFd, "signalfd failed in ProcessReaper");
+#endif
+}
+
+ProcessReaper::~ProcessReaper() {
+    if (signalFd != -1) {
+        close(signalFd);
+    }
+}
+
+void ProcessReaper::setTerminationHandler(std::function<void(int)> handler) {
+    terminationHandler = std::move(handler);
+}
+
+int ProcessReaper::reapChildren(const ReapCallback &onReaped) {
+    int reaped = 0;
+    int status;
+    pid_t pid;
+    ProcessRegistry::Entry entry{};
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        if (registry.remove(pid, status, &entry) && onReaped) {
+            onReaped(pid, status, entry);
+        }
+        reaped++;
+    }
+    return reaped;
+}
+
+int ProcessReaper::pruneRegistry(const ReapCallback &onReaped) {
+    int dropped = 0;
+    int status;
+    ProcessRegistry::Entry entry{};
+    for (pid_t pid: registry.pids()) {
+        pid_t result = waitpid(pid, &status, WNOHANG);
+        if (result == pid) {
+            if (registry.remove(pid, status, &entry) && onReaped) {
+                onReaped(pid, status, entry);
+            }
+        } else if (result == -1 && errno == ECHILD && registry.discard(pid)) {
+            dropped++;
+        }
+    }
+    return dropped;
+}
+
+// Reaps children in whatever order they exit until the registry is empty or the deadline passes
+bool ProcessReaper::waitForChildren(std::chrono::steady_clock::time_point until, const ReapCallback &onReaped) {
+    while (true) {
+        reapChildren(onReaped);
+        pruneRegistry(onReaped);
+        if (registry.size() == 0) {
+            return true;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= until) {
+            return false;
+        }
+        int timeoutMs = static_cast<int>(std::min<int64_t>(
+                100, std::chrono::duration_cast<std::chrono::milliseconds>(until - now).count() + 1));
+
+#ifdef __linux__
+        struct pollfd signalPoll = {signalFd, POLLIN, 0};
+        if (poll(&signalPoll, 1, timeoutMs) > 0) {
+            struct signalfd_siginfo info{};
+            while (read(signalFd, &info, sizeof(info)) == sizeof(info)) {
+            }
+        }
+#else
+        usleep(std::min(timeoutMs, 10) * 1000);
+#endif
+    }
+}
+
+void ProcessReaper::run() {
+    while (shouldRun.load()) {
+        int signal = 0;
+
+#ifdef __linux__
+        struct pollfd signalPoll = {signalFd, POLLIN, 0};
+        if (poll(&signalPoll, 1, 1000) <= 0) {
+            continue;
+        }
+
+        struct signalfd_siginfo info{};
+        if (read(signalFd, &info, sizeof(info)) != sizeof(info)) {
+            continue;
+        }
+        signal = static_cast<int>(info.ssi_signo);
+#else
+        if (sigwait(&signals, &signal) != 0) {
+            continue;
+        }
+#endif
+
+        if (signal == SIGCHLD) {
+            reapChildren();
+        } else if (terminationHandler) {
+            terminationHandler(signal);
+        }
+    }
+}
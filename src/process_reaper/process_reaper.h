@@ -0,0 +1,46 @@
+#ifndef SWIMMING_POOL_PROCESS_REAPER_H
+#define SWIMMING_POOL_PROCESS_REAPER_H
+
+#include "process_registry.h"
+#include <atomic>
+#include <csignal>
+#include <functional>
+
+// Consumes SIGCHLD and the termination signals synchronously on a dedicated thread, so the
+// main process never runs registry or shutdown code inside an asynchronous signal handler.
+// The signals must already be blocked in every thread (SignalHandler::setupSignalHandling).
+class ProcessReaper {
+public:
+    using ReapCallback = std::function<void(pid_t pid, int status, const ProcessRegistry::Entry &entry)>;
+
+private:
+    ProcessRegistry &registry;
+    std::atomic<bool> &shouldRun;
+    std::function<void(int)> terminationHandler;
+    sigset_t signals;
+    int signalFd;
+
+public:
+    ProcessReaper(ProcessRegistry &registry, std::atomic<bool> &shouldRun, const sigset_t &signals);
+
+    ~ProcessReaper();
+
+    void setTerminationHandler(std::function<void(int)> handler);
+
+    int reapChildren(const ReapCallback &onReaped = nullptr);
+
+    // Asks about every registered pid: exited ones are reaped, pids that are not (or no longer)
+    // children of this process are dropped. Afterwards each entry is a child not yet waited for,
+    // so its pid cannot have been reused and is safe to signal as long as only this thread reaps.
+    int pruneRegistry(const ReapCallback &onReaped = nullptr);
+
+    bool waitForChildren(std::chrono::steady_clock::time_point until, const ReapCallback &onReaped);
+
+    void run();
+
+    ProcessReaper(const ProcessReaper &) = delete;
+
+    ProcessReaper &operator=(const ProcessReaper &) = delete;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "process_registry.h"
+#include <sys/wait.h>
+#include <algorithm>
+#include <iterator>
+
+bool ProcessRegistry::add(pid_t pid, ProcessRole role) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats[static_cast<int>(role)].spawned++;
+
+    auto early = earlyExits.find(pid);
+    if (early != earlyExits.end()) {
+        recordExit(role, early->second.status, std::chrono::steady_clock::now());
+        earlyExits.erase(early);
+        return false;
+    }
+    entries[pid] = Entry{role, std::chrono::steady_clock::now()};
+    return true;
+}
+
+bool ProcessRegistry::remove(pid_t pid, int status, Entry *removed) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+    auto it = entries.find(pid);
+    if (it == entries.end()) {
+        // Reaped between fork() and add(): remember it so the registration does not leave a stale entry.
+        // Old records are dropped so a recycled pid of a later child is not mistaken for this one.
+        for (auto early = earlyExits.begin(); early != earlyExits.end();) {
+            early = now - early->second.reapedAt > EARLY_EXIT_TTL ? earlyExits.erase(early) : std::next(early);
+        }
+        earlyExits[pid] = EarlyExit{status, now};
+        return false;
+    }
+
+    recordExit(it->second.role, status, it->second.startTime);
+    if (removed) {
+        *removed = it->second;
+    }
+    entries.erase(it);
+    return true;
+}
+
+void ProcessRegistry::recordExit(ProcessRole role, int status, std::chrono::steady_clock::time_point startTime) {
+    RoleExitStats &roleStats = stats[static_cast<int>(role)];
+    if (WIFSIGNALED(status)) {
+        roleStats.killedBySignal++;
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        roleStats.exitedCleanly++;
+    } else {
+        roleStats.exitedWithError++;
+    }
+
+    auto lifetime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+    roleStats.totalLifetimeMs += lifetime;
+    roleStats.maxLifetimeMs = std::max<uint64_t>(roleStats.maxLifetimeMs, lifetime);
+}
+
+bool ProcessRegistry::discard(pid_t pid) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.erase(pid) != 0;
+}
+
+bool ProcessRegistry::contains(pid_t pid) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.count(pid) != 0;
+}
+
+size_t ProcessRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+std::vector<pid_t> ProcessRegistry::pids() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<pid_t> result;
+    result.reserve(entries.size());
+    for (const auto &entry: entries) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+RoleExitStats ProcessRegistry::getStats(ProcessRole role) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats[static_cast<int>(role)];
+}
+
+void ProcessRegistry::printStats(std::ostream &out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "Process exit statistics:\n";
+    for (int i = 0; i < static_cast<int>(ProcessRole::Count); i++) {
+        const RoleExitStats &roleStats = stats[i];
+        if (roleStats.spawned == 0) {
+            continue;
+        }
+        uint64_t exited = roleStats.exitedCleanly + roleStats.exitedWithError + roleStats.killedBySignal;
+        out << " - " << processRoleName(static_cast<ProcessRole>(i))
+            << ": spawned " << roleStats.spawned
+            << ", clean " << roleStats.exitedCleanly
+            << ", error " << roleStats.exitedWithError
+            << ", signaled " << roleStats.killedBySignal
+            << ", avg lifetime " << (exited ? roleStats.totalLifetimeMs / exited : 0) << " ms"
+            << ", max lifetime " << roleStats.maxLifetimeMs << " ms\n";
+    }
+    out.flush();
+}
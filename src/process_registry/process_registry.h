@@ -0,0 +1,64 @@
+#ifndef SWIMMING_POOL_PROCESS_REGISTRY_H
+#define SWIMMING_POOL_PROCESS_REGISTRY_H
+
+#include "process_role.h"
+#include <sys/types.h>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+struct RoleExitStats {
+    uint64_t spawned = 0;
+    uint64_t exitedCleanly = 0;
+    uint64_t exitedWithError = 0;
+    uint64_t killedBySignal = 0;
+    uint64_t totalLifetimeMs = 0;
+    uint64_t maxLifetimeMs = 0;
+};
+
+class ProcessRegistry {
+public:
+    struct Entry {
+        ProcessRole role;
+        std::chrono::steady_clock::time_point startTime;
+    };
+
+    // Registers a child after fork() returned. The reaper thread may already have collected it if it
+    // exited that quickly; then only its statistics are recorded and false is returned.
+    bool add(pid_t pid, ProcessRole role);
+
+    bool remove(pid_t pid, int status, Entry *removed = nullptr);
+
+    // Forgets a pid that is no longer a child of this process, without counting an exit
+    bool discard(pid_t pid);
+
+    bool contains(pid_t pid) const;
+
+    size_t size() const;
+
+    std::vector<pid_t> pids() const;
+
+    RoleExitStats getStats(ProcessRole role) const;
+
+    void printStats(std::ostream &out) const;
+
+private:
+    // How long the exit of a not yet registered pid is kept for the add() that is about to follow
+    static constexpr std::chrono::seconds EARLY_EXIT_TTL{5};
+
+    struct EarlyExit {
+        int status;
+        std::chrono::steady_clock::time_point reapedAt;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<pid_t, Entry> entries;
+    std::unordered_map<pid_t, EarlyExit> earlyExits;
+    RoleExitStats stats[static_cast<int>(ProcessRole::Count)];
+
+    void recordExit(ProcessRole role, int status, std::chrono::steady_clock::time_point startTime);
+};
+
+#endif
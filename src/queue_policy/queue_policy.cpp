@@ -0,0 +1,98 @@
+#include "queue_policy.h"
+#include "error_handler.h"
+#include <sstream>
+
+namespace {
+    const char *const POLICY_NAMES[QUEUE_POLICY_COUNT] = {"strict", "aging", "wfq"};
+    const char *const CLASS_NAMES[QUEUE_CLASS_COUNT] = {"regular", "vip"};
+
+    double parseNumber(const std::string &name, const std::string &value) {
+        try {
+            return std::stod(value);
+        } catch (const std::exception &) {
+            throw PoolError("Invalid value for " + name + ": " + value);
+        }
+    }
+
+    // Calls apply(name, value) for every name=value of a comma separated list
+    template<typename Apply>
+    void forEachParam(const std::string &spec, Apply apply) {
+        std::stringstream params(spec);
+        std::string param;
+        while (std::getline(params, param, ',')) {
+            size_t equals = param.find('=');
+            if (equals == std::string::npos) {
+                throw PoolError("Invalid parameter '" + param + "' in " + spec);
+            }
+            std::string name = param.substr(0, equals);
+            apply(name, parseNumber(name, param.substr(equals + 1)));
+        }
+    }
+}
+
+QueueSettings QueueSettings::parse(const std::string &policySpec, const std::string &sloSpec) {
+    QueueSettings settings;
+
+    size_t colon = policySpec.find(':');
+    std::string name = policySpec.substr(0, colon);
+    std::string params = colon == std::string::npos ? "" : policySpec.substr(colon + 1);
+    if (name == "strict") {
+        settings.policy = QUEUE_STRICT_PRIORITY;
+    } else if (name == "aging") {
+        settings.policy = QUEUE_AGING;
+    } else if (name == "wfq") {
+        settings.policy = QUEUE_WEIGHTED_FAIR;
+    } else {
+        throw PoolError("Unknown queue policy: " + name);
+    }
+
+    forEachParam(params, [&](const std::string &param, double value) {
+        if (settings.policy == QUEUE_AGING && param == "vip-bonus" && value >= 0) {
+            settings.vipBonusS = value;
+        } else if (settings.policy == QUEUE_WEIGHTED_FAIR && param == "vip-share" && value > 0 && value < 1) {
+            settings.vipShare = value;
+        } else {
+            throw PoolError("Invalid parameter " + param + " of queue policy " + name);
+        }
+    });
+
+    forEachParam(sloSpec, [&](const std::string &param, double value) {
+        int queueClass = param == "vip" ? QUEUE_CLASS_VIP : param == "regular" ? QUEUE_CLASS_REGULAR : -1;
+        if (queueClass < 0 || value < 0) {
+            throw PoolError("Invalid queue SLO " + param);
+        }
+        settings.waitSloS[queueClass] = value;
+    });
+    return settings;
+}
+
+const char *QueueSettings::policyName(int policy) {
+    return policy >= 0 && policy < QUEUE_POLICY_COUNT ? POLICY_NAMES[policy] : "unknown";
+}
+
+const char *QueueSettings::className(int queueClass) {
+    return queueClass >= 0 && queueClass < QUEUE_CLASS_COUNT ? CLASS_NAMES[queueClass] : "unknown";
+}
+
+void QueueSettings::apply(EntranceQueue &queue) const {
+    queue.policy = policy;
+    queue.vipBonusS = vipBonusS;
+    queue.vipShare = vipShare;
+    for (int queueClass = 0; queueClass < QUEUE_CLASS_COUNT; queueClass++) {
+        queue.waitSloS[queueClass] = waitSloS[queueClass];
+        queue.lastFinish[queueClass] = 0;
+    }
+    queue.virtualTime = 0;
+}
+
+std::string QueueSettings::describe() const {
+    std::ostringstream out;
+    out << policyName(policy);
+    if (policy == QUEUE_AGING) {
+        out << " (VIP bonus " << vipBonusS << " s)";
+    } else if (policy == QUEUE_WEIGHTED_FAIR) {
+        out << " (VIP share " << vipShare << ")";
+    }
+    out << ", wait SLO regular " << waitSloS[QUEUE_CLASS_REGULAR] << " s, VIP " << waitSloS[QUEUE_CLASS_VIP] << " s";
+    return out.str();
+}
@@ -0,0 +1,29 @@
+#ifndef SWIMMING_POOL_QUEUE_POLICY_H
+#define SWIMMING_POOL_QUEUE_POLICY_H
+
+#include "shared_memory.h"
+#include <string>
+
+// How the cashier orders the entrance queue and which waits count against the SLO, from the
+// --queue-policy and --queue-slo options of swimming_pool and pool_sim
+struct QueueSettings {
+    QueuePolicy policy = QUEUE_STRICT_PRIORITY;
+    double vipBonusS = 60;
+    double vipShare = 0.5;
+    double waitSloS[QUEUE_CLASS_COUNT] = {120, 30};
+
+    // policySpec: strict, aging:vip-bonus=s or wfq:vip-share=x; sloSpec: regular=s,vip=s (either may
+    // be left out). Throws PoolError on anything else.
+    static QueueSettings parse(const std::string &policySpec, const std::string &sloSpec);
+
+    static const char *policyName(int policy);
+
+    static const char *className(int queueClass);
+
+    // Call with the queue empty, before the cashier serves anyone
+    void apply(EntranceQueue &queue) const;
+
+    std::string describe() const;
+};
+
+#endif
@@ -0,0 +1,287 @@
+#include "recorder.h"
+#include "error_handler.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+    const char RECORDING_MAGIC[8] = {'P', 'O', 'O', 'L', 'R', 'E', 'C', '1'};
+    const uint32_t RECORDING_VERSION = 1;
+    const uint32_t KEYFRAME_INTERVAL = 600;
+    const size_t GROWTH_CHUNK = 4 * 1024 * 1024;
+    const size_t MAX_RECORD_BYTES = 20 + static_cast<size_t>(Snapshot::FIELD_COUNT) * 10;
+
+    // Same bits as the ClientFlags of the pool roster
+    int32_t clientFlags(bool isVip, bool hasSwimDiaper, bool hasGuardian) {
+        return (isVip ? CLIENT_VIP : 0) | (hasSwimDiaper ? CLIENT_SWIM_DIAPER : 0) |
+               (hasGuardian ? CLIENT_HAS_GUARDIAN : 0);
+    }
+
+    uint8_t *writeVarint(uint8_t *out, uint64_t value) {
+        while (value >= 0x80) {
+            *out++ = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<uint8_t>(value);
+        return out;
+    }
+
+    bool readVarint(const uint8_t *&in, const uint8_t *end, uint64_t &value) {
+        value = 0;
+        for (int shift = 0; in < end && shift < 64; shift += 7) {
+            uint8_t byte = *in++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t zigzag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+}
+
+void Snapshot::capture(const SharedMemory &shm, bool facilityOpen, Fields &out) {
+    out.fill(0);
+    out[FACILITY_OPEN] = facilityOpen;
+
+    const PoolState *pools[POOL_COUNT] = {&shm.olympic, &shm.recreational, &shm.kids};
+    for (int p = 0; p < POOL_COUNT; p++) {
+        int32_t *field = &out[POOLS_BASE + p * POOL_FIELDS];
+        int count = std::clamp(pools[p]->currentCount, 0, PoolState::MAX_CLIENTS);
+        field[0] = count;
+        field[1] = pools[p]->isClosed;
+        field[2] = pools[p]->isUnderMaintenance;
+        field += POOL_HEADER_FIELDS;
+        for (int i = 0; i < count; i++, field += CLIENT_FIELDS) {
+            field[0] = pools[p]->ids[i];
+            field[1] = pools[p]->ages[i];
+            field[2] = pools[p]->flags[i];
+            field[3] = pools[p]->guardianIds[i];
+        }
+    }
+
+    int32_t *field = &out[QUEUE_BASE];
+    int queueSize = std::clamp(shm.entranceQueue.queueSize, 0, EntranceQueue::MAX_QUEUE_SIZE);
+    *field++ = queueSize;
+    for (int i = 0; i < queueSize; i++, field += QUEUE_ENTRY_FIELDS) {
+        const EntranceQueue::QueueEntry &entry = shm.entranceQueue.queue[i];
+        field[0] = entry.clientId;
+        field[1] = entry.age;
+        field[2] = clientFlags(entry.isVip, entry.hasSwimDiaper, entry.hasGuardian);
+        field[3] = static_cast<int32_t>(entry.arrivalTime);
+    }
+}
+
+void Snapshot::restore(const Fields &fields, PoolState pools[POOL_COUNT], EntranceQueue &queue, bool &facilityOpen) {
+    facilityOpen = fields[FACILITY_OPEN] != 0;
+
+    for (int p = 0; p < POOL_COUNT; p++) {
+        const int32_t *field = &fields[POOLS_BASE + p * POOL_FIELDS];
+        pools[p].currentCount = std::clamp(field[0], 0, PoolState::MAX_CLIENTS);
+        pools[p].isClosed = field[1] != 0;
+        pools[p].isUnderMaintenance = field[2] != 0;
+        field += POOL_HEADER_FIELDS;
+        for (int i = 0; i < pools[p].currentCount; i++, field += CLIENT_FIELDS) {
+            pools[p].ids[i] = field[0];
+            pools[p].ages[i] = field[1];
+            pools[p].flags[i] = static_cast<uint8_t>(field[2]);
+            pools[p].guardianIds[i] = field[3];
+        }
+    }
+
+    const int32_t *field = &fields[QUEUE_BASE];
+    queue.queueSize = std::clamp(*field++, 0, EntranceQueue::MAX_QUEUE_SIZE);
+    for (int i = 0; i < queue.queueSize; i++, field += QUEUE_ENTRY_FIELDS) {
+        EntranceQueue::QueueEntry &entry = queue.queue[i];
+        entry.clientId = field[0];
+        entry.age = field[1];
+        entry.isVip = field[2] & 1;
+        entry.hasSwimDiaper = (field[2] & 2) != 0;
+        entry.hasGuardian = (field[2] & 4) != 0;
+        entry.arrivalTime = field[3];
+    }
+}
+
+OccupancyRecorder::OccupancyRecorder(const std::string &path, int rateHz, const int capacities[POOL_COUNT],
+                                     int64_t startTimeMs)
+        : mapping(nullptr), mappedBytes(0), header(nullptr), previousTimeMs(startTimeMs) {
+    previous.fill(0);
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    checkSystemCall(fd, "open failed in OccupancyRecorder");
+
+    try {
+        ensureCapacity(sizeof(RecordingHeader));
+    } catch (const std::exception &e) {
+        close(fd);
+        throw;
+    }
+
+    memcpy(header->magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    header->version = RECORDING_VERSION;
+    header->rateHz = rateHz;
+    header->fieldCount = Snapshot::FIELD_COUNT;
+    header->keyframeInterval = KEYFRAME_INTERVAL;
+    for (int i = 0; i < POOL_COUNT; i++) {
+        header->capacities[i] = capacities[i];
+    }
+    header->startTimeMs = startTimeMs;
+    header->dataBytes = 0;
+    header->recordCount = 0;
+}
+
+OccupancyRecorder::~OccupancyRecorder() {
+    size_t usedBytes = sizeof(RecordingHeader) + header->dataBytes;
+    msync(mapping, mappedBytes, MS_SYNC);
+    munmap(mapping, mappedBytes);
+    if (ftruncate(fd, static_cast<off_t>(usedBytes)) == -1) {
+        perror("ftruncate failed in OccupancyRecorder");
+    }
+    close(fd);
+}
+
+void OccupancyRecorder::ensureCapacity(size_t bytes) {
+    if (bytes <= mappedBytes) {
+        return;
+    }
+
+    size_t newSize = ((bytes + GROWTH_CHUNK - 1) / GROWTH_CHUNK) * GROWTH_CHUNK;
+    checkSystemCall(ftruncate(fd, static_cast<off_t>(newSize)), "ftruncate failed in OccupancyRecorder");
+
+    if (mapping) {
+        munmap(mapping, mappedBytes);
+    }
+
+    void *newMapping = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (newMapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw PoolSystemError("mmap failed in OccupancyRecorder");
+    }
+
+    mapping = static_cast<uint8_t *>(newMapping);
+    mappedBytes = newSize;
+    header = reinterpret_cast<RecordingHeader *>(mapping);
+}
+
+void OccupancyRecorder::append(int64_t timeMs, const Snapshot::Fields &fields) {
+    ensureCapacity(sizeof(RecordingHeader) + header->dataBytes + MAX_RECORD_BYTES);
+
+    bool keyframe = header->recordCount % KEYFRAME_INTERVAL == 0;
+    if (keyframe) {
+        previous.fill(0);
+    }
+
+    int changed = 0;
+    for (int i = 0; i < Snapshot::FIELD_COUNT; i++) {
+        changed += fields[i] != previous[i];
+    }
+
+    uint8_t *out = mapping + sizeof(RecordingHeader) + header->dataBytes;
+    uint8_t *start = out;
+
+    uint64_t elapsedMs = static_cast<uint64_t>(std::max<int64_t>(0, timeMs - previousTimeMs));
+    out = writeVarint(out, (elapsedMs << 1) | (keyframe ? 1 : 0));
+    out = writeVarint(out, changed);
+
+    int lastIndex = -1;
+    for (int i = 0; i < Snapshot::FIELD_COUNT; i++) {
+        if (fields[i] != previous[i]) {
+            out = writeVarint(out, i - lastIndex - 1);
+            out = writeVarint(out, zigzag(static_cast<int64_t>(fields[i]) - previous[i]));
+            lastIndex = i;
+        }
+    }
+
+    previous = fields;
+    previousTimeMs = timeMs;
+    header->dataBytes += out - start;
+    header->recordCount++;
+}
+
+RecordingReader::RecordingReader(const std::string &path)
+        : mapping(nullptr), mappedBytes(0), header(nullptr), offset(sizeof(RecordingHeader)), recordsRead(0) {
+    fd = open(path.c_str(), O_RDONLY);
+    checkSystemCall(fd, "open failed in RecordingReader");
+
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) == -1 || static_cast<size_t>(fileStat.st_size) < sizeof(RecordingHeader)) {
+        close(fd);
+        throw PoolError("Recording " + path + " is too short");
+    }
+
+    mappedBytes = fileStat.st_size;
+    void *fileMapping = mmap(nullptr, mappedBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (fileMapping == MAP_FAILED) {
+        close(fd);
+        throw PoolSystemError("mmap failed in RecordingReader");
+    }
+
+    mapping = static_cast<const uint8_t *>(fileMapping);
+    header = reinterpret_cast<const RecordingHeader *>(mapping);
+
+    if (memcmp(header->magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0 ||
+        header->version != RECORDING_VERSION || header->fieldCount != Snapshot::FIELD_COUNT) {
+        munmap(const_cast<uint8_t *>(mapping), mappedBytes);
+        close(fd);
+        throw PoolError("Unsupported recording format in " + path);
+    }
+
+    timeMs = header->startTimeMs;
+    current.fill(0);
+}
+
+RecordingReader::~RecordingReader() {
+    munmap(const_cast<uint8_t *>(mapping), mappedBytes);
+    close(fd);
+}
+
+bool RecordingReader::next(int64_t &sampleTimeMs, Snapshot::Fields &fields) {
+    size_t dataEnd = std::min(mappedBytes, sizeof(RecordingHeader) + header->dataBytes);
+    if (recordsRead >= header->recordCount || offset >= dataEnd) {
+        return false;
+    }
+
+    const uint8_t *in = mapping + offset;
+    const uint8_t *end = mapping + dataEnd;
+
+    uint64_t timeAndFlag;
+    uint64_t changed;
+    if (!readVarint(in, end, timeAndFlag) || !readVarint(in, end, changed)) {
+        return false;
+    }
+
+    if (timeAndFlag & 1) {
+        current.fill(0);
+    }
+
+    int index = -1;
+    for (uint64_t i = 0; i < changed; i++) {
+        uint64_t gap;
+        uint64_t delta;
+        if (!readVarint(in, end, gap) || !readVarint(in, end, delta)) {
+            return false;
+        }
+        index += static_cast<int>(gap) + 1;
+        if (index >= Snapshot::FIELD_COUNT) {
+            throw PoolError("Corrupted recording: field index out of range");
+        }
+        current[index] = static_cast<int32_t>(current[index] + unzigzag(delta));
+    }
+
+    timeMs += static_cast<int64_t>(timeAndFlag >> 1);
+    sampleTimeMs = timeMs;
+    fields = current;
+    offset = in - mapping;
+    recordsRead++;
+    return true;
+}
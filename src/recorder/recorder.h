@@ -0,0 +1,92 @@
+#ifndef SWIMMING_POOL_RECORDER_H
+#define SWIMMING_POOL_RECORDER_H
+
+#include "shared_memory.h"
+#include <array>
+#include <string>
+#include <cstddef>
+
+namespace Snapshot {
+    const int POOL_HEADER_FIELDS = 3;   // currentCount, isClosed, isUnderMaintenance
+    const int CLIENT_FIELDS = 4;        // id, age, flags, guardianId
+    const int POOL_FIELDS = POOL_HEADER_FIELDS + PoolState::MAX_CLIENTS * CLIENT_FIELDS;
+    const int QUEUE_ENTRY_FIELDS = 4;   // clientId, age, flags, arrivalTime
+    const int QUEUE_FIELDS = 1 + EntranceQueue::MAX_QUEUE_SIZE * QUEUE_ENTRY_FIELDS;
+
+    const int FACILITY_OPEN = 0;
+    const int POOLS_BASE = 1;
+    const int QUEUE_BASE = POOLS_BASE + POOL_COUNT * POOL_FIELDS;
+    const int FIELD_COUNT = QUEUE_BASE + QUEUE_FIELDS;
+
+    using Fields = std::array<int32_t, FIELD_COUNT>;
+
+    void capture(const SharedMemory &shm, bool facilityOpen, Fields &out);
+
+    void restore(const Fields &fields, PoolState pools[POOL_COUNT], EntranceQueue &queue, bool &facilityOpen);
+}
+
+struct RecordingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t rateHz;
+    uint32_t fieldCount;
+    uint32_t keyframeInterval;
+    int32_t capacities[POOL_COUNT];
+    int64_t startTimeMs;
+    uint64_t dataBytes;
+    uint64_t recordCount;
+};
+
+// Appends delta-encoded snapshots to a memory-mapped file. Each record stores only the fields that
+// changed since the previous sample, with a full keyframe every keyframeInterval records.
+class OccupancyRecorder {
+private:
+    int fd;
+    uint8_t *mapping;
+    size_t mappedBytes;
+    RecordingHeader *header;
+    Snapshot::Fields previous;
+    int64_t previousTimeMs;
+
+    void ensureCapacity(size_t bytes);
+
+public:
+    OccupancyRecorder(const std::string &path, int rateHz, const int capacities[POOL_COUNT], int64_t startTimeMs);
+
+    ~OccupancyRecorder();
+
+    void append(int64_t timeMs, const Snapshot::Fields &fields);
+
+    uint64_t bytesWritten() const { return header->dataBytes; }
+
+    OccupancyRecorder(const OccupancyRecorder &) = delete;
+
+    OccupancyRecorder &operator=(const OccupancyRecorder &) = delete;
+};
+
+class RecordingReader {
+private:
+    int fd;
+    const uint8_t *mapping;
+    size_t mappedBytes;
+    const RecordingHeader *header;
+    size_t offset;
+    uint64_t recordsRead;
+    int64_t timeMs;
+    Snapshot::Fields current;
+
+public:
+    explicit RecordingReader(const std::string &path);
+
+    ~RecordingReader();
+
+    const RecordingHeader &getHeader() const { return *header; }
+
+    bool next(int64_t &sampleTimeMs, Snapshot::Fields &fields);
+
+    RecordingReader(const RecordingReader &) = delete;
+
+    RecordingReader &operator=(const RecordingReader &) = delete;
+};
+
+#endif
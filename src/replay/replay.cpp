@@ -0,0 +1,208 @@
+#include "recorder.h"
+#include "ui_manager.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <ctime>
+
+namespace {
+    const int AREA_COUNT = POOL_COUNT + 1;
+    const int QUEUE_AREA = POOL_COUNT;
+    const char *const AREA_NAMES[AREA_COUNT] = {"olympic", "recreational", "children", "queue"};
+
+    struct Aggregate {
+        uint64_t samples = 0;
+        uint64_t occupancySum = 0;
+        int maxOccupancy = 0;
+        uint64_t closedSamples = 0;
+        uint64_t fullSamples = 0;
+
+        void add(int occupancy, bool closed, bool full) {
+            samples++;
+            occupancySum += occupancy;
+            maxOccupancy = std::max(maxOccupancy, occupancy);
+            closedSamples += closed;
+            fullSamples += full;
+        }
+
+        double mean() const { return samples ? static_cast<double>(occupancySum) / samples : 0.0; }
+
+        double closedFraction() const { return samples ? static_cast<double>(closedSamples) / samples : 0.0; }
+
+        double fullFraction() const { return samples ? static_cast<double>(fullSamples) / samples : 0.0; }
+    };
+
+    struct ReplayOptions {
+        std::string recordingPath;
+        double speed = 1.0;
+        bool render = true;
+        std::string csvPath;
+        std::string jsonPath;
+    };
+
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program
+                  << " <recording> [--speed x] [--no-render] [--csv path] [--json path]" << std::endl;
+    }
+
+    bool parseOptions(int argc, char *argv[], ReplayOptions &options) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--speed" && i + 1 < argc) {
+                options.speed = atof(argv[++i]);
+            } else if (arg == "--no-render") {
+                options.render = false;
+            } else if (arg == "--csv" && i + 1 < argc) {
+                options.csvPath = argv[++i];
+            } else if (arg == "--json" && i + 1 < argc) {
+                options.jsonPath = argv[++i];
+            } else if (arg[0] != '-' && options.recordingPath.empty()) {
+                options.recordingPath = arg;
+            } else {
+                return false;
+            }
+        }
+        return !options.recordingPath.empty() && options.speed >= 0;
+    }
+
+    std::string formatTime(int64_t timeMs) {
+        time_t seconds = static_cast<time_t>(timeMs / 1000);
+        struct tm timeinfo{};
+        localtime_r(&seconds, &timeinfo);
+        char buffer[32];
+        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
+        return buffer;
+    }
+
+    int hourOf(int64_t timeMs) {
+        time_t seconds = static_cast<time_t>(timeMs / 1000);
+        struct tm timeinfo{};
+        localtime_r(&seconds, &timeinfo);
+        return timeinfo.tm_hour;
+    }
+
+    void writeCsvRow(std::ofstream &out, const std::string &hour, int area, const Aggregate &aggregate) {
+        out << hour << "," << AREA_NAMES[area] << "," << aggregate.samples << ","
+            << aggregate.mean() << "," << aggregate.maxOccupancy << ","
+            << aggregate.closedFraction() << "," << aggregate.fullFraction() << "\n";
+    }
+
+    void writeJsonAggregate(std::ofstream &out, const Aggregate &aggregate) {
+        out << "{\"samples\": " << aggregate.samples
+            << ", \"mean_occupancy\": " << aggregate.mean()
+            << ", \"max_occupancy\": " << aggregate.maxOccupancy
+            << ", \"closed_fraction\": " << aggregate.closedFraction()
+            << ", \"full_fraction\": " << aggregate.fullFraction() << "}";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    ReplayOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        RecordingReader reader(options.recordingPath);
+        const RecordingHeader &header = reader.getHeader();
+
+        Aggregate overall[AREA_COUNT];
+        Aggregate hourly[24][AREA_COUNT];
+
+        PoolState pools[POOL_COUNT]{};
+        EntranceQueue queue{};
+        bool facilityOpen = false;
+        Snapshot::Fields fields{};
+
+        int64_t sampleTimeMs = 0;
+        int64_t firstTimeMs = -1;
+        int64_t previousTimeMs = 0;
+        uint64_t samples = 0;
+
+        while (reader.next(sampleTimeMs, fields)) {
+            Snapshot::restore(fields, pools, queue, facilityOpen);
+            if (firstTimeMs < 0) {
+                firstTimeMs = previousTimeMs = sampleTimeMs;
+            }
+
+            int hour = hourOf(sampleTimeMs);
+            for (int p = 0; p < POOL_COUNT; p++) {
+                bool full = pools[p].currentCount >= header.capacities[p];
+                overall[p].add(pools[p].currentCount, pools[p].isClosed, full);
+                hourly[hour][p].add(pools[p].currentCount, pools[p].isClosed, full);
+            }
+            bool queueFull = queue.queueSize >= EntranceQueue::MAX_QUEUE_SIZE - 1;
+            overall[QUEUE_AREA].add(queue.queueSize, !facilityOpen, queueFull);
+            hourly[hour][QUEUE_AREA].add(queue.queueSize, !facilityOpen, queueFull);
+            samples++;
+
+            if (options.render) {
+                if (options.speed > 0) {
+                    auto delay = std::chrono::duration<double, std::milli>(
+                            (sampleTimeMs - previousTimeMs) / options.speed);
+                    std::this_thread::sleep_for(delay);
+                }
+                std::ostringstream title;
+                title << "Swimming Pool Replay - " << formatTime(sampleTimeMs) << " (x" << options.speed << ")";
+                UIManager::renderFrame(title.str(), facilityOpen, pools, header.capacities, queue);
+            }
+            previousTimeMs = sampleTimeMs;
+        }
+
+        double durationS = firstTimeMs < 0 ? 0.0 : (sampleTimeMs - firstTimeMs) / 1000.0;
+        std::cout << "\nReplayed " << samples << " samples covering " << durationS << " s" << std::endl;
+        for (int area = 0; area < AREA_COUNT; area++) {
+            std::cout << std::setw(13) << AREA_NAMES[area] << ": mean " << std::fixed << std::setprecision(2)
+                      << overall[area].mean() << ", max " << overall[area].maxOccupancy << std::endl;
+        }
+
+        if (!options.csvPath.empty()) {
+            std::ofstream csv(options.csvPath);
+            csv << "hour,area,samples,mean_occupancy,max_occupancy,closed_fraction,full_fraction\n";
+            for (int area = 0; area < AREA_COUNT; area++) {
+                writeCsvRow(csv, "all", area, overall[area]);
+            }
+            for (int hour = 0; hour < 24; hour++) {
+                for (int area = 0; area < AREA_COUNT; area++) {
+                    if (hourly[hour][area].samples) {
+                        writeCsvRow(csv, std::to_string(hour), area, hourly[hour][area]);
+                    }
+                }
+            }
+        }
+
+        if (!options.jsonPath.empty()) {
+            std::ofstream json(options.jsonPath);
+            json << "{\n  \"samples\": " << samples << ",\n  \"duration_s\": " << durationS
+                 << ",\n  \"rate_hz\": " << header.rateHz << ",\n  \"overall\": {";
+            for (int area = 0; area < AREA_COUNT; area++) {
+                json << (area ? ", " : "") << "\"" << AREA_NAMES[area] << "\": ";
+                writeJsonAggregate(json, overall[area]);
+            }
+            json << "},\n  \"hourly\": [";
+            bool first = true;
+            for (int hour = 0; hour < 24; hour++) {
+                if (!hourly[hour][0].samples) {
+                    continue;
+                }
+                json << (first ? "\n" : ",\n") << "    {\"hour\": " << hour;
+                for (int area = 0; area < AREA_COUNT; area++) {
+                    json << ", \"" << AREA_NAMES[area] << "\": ";
+                    writeJsonAggregate(json, hourly[hour][area]);
+                }
+                json << "}";
+                first = false;
+            }
+            json << "\n  ]\n}\n";
+        }
+
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Replay error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,212 @@
+#include "roster_scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ROSTER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    struct Kernels {
+        int64_t (*sumAges)(const int32_t *ages, int count);
+        int (*findMember)(const int32_t *ids, const int32_t *guardianIds, int count, int32_t clientId);
+        int (*countFlags)(const uint8_t *flags, int count, uint8_t mask);
+    };
+
+    int64_t sumAgesScalar(const int32_t *ages, int count) {
+        int64_t sum = 0;
+        for (int i = 0; i < count; i++) {
+            sum += ages[i];
+        }
+        return sum;
+    }
+
+    int findMemberScalar(const int32_t *ids, const int32_t *guardianIds, int count, int32_t clientId) {
+        for (int i = 0; i < count; i++) {
+            if (ids[i] == clientId || guardianIds[i] == clientId) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    int countFlagsScalar(const uint8_t *flags, int count, uint8_t mask) {
+        int matches = 0;
+        for (int i = 0; i < count; i++) {
+            matches += (flags[i] & mask) != 0;
+        }
+        return matches;
+    }
+
+#ifdef ROSTER_X86
+    // 32-bit lanes are folded into the 64-bit total often enough that they cannot overflow
+    const int SUM_BLOCK = 1 << 20;
+
+    int64_t sumAgesSse2(const int32_t *ages, int count) {
+        int64_t sum = 0;
+        int i = 0;
+        while (count - i >= 4) {
+            int blockEnd = i + ((count - i < SUM_BLOCK ? count - i : SUM_BLOCK) & ~3);
+            __m128i lanes = _mm_setzero_si128();
+            for (; i < blockEnd; i += 4) {
+                lanes = _mm_add_epi32(lanes, _mm_loadu_si128(reinterpret_cast<const __m128i *>(ages + i)));
+            }
+            alignas(16) int32_t parts[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(parts), lanes);
+            sum += static_cast<int64_t>(parts[0]) + parts[1] + parts[2] + parts[3];
+        }
+        return sum + sumAgesScalar(ages + i, count - i);
+    }
+
+    int findMemberSse2(const int32_t *ids, const int32_t *guardianIds, int count, int32_t clientId) {
+        const __m128i needle = _mm_set1_epi32(clientId);
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i idMatch = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ids + i)), needle);
+            __m128i guardianMatch = _mm_cmpeq_epi32(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(guardianIds + i)), needle);
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(idMatch, guardianMatch)));
+            if (mask) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        int rest = findMemberScalar(ids + i, guardianIds + i, count - i, clientId);
+        return rest < 0 ? -1 : i + rest;
+    }
+
+    int countFlagsSse2(const uint8_t *flags, int count, uint8_t mask) {
+        const __m128i bits = _mm_set1_epi8(static_cast<char>(mask));
+        const __m128i zero = _mm_setzero_si128();
+        int matches = 0;
+        int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i masked = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(flags + i)), bits);
+            int clear = _mm_movemask_epi8(_mm_cmpeq_epi8(masked, zero));
+            matches += 16 - __builtin_popcount(clear);
+        }
+        return matches + countFlagsScalar(flags + i, count - i, mask);
+    }
+
+    __attribute__((target("avx2")))
+    int64_t sumAgesAvx2(const int32_t *ages, int count) {
+        int64_t sum = 0;
+        int i = 0;
+        while (count - i >= 8) {
+            int blockEnd = i + ((count - i < SUM_BLOCK ? count - i : SUM_BLOCK) & ~7);
+            __m256i lanes = _mm256_setzero_si256();
+            for (; i < blockEnd; i += 8) {
+                lanes = _mm256_add_epi32(lanes, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ages + i)));
+            }
+            alignas(32) int32_t parts[8];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(parts), lanes);
+            for (int32_t part: parts) {
+                sum += part;
+            }
+        }
+        return sum + sumAgesScalar(ages + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    int findMemberAvx2(const int32_t *ids, const int32_t *guardianIds, int count, int32_t clientId) {
+        const __m256i needle = _mm256_set1_epi32(clientId);
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i idMatch = _mm256_cmpeq_epi32(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ids + i)), needle);
+            __m256i guardianMatch = _mm256_cmpeq_epi32(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(guardianIds + i)), needle);
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(idMatch, guardianMatch)));
+            if (mask) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        int rest = findMemberScalar(ids + i, guardianIds + i, count - i, clientId);
+        return rest < 0 ? -1 : i + rest;
+    }
+
+    __attribute__((target("avx2,popcnt")))
+    int countFlagsAvx2(const uint8_t *flags, int count, uint8_t mask) {
+        const __m256i bits = _mm256_set1_epi8(static_cast<char>(mask));
+        const __m256i zero = _mm256_setzero_si256();
+        int matches = 0;
+        int i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i masked = _mm256_and_si256(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(flags + i)), bits);
+            auto clear = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(masked, zero)));
+            matches += 32 - __builtin_popcount(clear);
+        }
+        return matches + countFlagsScalar(flags + i, count - i, mask);
+    }
+#endif
+
+    const Kernels KERNELS[ROSTER_KERNEL_COUNT] = {
+            {sumAgesScalar, findMemberScalar, countFlagsScalar},
+#ifdef ROSTER_X86
+            {sumAgesSse2,   findMemberSse2,   countFlagsSse2},
+            {sumAgesAvx2,   findMemberAvx2,   countFlagsAvx2},
+#else
+            {sumAgesScalar, findMemberScalar, countFlagsScalar},
+            {sumAgesScalar, findMemberScalar, countFlagsScalar},
+#endif
+    };
+
+    const char *const KERNEL_NAMES[ROSTER_KERNEL_COUNT] = {"scalar", "sse2", "avx2"};
+
+    RosterKernel bestKernel() {
+#ifdef ROSTER_X86
+        // Runs from a static initializer, possibly before libgcc has probed the CPU
+        __builtin_cpu_init();
+#endif
+        for (int kernel = ROSTER_KERNEL_COUNT - 1; kernel > ROSTER_SCALAR; kernel--) {
+            if (RosterScan::isSupported(static_cast<RosterKernel>(kernel))) {
+                return static_cast<RosterKernel>(kernel);
+            }
+        }
+        return ROSTER_SCALAR;
+    }
+
+    RosterKernel selected = bestKernel();
+}
+
+int64_t RosterScan::sumAges(const int32_t *ages, int count) {
+    return KERNELS[selected].sumAges(ages, count);
+}
+
+int RosterScan::findMember(const int32_t *ids, const int32_t *guardianIds, int count, int32_t clientId) {
+    return KERNELS[selected].findMember(ids, guardianIds, count, clientId);
+}
+
+int RosterScan::countFlags(const uint8_t *flags, int count, uint8_t mask) {
+    return KERNELS[selected].countFlags(flags, count, mask);
+}
+
+RosterKernel RosterScan::kernel() {
+    return selected;
+}
+
+bool RosterScan::setKernel(RosterKernel kernel) {
+    if (!isSupported(kernel)) {
+        return false;
+    }
+    selected = kernel;
+    return true;
+}
+
+bool RosterScan::isSupported(RosterKernel kernel) {
+    switch (kernel) {
+        case ROSTER_SCALAR:
+            return true;
+#ifdef ROSTER_X86
+        case ROSTER_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case ROSTER_AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+        default:
+            return false;
+    }
+}
+
+const char *RosterScan::kernelName(RosterKernel kernel) {
+    return kernel < ROSTER_KERNEL_COUNT ? KERNEL_NAMES[kernel] : "unknown";
+}
@@ -0,0 +1,35 @@
+#ifndef SWIMMING_POOL_ROSTER_SCAN_H
+#define SWIMMING_POOL_ROSTER_SCAN_H
+
+#include <cstdint>
+
+enum RosterKernel {
+    ROSTER_SCALAR,
+    ROSTER_SSE2,
+    ROSTER_AVX2,
+    ROSTER_KERNEL_COUNT
+};
+
+// Scans over the structure-of-arrays client roster of PoolState. The widest kernel the CPU
+// supports is picked on first use; the scalar one is the fallback on other architectures.
+class RosterScan {
+public:
+    static int64_t sumAges(const int32_t *ages, int count);
+
+    // Index of the first client with this id or whose guardian it is, -1 if there is none
+    static int findMember(const int32_t *ids, const int32_t *guardianIds, int count, int32_t clientId);
+
+    // Number of clients with any of the mask's flags set
+    static int countFlags(const uint8_t *flags, int count, uint8_t mask);
+
+    static RosterKernel kernel();
+
+    // Returns false when the CPU lacks the instructions; used by the benchmark to compare kernels
+    static bool setKernel(RosterKernel kernel);
+
+    static bool isSupported(RosterKernel kernel);
+
+    static const char *kernelName(RosterKernel kernel);
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "shutdown_coordinator.h"
+#include <algorithm>
+#include <csignal>
+#include <vector>
+
+ShutdownCoordinator::ShutdownCoordinator(ProcessRegistry &registry, ProcessReaper &reaper, double graceS,
+                                         double deadlineS)
+        : registry(registry), reaper(reaper), graceS(graceS), deadlineS(deadlineS) {}
+
+void ShutdownCoordinator::reset() {
+    if (SharedMemory *shm = SharedSegment::get()) {
+        shm->shutdown.stopRequested.store(0);
+    }
+}
+
+// Only children that pruneRegistry() just confirmed as ours and not yet reaped are signaled, so a
+// recycled pid of an unrelated process is never hit
+int ShutdownCoordinator::signalRemaining(int signal, const ProcessReaper::ReapCallback &onReaped) {
+    reaper.pruneRegistry(onReaped);
+    int signaled = 0;
+    for (pid_t pid: registry.pids()) {
+        if (kill(pid, signal) == 0) {
+            signaled++;
+        }
+    }
+    return signaled;
+}
+
+void ShutdownCoordinator::run(std::ostream &report) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    auto graceEnd = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(graceS));
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(deadlineS));
+
+    // Exits from before the shutdown began are not part of its report
+    reaper.reapChildren();
+    reaper.pruneRegistry();
+    size_t children = registry.size();
+    std::vector<SlowProcess> slowest;
+    int exitedOnStopEvent = 0;
+    int terminated = 0;
+    int killed = 0;
+    int *phaseCounter = &exitedOnStopEvent;
+
+    auto onReaped = [&](pid_t pid, int, const ProcessRegistry::Entry &entry) {
+        (*phaseCounter)++;
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        slowest.push_back({pid, entry.role, seconds});
+        if (slowest.size() > SLOWEST_REPORTED) {
+            auto fastest = std::min_element(slowest.begin(), slowest.end(),
+                                            [](const SlowProcess &a, const SlowProcess &b) {
+                                                return a.seconds < b.seconds;
+                                            });
+            slowest.erase(fastest);
+        }
+    };
+
+    if (SharedMemory *shm = SharedSegment::get()) {
+        shm->shutdown.stopRequested.store(1);
+    }
+
+    bool done = reaper.waitForChildren(graceEnd, onReaped);
+    if (!done) {
+        phaseCounter = &terminated;
+        signalRemaining(SIGTERM, onReaped);
+        done = reaper.waitForChildren(deadline, onReaped);
+    }
+    if (!done) {
+        phaseCounter = &killed;
+        int stragglers = signalRemaining(SIGKILL, onReaped);
+        report << "Shutdown deadline of " << deadlineS << " s exceeded, killed " << stragglers << " processes\n";
+        reaper.waitForChildren(Clock::now() + std::chrono::seconds(1), onReaped);
+    }
+
+    double totalS = std::chrono::duration<double>(Clock::now() - start).count();
+    report << "Shutdown of " << children << " processes took " << totalS << " s ("
+           << exitedOnStopEvent << " on stop event, " << terminated << " after SIGTERM, "
+           << killed << " after SIGKILL";
+    if (registry.size() > 0) {
+        report << ", " << registry.size() << " not reaped";
+    }
+    report << ")\n";
+
+    std::sort(slowest.begin(), slowest.end(), [](const SlowProcess &a, const SlowProcess &b) {
+        return a.seconds > b.seconds;
+    });
+    if (!slowest.empty()) {
+        report << "Slowest processes:\n";
+        for (const SlowProcess &process: slowest) {
+            report << " - " << processRoleName(process.role) << " " << process.pid << ": "
+                   << process.seconds << " s\n";
+        }
+    }
+    registry.printStats(report);
+}
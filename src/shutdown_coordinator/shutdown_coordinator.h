@@ -0,0 +1,42 @@
+#ifndef SWIMMING_POOL_SHUTDOWN_COORDINATOR_H
+#define SWIMMING_POOL_SHUTDOWN_COORDINATOR_H
+
+#include "shared_segment.h"
+#include "process_registry.h"
+#include "process_reaper.h"
+#include <ostream>
+
+// Stops every child in three steps: a stop event in shared memory that the component loops poll,
+// SIGTERM for those still running after the grace period and SIGKILL once the deadline passes.
+// Children are reaped in exit order through the ProcessReaper while the coordinator waits.
+class ShutdownCoordinator {
+private:
+    static const int SLOWEST_REPORTED = 5;
+
+    struct SlowProcess {
+        pid_t pid;
+        ProcessRole role;
+        double seconds;
+    };
+
+    ProcessRegistry &registry;
+    ProcessReaper &reaper;
+    double graceS;
+    double deadlineS;
+
+    int signalRemaining(int signal, const ProcessReaper::ReapCallback &onReaped);
+
+public:
+    ShutdownCoordinator(ProcessRegistry &registry, ProcessReaper &reaper, double graceS, double deadlineS);
+
+    static void reset();
+
+    static bool stopRequested() {
+        SharedMemory *shm = SharedSegment::get();
+        return shm && shm->shutdown.stopRequested.load(std::memory_order_relaxed);
+    }
+
+    void run(std::ostream &report);
+};
+
+#endif
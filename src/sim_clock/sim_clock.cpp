@@ -0,0 +1,24 @@
+#include "sim_clock.h"
+
+void SimClock::initialize(double speed, int startHour, int startMinute) {
+    SharedMemory *shm = SharedSegment::get();
+    if (!shm) {
+        return;
+    }
+
+    time_t start = time(nullptr);
+    if (startHour >= 0) {
+        struct tm timeinfo{};
+        localtime_r(&start, &timeinfo);
+        timeinfo.tm_hour = startHour;
+        timeinfo.tm_min = startMinute;
+        timeinfo.tm_sec = 0;
+        timeinfo.tm_isdst = -1;
+        start = mktime(&timeinfo);
+    }
+
+    int64_t epochNs = startHour >= 0 ? static_cast<int64_t>(start) * 1000000000LL : realtimeNs();
+    shm->clock.epochNs.store(epochNs, std::memory_order_relaxed);
+    shm->clock.startMonotonicNs.store(monotonicNs(), std::memory_order_relaxed);
+    shm->clock.speed.store(speed, std::memory_order_release);
+}
@@ -0,0 +1,67 @@
+#ifndef SWIMMING_POOL_SIM_CLOCK_H
+#define SWIMMING_POOL_SIM_CLOCK_H
+
+#include "shared_segment.h"
+#include <chrono>
+#include <ctime>
+#include <thread>
+
+// Simulated time of the facility, shared by every process through the main segment. The clock
+// starts at a chosen wall-clock moment and runs speed times faster than real time, so ticket
+// validity, working hours and the timed waits of all components stay consistent under
+// compression. Without the segment (tools, benchmarks) it falls back to the real clock.
+class SimClock {
+private:
+    static int64_t realtimeNs() {
+        struct timespec ts{};
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    static int64_t monotonicNs() {
+        struct timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+public:
+    // startHour < 0 starts from the current wall-clock time, otherwise from that hour today
+    static void initialize(double speed, int startHour, int startMinute = 0);
+
+    static double speed() {
+        SharedMemory *shm = SharedSegment::get();
+        double value = shm ? shm->clock.speed.load(std::memory_order_relaxed) : 0.0;
+        return value > 0 ? value : 1.0;
+    }
+
+    // Simulated CLOCK_REALTIME in nanoseconds
+    static int64_t nowNs() {
+        SharedMemory *shm = SharedSegment::get();
+        double value = shm ? shm->clock.speed.load(std::memory_order_relaxed) : 0.0;
+        if (value <= 0) {
+            return realtimeNs();
+        }
+        int64_t elapsed = monotonicNs() - shm->clock.startMonotonicNs.load(std::memory_order_relaxed);
+        return shm->clock.epochNs.load(std::memory_order_relaxed) + static_cast<int64_t>(elapsed * value);
+    }
+
+    // Drop-in for time(nullptr)
+    static time_t now() {
+        return static_cast<time_t>(nowNs() / 1000000000LL);
+    }
+
+    static int hour() {
+        time_t simulated = now();
+        struct tm timeinfo{};
+        localtime_r(&simulated, &timeinfo);
+        return timeinfo.tm_hour;
+    }
+
+    // Waits the given amount of simulated time
+    template<typename Rep, typename Period>
+    static void sleepFor(std::chrono::duration<Rep, Period> duration) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(duration) / speed());
+    }
+};
+
+#endif
@@ -1,5 +1,5 @@
 #include "ticket.h"
-#include <ctime>
+#include "sim_clock.h"
 
 Ticket::Ticket(int id, int clientId, int validityTime, time_t issueTime, bool isVip, bool isChild)
         : id(id),
@@ -10,14 +10,12 @@ Ticket::Ticket(int id, int clientId, int validityTime, time_t issueTime, bool is
           isChild(isChild) {}
 
 bool Ticket::isValid() const {
-    time_t now;
-    time(&now);
+    time_t now = SimClock::now();
     return difftime(now, issueTime) < (validityTime * 60);
 }
 
 int Ticket::getRemainingTime() const {
-    time_t now;
-    time(&now);
+    time_t now = SimClock::now();
     int elapsedSeconds = static_cast<int>(difftime(now, issueTime));
     int remainingSeconds = (validityTime * 60) - elapsedSeconds;
     return remainingSeconds > 0 ? remainingSeconds / 60 : 0;
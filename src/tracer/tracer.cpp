@@ -0,0 +1,156 @@
+#include "tracer.h"
+#include "metrics.h"
+#include <cstdio>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+TraceSegment *Tracer::segment = nullptr;
+bool Tracer::attached = false;
+std::atomic<TraceRing *> Tracer::processRing(nullptr);
+std::atomic<bool> Tracer::noRingAvailable(false);
+
+namespace {
+    struct SpanInfo {
+        const char *name;
+        const char *category;
+        const char *argNames[2];
+        bool secondArgIsPool;
+        const char *resultName;
+    };
+
+    const SpanInfo SPANS[TRACE_SPAN_COUNT] = {
+            {"ticket_wait",      "client",    {"client", "vip"},      false, "ticket"},
+            {"queue_add",        "cashier",   {"client", "vip"},      false, "position"},
+            {"process_client",   "cashier",   {"queue_size", ""},     false, "client"},
+            {"pool_enter",       "pool",      {"client", "pool"},     true,  "admitted"},
+            {"pool_leave",       "pool",      {"client", "pool"},     true,  nullptr},
+            {"socket_connect",   "client",    {"client", "pool"},     true,  nullptr},
+            {"enter_retry_wait", "client",    {"client", "retry"},    false, nullptr},
+            {"notify_clients",   "lifeguard", {"pool", "action"},     false, "sockets"},
+            {"evacuation",       "lifeguard", {"client", "pool"},     true,  nullptr},
+    };
+
+    const char *POOL_NAMES[] = {"Olympic", "Recreational", "Children"};
+
+    thread_local int32_t cachedTid = 0;
+
+    int32_t currentTid() {
+        if (cachedTid == 0) {
+#ifdef SYS_gettid
+            cachedTid = static_cast<int32_t>(syscall(SYS_gettid));
+#else
+            cachedTid = getpid();
+#endif
+        }
+        return cachedTid;
+    }
+}
+
+void Tracer::setEnabled(bool value) {
+    if (SharedMemory *shm = SharedSegment::get()) {
+        shm->trace.enabled.store(value ? 1 : 0, std::memory_order_relaxed);
+    }
+}
+
+void Tracer::createSegment() {
+    segment = static_cast<TraceSegment *>(RingSegment::create(TRACE_SHM_KEY, sizeof(TraceSegment)));
+    for (auto &ring: segment->rings) {
+        ring.owner.store(0, std::memory_order_release);
+    }
+    attached = true;
+}
+
+void Tracer::removeSegment() {
+    RingSegment::remove(TRACE_SHM_KEY, sizeof(TraceSegment));
+}
+
+TraceSegment *Tracer::getSegment() {
+    if (!attached) {
+        attached = true;
+        segment = static_cast<TraceSegment *>(RingSegment::attach(TRACE_SHM_KEY, sizeof(TraceSegment)));
+    }
+    return segment;
+}
+
+TraceRing *Tracer::claimRing() {
+    static bool forkHandlerInstalled = false;
+    if (!forkHandlerInstalled) {
+        forkHandlerInstalled = true;
+        pthread_atfork(nullptr, nullptr, [] {
+            processRing.store(nullptr, std::memory_order_relaxed);
+            noRingAvailable.store(false, std::memory_order_relaxed);
+            cachedTid = 0;
+        });
+    }
+
+    TraceSegment *traceSegment = getSegment();
+    TraceRing *ring = traceSegment ? claimFreeRing(traceSegment->rings, getpid()) : nullptr;
+    if (!ring) {
+        noRingAvailable.store(true, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    TraceRing *none = nullptr;
+    if (processRing.compare_exchange_strong(none, ring, std::memory_order_acq_rel)) {
+        return ring;
+    }
+    ring->owner.store(0, std::memory_order_release);
+    return none;
+}
+
+void Tracer::record(TraceSpan span, char phase, int argCount, int64_t arg0, int64_t arg1) {
+    TraceRing *ring = processRing.load(std::memory_order_acquire);
+    if (!ring) {
+        if (noRingAvailable.load(std::memory_order_relaxed) || !(ring = claimRing())) {
+            return;
+        }
+    }
+
+    TraceEntry entry{};
+    entry.timestampNs = Metrics::nowNs();
+    entry.pid = ring->owner.load(std::memory_order_relaxed);
+    entry.tid = currentTid();
+    entry.span = span;
+    entry.phase = phase;
+    entry.argCount = static_cast<uint8_t>(argCount);
+    entry.args[0] = arg0;
+    entry.args[1] = arg1;
+    ring->push(entry);
+}
+
+std::string Tracer::toJson(const TraceEntry &entry) {
+    if (entry.span >= TRACE_SPAN_COUNT) {
+        return "{}";
+    }
+    const SpanInfo &info = SPANS[entry.span];
+
+    char buffer[320];
+    int length = snprintf(buffer, sizeof(buffer),
+                          R"({"name":"%s","cat":"%s","ph":"%c","ts":%.3f,"pid":%d,"tid":%d)",
+                          info.name, info.category, entry.phase,
+                          static_cast<double>(entry.timestampNs) / 1000.0, entry.pid, entry.tid);
+    std::string json(buffer, length);
+
+    if (entry.phase == 'i') {
+        json += R"(,"s":"p")";
+    }
+
+    if (entry.phase == 'E' && entry.argCount > 0 && info.resultName) {
+        json += R"(,"args":{")" + std::string(info.resultName) + "\":" + std::to_string(entry.args[0]) + "}";
+    } else if (entry.phase != 'E' && entry.argCount > 0) {
+        json += R"(,"args":{")" + std::string(info.argNames[0]) + "\":" + std::to_string(entry.args[0]);
+        if (entry.argCount > 1 && info.argNames[1][0] != '\0') {
+            json += ",\"" + std::string(info.argNames[1]) + "\":";
+            if (info.secondArgIsPool && entry.args[1] >= 0 && entry.args[1] < 3) {
+                json += "\"" + std::string(POOL_NAMES[entry.args[1]]) + "\"";
+            } else {
+                json += std::to_string(entry.args[1]);
+            }
+        }
+        json += "}";
+    }
+
+    json += "}";
+    return json;
+}
@@ -0,0 +1,132 @@
+#ifndef SWIMMING_POOL_TRACER_H
+#define SWIMMING_POOL_TRACER_H
+
+#include "shared_ring.h"
+#include "shared_segment.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+const key_t TRACE_SHM_KEY = 6971;
+
+enum TraceSpan : uint16_t {
+    TRACE_TICKET_WAIT,
+    TRACE_QUEUE_ADD,
+    TRACE_PROCESS_CLIENT,
+    TRACE_POOL_ENTER,
+    TRACE_POOL_LEAVE,
+    TRACE_SOCKET_CONNECT,
+    TRACE_ENTER_RETRY_WAIT,
+    TRACE_NOTIFY_CLIENTS,
+    TRACE_EVACUATION,
+    TRACE_SPAN_COUNT
+};
+
+struct TraceEntry {
+    uint64_t timestampNs;
+    int32_t pid;
+    int32_t tid;
+    uint16_t span;
+    char phase;         // Chrome trace phases: 'B' begin, 'E' end, 'i' instant
+    uint8_t argCount;
+    int64_t args[2];
+};
+
+using TraceRing = SharedRing<TraceEntry, 512>;
+
+struct TraceSegment {
+    static constexpr int RING_COUNT = 512;
+
+    TraceRing rings[RING_COUNT];
+};
+
+// Visitor lifecycle tracing. Spans are recorded as begin/end entries with monotonic timestamps into
+// the calling process's ring in the trace segment; the log drain turns them into Chrome trace JSON.
+// The switch lives in shared memory, so tracing can be turned on and off while the simulation runs,
+// and a disabled trace point costs one relaxed load.
+class Tracer {
+private:
+    static TraceSegment *segment;
+    static bool attached;
+    static std::atomic<TraceRing *> processRing;
+    static std::atomic<bool> noRingAvailable;
+
+    static TraceRing *claimRing();
+
+    static void record(TraceSpan span, char phase, int argCount, int64_t arg0, int64_t arg1);
+
+public:
+    static bool enabled() {
+        SharedMemory *shm = SharedSegment::get();
+        return shm && shm->trace.enabled.load(std::memory_order_relaxed);
+    }
+
+    static void setEnabled(bool value);
+
+    static void createSegment();
+
+    static void removeSegment();
+
+    static TraceSegment *getSegment();
+
+    static void begin(TraceSpan span, int64_t arg0 = 0, int64_t arg1 = 0) {
+        record(span, 'B', 2, arg0, arg1);
+    }
+
+    static void end(TraceSpan span) {
+        record(span, 'E', 0, 0, 0);
+    }
+
+    // End of a span carrying what was learned inside it, e.g. the queue position or the outcome
+    static void end(TraceSpan span, int64_t arg0) {
+        record(span, 'E', 1, arg0, 0);
+    }
+
+    static void instant(TraceSpan span, int64_t arg0 = 0, int64_t arg1 = 0) {
+        if (enabled()) {
+            record(span, 'i', 2, arg0, arg1);
+        }
+    }
+
+    // One Chrome trace event object, without a trailing separator
+    static std::string toJson(const TraceEntry &entry);
+};
+
+// Begins a span when tracing is on and ends it when the scope is left
+class TraceScope {
+private:
+    TraceSpan span;
+    bool active;
+    bool hasResult;
+    int64_t result;
+
+public:
+    explicit TraceScope(TraceSpan span, int64_t arg0 = 0, int64_t arg1 = 0)
+            : span(span), active(Tracer::enabled()), hasResult(false), result(0) {
+        if (active) {
+            Tracer::begin(span, arg0, arg1);
+        }
+    }
+
+    ~TraceScope() {
+        if (!active) {
+            return;
+        }
+        if (hasResult) {
+            Tracer::end(span, result);
+        } else {
+            Tracer::end(span);
+        }
+    }
+
+    void setResult(int64_t value) {
+        hasResult = true;
+        result = value;
+    }
+
+    TraceScope(const TraceScope &) = delete;
+
+    TraceScope &operator=(const TraceScope &) = delete;
+};
+
+#endif
@@ -1,19 +1,24 @@
 #include "ui_manager.h"
 #include "working_hours_manager.h"
+#include "roster_scan.h"
+#include "lock_stats.h"
+#include "metrics.h"
+#include "queue_policy.h"
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <vector>
 
 std::mutex UIManager::instanceMutex;
 std::unique_ptr<UIManager> UIManager::instance;
 
 UIManager::UIManager()
-        : shouldRun(false), isRunning(false), shmId(-1) {
+        : shouldRun(false), isRunning(false) {
     initSharedMemory();
 }
 
 void UIManager::initSharedMemory() {
-    shmId = shmget(SHM_KEY, sizeof(SharedMemory), 0666);
-    if (shmId < 0) {
-        perror("shmget failed in UIManager");
+    if (!SharedSegment::get()) {
         throw std::runtime_error("Failed to get shared memory");
     }
 }
@@ -43,76 +48,192 @@ void UIManager::clearScreen() {
 void UIManager::displayQueueState() {
     std::lock_guard<std::mutex> displayLock(displayMutex);
 
-    auto *shm = (SharedMemory *) shmat(shmId, nullptr, 0);
-    if (shm == (void *) -1) return;
+    SharedMemory *shm = SharedSegment::get();
+    if (!shm) return;
 
     pthread_mutex_lock(&shm->mutex);
 
-    std::cout << Color::CYAN << "Entrance Queue" << Color::RESET << "\n";
-    std::cout << "Queue size: " << shm->entranceQueue.queueSize << "/"
-              << EntranceQueue::MAX_QUEUE_SIZE << "\n";
+    renderQueueState(shm->entranceQueue);
+
+    pthread_mutex_unlock(&shm->mutex);
+}
 
-    for (int i = 0; i < shm->entranceQueue.queueSize; i++) {
-        std::cout << " - Client " << shm->entranceQueue.queue[i].clientId
-                  << (shm->entranceQueue.queue[i].isVip ?
+void UIManager::renderQueueState(const EntranceQueue &queue) {
+    std::cout << Color::CYAN << "Entrance Queue" << Color::RESET << "\n";
+    std::cout << "Queue size: " << queue.queueSize << "/"
+              << EntranceQueue::MAX_QUEUE_SIZE << ", policy " << QueueSettings::policyName(queue.policy) << "\n";
+
+    // queue[] is a heap, so the visitors are listed from a sorted copy
+    int size = std::clamp(queue.queueSize, 0, EntranceQueue::MAX_QUEUE_SIZE);
+    std::vector<EntranceQueue::QueueEntry> order(queue.queue, queue.queue + size);
+    std::stable_sort(order.begin(), order.end(), EntranceQueue::before);
+    for (const auto &entry: order) {
+        std::cout << " - Client " << entry.clientId
+                  << (entry.isVip ?
                       Color::YELLOW + " (VIP)" + Color::RESET : "") << "\n";
     }
-
-    pthread_mutex_unlock(&shm->mutex);
-    shmdt(shm);
 }
 
 void UIManager::displayPoolState(Pool *pool) const {
     if (!pool) return;
 
-    auto *shm = (SharedMemory *) shmat(shmId, nullptr, 0);
-    if (shm == (void *) -1) {
-        perror("shmat failed in displayPoolState");
+    SharedMemory *shm = SharedSegment::get();
+    if (!shm) {
         return;
     }
 
     PoolState *state = nullptr;
-    std::string poolName;
     switch (pool->getType()) {
         case Pool::PoolType::Olympic:
             state = &shm->olympic;
-            poolName = Color::BLUE + "Olympic Pool" + Color::RESET;
             break;
         case Pool::PoolType::Recreational:
             state = &shm->recreational;
-            poolName = Color::GREEN + "Recreational Pool" + Color::RESET;
             break;
         case Pool::PoolType::Children:
             state = &shm->kids;
-            poolName = Color::YELLOW + "Children's Pool" + Color::RESET;
             break;
     }
 
     if (state) {
-        std::cout << poolName << "\n";
-        std::cout << "Occupancy: " << state->currentCount << "/" << pool->getCapacity() << "\n";
-        std::cout << "Status: " << (state->isClosed ? Color::RED + "CLOSED" : Color::GREEN + "OPEN")
-                  << Color::RESET << "\n";
+        renderPoolState(*state, pool->getType(), pool->getCapacity());
+    }
+}
+
+void UIManager::renderPoolState(const PoolState &state, Pool::PoolType poolType, int capacity) {
+    std::string poolName;
+    switch (poolType) {
+        case Pool::PoolType::Olympic:
+            poolName = Color::BLUE + "Olympic Pool" + Color::RESET;
+            break;
+        case Pool::PoolType::Recreational:
+            poolName = Color::GREEN + "Recreational Pool" + Color::RESET;
+            break;
+        case Pool::PoolType::Children:
+            poolName = Color::YELLOW + "Children's Pool" + Color::RESET;
+            break;
+    }
+
+    std::cout << poolName << "\n";
+    std::cout << "Occupancy: " << state.currentCount << "/" << capacity << "\n";
+    std::cout << "Status: " << (state.isClosed ? Color::RED + "CLOSED" : Color::GREEN + "OPEN")
+              << Color::RESET << "\n";
+
+    if (state.isUnderMaintenance) {
+        std::cout << Color::RED << "MAINTENANCE IN PROGRESS" << Color::RESET << "\n";
+    }
+
+    int count = std::clamp(state.currentCount, 0, PoolState::MAX_CLIENTS);
+    if (count > 0) {
+        char averageAge[16];
+        snprintf(averageAge, sizeof(averageAge), "%.1f",
+                 static_cast<double>(RosterScan::sumAges(state.ages, count)) / count);
+        std::cout << "VIP: " << RosterScan::countFlags(state.flags, count, CLIENT_VIP)
+                  << ", with guardian: " << RosterScan::countFlags(state.flags, count, CLIENT_HAS_GUARDIAN)
+                  << ", average age: " << averageAge << "\n";
+    }
 
-        if (state->isUnderMaintenance) {
-            std::cout << Color::RED << "MAINTENANCE IN PROGRESS" << Color::RESET << "\n";
+    std::cout << "Clients:\n";
+    for (int i = 0; i < count; i++) {
+        bool hasGuardian = state.flags[i] & CLIENT_HAS_GUARDIAN;
+        std::cout << " - Client " << state.ids[i]
+                  << " (Age: " << state.ages[i]
+                  << (state.flags[i] & CLIENT_VIP ? ", VIP" : "")
+                  << (hasGuardian ? ", Has Guardian #" + std::to_string(state.guardianIds[i]) : "")
+                  << ")\n";
+    }
+    std::cout << "\n";
+}
+
+namespace {
+    std::string formatNs(uint64_t ns) {
+        char text[32];
+        if (ns < 1000) {
+            snprintf(text, sizeof(text), "%lluns", static_cast<unsigned long long>(ns));
+        } else if (ns < 1000000) {
+            snprintf(text, sizeof(text), "%.1fus", static_cast<double>(ns) / 1e3);
+        } else if (ns < 1000000000) {
+            snprintf(text, sizeof(text), "%.1fms", static_cast<double>(ns) / 1e6);
+        } else {
+            snprintf(text, sizeof(text), "%.1fs", static_cast<double>(ns) / 1e9);
         }
+        return text;
+    }
+}
+
+void UIManager::renderLockStats(const LockCounters locks[SEM_COUNT]) {
+    std::cout << Color::CYAN << "Locks" << Color::RESET << "\n";
+    if (!LockStats::enabled()) {
+        std::cout << "Lock statistics compiled out (POOL_LOCK_STATS=OFF)\n";
+        return;
+    }
 
-        std::cout << "Clients:\n";
-        for (int i = 0; i < state->currentCount; i++) {
-            const ClientData &client = state->clients[i];
-            std::cout << " - Client " << client.id
-                      << " (Age: " << client.age
-                      << (client.isVip ? ", VIP" : "")
-                      << (client.hasGuardian ? ", Has Guardian #" + std::to_string(client.guardianId) : "")
-                      << ")\n";
+    // Wait and hold times are bucket upper bounds, so within a factor of two
+    for (int lock = SEM_OLYMPIC; lock <= SEM_ENTRANCE_QUEUE; lock++) {
+        const LockCounters &counters = locks[lock];
+        uint64_t acquisitions = counters.acquisitions.load(std::memory_order_relaxed);
+        uint64_t contended = counters.contended.load(std::memory_order_relaxed);
+        char line[160];
+        snprintf(line, sizeof(line), "%-15s %8llu acq, %5.1f%% contended, wait p50 %s p99 %s, hold p50 %s p99 %s",
+                 Metrics::lockLabel(lock), static_cast<unsigned long long>(acquisitions),
+                 acquisitions ? 100.0 * contended / acquisitions : 0.0,
+                 formatNs(LockStats::percentileNs(counters.wait, 0.50)).c_str(),
+                 formatNs(LockStats::percentileNs(counters.wait, 0.99)).c_str(),
+                 formatNs(LockStats::percentileNs(counters.hold, 0.50)).c_str(),
+                 formatNs(LockStats::percentileNs(counters.hold, 0.99)).c_str());
+        std::cout << line;
+
+        int holder = counters.holderPid.load(std::memory_order_relaxed);
+        if (holder != 0) {
+            auto role = static_cast<ProcessRole>(counters.holderRole.load(std::memory_order_relaxed));
+            std::cout << Color::YELLOW << ", held by " << processRoleName(role) << " " << holder << Color::RESET;
         }
         std::cout << "\n";
+
+        std::string roles;
+        for (int role = 0; role < ROLE_COUNT; role++) {
+            uint64_t byRole = counters.acquisitionsByRole[role].load(std::memory_order_relaxed);
+            if (byRole > 0) {
+                roles += (roles.empty() ? "" : ", ") + std::string(processRoleName(static_cast<ProcessRole>(role))) +
+                         " " + std::to_string(byRole) + " (held " +
+                         formatNs(counters.holdNsByRole[role].load(std::memory_order_relaxed)) + ")";
+            }
+        }
+        if (!roles.empty()) {
+            std::cout << "                by role: " << roles << "\n";
+        }
     }
+}
 
-    shmdt(shm);
+void UIManager::renderLatency(const LatencySegment &latency) {
+    std::cout << Color::CYAN << "Latency" << Color::RESET << "\n";
+    for (int op = 0; op < LATENCY_OP_COUNT; op++) {
+        LatencySnapshot snapshot = LatencyHistograms::merged(latency, static_cast<LatencyOp>(op));
+        char line[160];
+        snprintf(line, sizeof(line), "%-15s %8llu calls, p50 %s p99 %s p99.9 %s max %s\n",
+                 LatencyHistograms::opName(op), static_cast<unsigned long long>(snapshot.total),
+                 formatNs(snapshot.percentileNs(0.50)).c_str(), formatNs(snapshot.percentileNs(0.99)).c_str(),
+                 formatNs(snapshot.percentileNs(0.999)).c_str(), formatNs(snapshot.maxNs).c_str());
+        std::cout << line;
+    }
 }
 
+void UIManager::renderFrame(const std::string &title, bool facilityOpen, const PoolState pools[POOL_COUNT],
+                            const int capacities[POOL_COUNT], const EntranceQueue &queue) {
+    clearScreen();
+
+    std::cout << Color::MAGENTA << title << Color::RESET << "\n\n";
+    std::cout << "Status: " << (facilityOpen ? Color::GREEN + "OPEN" : Color::RED + "CLOSED")
+              << Color::RESET << "\n\n";
+
+    for (int i = 0; i < POOL_COUNT; i++) {
+        renderPoolState(pools[i], static_cast<Pool::PoolType>(i), capacities[i]);
+        std::cout << std::string(50, '-') << "\n";
+    }
+
+    renderQueueState(queue);
+    std::cout << std::flush;
+}
 
 void UIManager::startMonitoring() {
     if (!checkIfMainProcessRunning()) {
@@ -153,6 +274,14 @@ void UIManager::startMonitoring() {
                 }
 
                 displayQueueState();
+                std::cout << std::string(50, '-') << "\n";
+                if (SharedMemory *shm = SharedSegment::get()) {
+                    renderLockStats(shm->locks);
+                }
+                if (LatencySegment *latency = LatencyHistograms::getSegment()) {
+                    std::cout << std::string(50, '-') << "\n";
+                    renderLatency(*latency);
+                }
                 std::cout << "\nPress Ctrl+C to exit\n";
 
                 std::this_thread::sleep_for(std::chrono::milliseconds(500));
@@ -170,12 +299,5 @@ bool UIManager::checkIfMainProcessRunning() {
 }
 
 bool UIManager::tryAttachToSharedMemory() {
-    int shmId = shmget(SHM_KEY, sizeof(SharedMemory), 0666);
-    if (shmId < 0) return false;
-
-    void *shm = shmat(shmId, nullptr, 0);
-    if (shm == (void *) -1) return false;
-
-    shmdt(shm);
-    return true;
+    return SharedSegment::exists();
 }
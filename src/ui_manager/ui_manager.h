@@ -7,6 +7,7 @@
 #include <mutex>
 #include <memory>
 #include "pool_manager.h"
+#include "latency_histogram.h"
 
 namespace Color {
     const std::string RESET = "\033[0m";
@@ -27,14 +28,11 @@ private:
     std::thread displayThread;
     std::atomic<bool> shouldRun;
     std::mutex displayMutex;
-    int shmId;
 
     UIManager();
 
     static bool tryAttachToSharedMemory();
 
-    static void clearScreen();
-
     void displayQueueState();
 
     void displayPoolState(Pool *pool) const;
@@ -42,6 +40,19 @@ private:
     void initSharedMemory();
 
 public:
+    static void clearScreen();
+
+    static void renderPoolState(const PoolState &state, Pool::PoolType poolType, int capacity);
+
+    static void renderQueueState(const EntranceQueue &queue);
+
+    static void renderLockStats(const LockCounters locks[SEM_COUNT]);
+
+    static void renderLatency(const LatencySegment &latency);
+
+    static void renderFrame(const std::string &title, bool facilityOpen, const PoolState pools[POOL_COUNT],
+                            const int capacities[POOL_COUNT], const EntranceQueue &queue);
+
     void startMonitoring();
 
     std::thread& getDisplayThread() { return displayThread; }
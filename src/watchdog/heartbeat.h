@@ -0,0 +1,32 @@
+#ifndef SWIMMING_POOL_HEARTBEAT_H
+#define SWIMMING_POOL_HEARTBEAT_H
+
+#include "metrics.h"
+#include <unistd.h>
+
+// Liveness counters of the watched roles. A watched process calls attach() once and beat() from the
+// loop that must not stall; both are a few relaxed stores into the main segment.
+class Heartbeat {
+public:
+    static void attach(WatchedRole role) {
+        if (SharedMemory *shm = SharedSegment::get()) {
+            shm->heartbeats[role].lastBeatNs.store(Metrics::nowNs(), std::memory_order_relaxed);
+            shm->heartbeats[role].pid.store(getpid(), std::memory_order_release);
+        }
+    }
+
+    static void beat(WatchedRole role) {
+        beat(role, Metrics::nowNs());
+    }
+
+    // For a process with more than one loop that can stall: the oldest moment all of them were
+    // known to make progress
+    static void beat(WatchedRole role, uint64_t progressNs) {
+        if (SharedMemory *shm = SharedSegment::get()) {
+            shm->heartbeats[role].lastBeatNs.store(progressNs, std::memory_order_relaxed);
+            shm->heartbeats[role].beats.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "watchdog.h"
+#include "event_log.h"
+#include "metrics.h"
+#include "shutdown_coordinator.h"
+#include <csignal>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sys/msg.h>
+#include <thread>
+
+namespace {
+    const char *const ROLE_NAMES[WATCH_COUNT] = {
+            "cashier", "lifeguard_Olympic", "lifeguard_Recreational", "lifeguard_Children", "client_zygote"
+    };
+
+    std::string readProcLine(const std::string &path, const std::string &prefix = "") {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (prefix.empty() || line.compare(0, prefix.size(), prefix) == 0) {
+                return line;
+            }
+        }
+        return "?";
+    }
+
+    double seconds(uint64_t ns) {
+        return static_cast<double>(ns) / 1e9;
+    }
+}
+
+Watchdog::Watchdog(ProcessRegistry &processes, std::atomic<bool> &shouldRun, double thresholdS,
+                   RestartFunction restart)
+        : processes(processes), shouldRun(shouldRun), thresholdNs(static_cast<uint64_t>(thresholdS * 1e9)),
+          restart(std::move(restart)), recoveries{}, recovered(0), totalRecoveryNs(0), maxRecoveryNs(0) {}
+
+const char *Watchdog::roleName(WatchedRole role) {
+    return role >= 0 && role < WATCH_COUNT ? ROLE_NAMES[role] : "unknown";
+}
+
+ProcessRole Watchdog::processRole(WatchedRole role) {
+    switch (role) {
+        case WATCH_CASHIER:
+            return ProcessRole::Cashier;
+        case WATCH_ZYGOTE:
+            return ProcessRole::Zygote;
+        default:
+            return ProcessRole::Lifeguard;
+    }
+}
+
+void Watchdog::dumpState(const SharedMemory &shm, WatchedRole role, pid_t pid, uint64_t silentNs) const {
+    const RoleHeartbeat &heartbeat = shm.heartbeats[role];
+    std::string proc = "/proc/" + std::to_string(pid);
+    std::cerr << "Watchdog: " << roleName(role) << " (pid " << pid << ") silent for " << seconds(silentNs)
+              << " s after " << heartbeat.beats.load(std::memory_order_relaxed) << " heartbeats\n"
+              << "  " << readProcLine(proc + "/status", "State:") << "\n";
+
+    // Where each thread sleeps in the kernel points at the blocking call
+    if (DIR *tasks = opendir((proc + "/task").c_str())) {
+        while (dirent *task = readdir(tasks)) {
+            if (task->d_name[0] == '.') {
+                continue;
+            }
+            std::string dir = proc + "/task/" + task->d_name;
+            std::cerr << "  thread " << task->d_name << " (" << readProcLine(dir + "/comm") << "): "
+                      << readProcLine(dir + "/status", "State:") << ", wchan " << readProcLine(dir + "/wchan")
+                      << "\n";
+        }
+        closedir(tasks);
+    }
+
+    for (int lock = 0; lock < SEM_COUNT; lock++) {
+        if (shm.locks[lock].holderPid.load(std::memory_order_relaxed) == pid) {
+            std::cerr << "  holds the " << Metrics::lockLabel(lock) << " semaphore\n";
+        }
+    }
+
+    if (role == WATCH_CASHIER) {
+        struct msqid_ds queue{};
+        int msgId = msgget(IpcKeys::key(CASHIER_MSG_KEY), 0666);
+        std::cerr << "  entrance queue " << shm.entranceQueue.queueSize << "/" << EntranceQueue::MAX_QUEUE_SIZE
+                  << ", last ticket " << shm.entranceQueue.lastTicketNumber;
+        if (msgId >= 0 && msgctl(msgId, IPC_STAT, &queue) == 0) {
+            std::cerr << ", cashier message queue " << queue.msg_qnum << " messages, " << queue.msg_cbytes << "/"
+                      << queue.msg_qbytes << " bytes";
+        }
+        std::cerr << "\n";
+    } else if (role != WATCH_ZYGOTE) {
+        const PoolState *states[] = {&shm.olympic, &shm.recreational, &shm.kids};
+        const PoolState &state = *states[role - WATCH_LIFEGUARD_OLYMPIC];
+        std::cerr << "  pool " << state.currentCount << " visitors, " << (state.isClosed ? "closed" : "open")
+                  << (state.isUnderMaintenance ? ", under maintenance" : "") << "\n";
+    }
+    std::cerr << std::flush;
+}
+
+void Watchdog::check(SharedMemory &shm, WatchedRole role) {
+    RoleHeartbeat &heartbeat = shm.heartbeats[role];
+    Recovery &recovery = recoveries[role];
+    int32_t pid = heartbeat.pid.load(std::memory_order_acquire);
+    uint64_t lastBeatNs = heartbeat.lastBeatNs.load(std::memory_order_relaxed);
+    uint64_t now = Metrics::nowNs();
+    if (pid <= 0) {
+        return;
+    }
+
+    if (recovery.pending) {
+        if (pid != recovery.stalledPid) {
+            // The new process has beaten
+            uint64_t recoveryNs = lastBeatNs > recovery.lastBeatNs ? lastBeatNs - recovery.lastBeatNs : 0;
+            recovered++;
+            totalRecoveryNs += recoveryNs;
+            maxRecoveryNs = std::max(maxRecoveryNs, recoveryNs);
+            recovery.pending = false;
+            EventLog::log(LOG_WATCHDOG_RECOVERED, static_cast<int>(processRole(role)), pid, seconds(recoveryNs));
+            return;
+        }
+        // Give the new process the same time before starting yet another
+        if (now - recovery.restartedNs <= thresholdNs) {
+            return;
+        }
+    } else if (now < lastBeatNs || now - lastBeatNs <= thresholdNs) {
+        return;
+    }
+
+    if (!recovery.pending) {
+        EventLog::log(LOG_WATCHDOG_STALL, static_cast<int>(processRole(role)), pid, seconds(now - lastBeatNs));
+        dumpState(shm, role, pid, now - lastBeatNs);
+        kill(pid, SIGKILL);
+        recovery = {true, pid, lastBeatNs, now};
+    }
+    recovery.restartedNs = now;
+
+    pid_t newPid = restart(role);
+    if (newPid > 0) {
+        processes.add(newPid, processRole(role));
+    } else {
+        std::cerr << "Watchdog: could not restart " << roleName(role) << std::endl;
+    }
+}
+
+void Watchdog::run() {
+    SharedMemory *shm = SharedSegment::get();
+    if (!shm || thresholdNs == 0) {
+        return;
+    }
+
+    while (shouldRun.load() && !ShutdownCoordinator::stopRequested()) {
+        for (int role = 0; role < WATCH_COUNT; role++) {
+            check(*shm, static_cast<WatchedRole>(role));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    printStats(std::cout);
+}
+
+void Watchdog::printStats(std::ostream &out) const {
+    out << "Watchdog: " << recovered << " recoveries";
+    if (recovered > 0) {
+        out << ", mean time to recovery " << seconds(totalRecoveryNs) * 1000 / static_cast<double>(recovered)
+            << " ms (max " << seconds(maxRecoveryNs) * 1000 << " ms)";
+    }
+    out << std::endl;
+}
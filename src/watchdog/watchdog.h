@@ -0,0 +1,59 @@
+#ifndef SWIMMING_POOL_WATCHDOG_H
+#define SWIMMING_POOL_WATCHDOG_H
+
+#include "process_registry.h"
+#include "shared_memory.h"
+#include <atomic>
+#include <functional>
+#include <ostream>
+
+// Runs on a thread of the main process. A watched role whose heartbeat is older than the threshold
+// is taken as stalled (hung, stopped or crashed): its state is dumped to stderr, the process is
+// SIGKILLed and the role is started again. What the role works on lives in shared memory or in the
+// message queue (entrance queue, ticket counter, pool states), so the new process carries on from
+// there. Recovery time is measured from the last heartbeat of the old process to the first of the
+// new one.
+class Watchdog {
+public:
+    // Starts the role again, returns the new pid or -1
+    using RestartFunction = std::function<pid_t(WatchedRole role)>;
+
+private:
+    struct Recovery {
+        bool pending;
+        int32_t stalledPid;
+        uint64_t lastBeatNs;
+        uint64_t restartedNs;
+    };
+
+    ProcessRegistry &processes;
+    std::atomic<bool> &shouldRun;
+    uint64_t thresholdNs;
+    RestartFunction restart;
+    Recovery recoveries[WATCH_COUNT];
+
+    uint64_t recovered;
+    uint64_t totalRecoveryNs;
+    uint64_t maxRecoveryNs;
+
+    void dumpState(const SharedMemory &shm, WatchedRole role, pid_t pid, uint64_t silentNs) const;
+
+    void check(SharedMemory &shm, WatchedRole role);
+
+public:
+    Watchdog(ProcessRegistry &processes, std::atomic<bool> &shouldRun, double thresholdS, RestartFunction restart);
+
+    void run();
+
+    void printStats(std::ostream &out) const;
+
+    static const char *roleName(WatchedRole role);
+
+    static ProcessRole processRole(WatchedRole role);
+
+    Watchdog(const Watchdog &) = delete;
+
+    Watchdog &operator=(const Watchdog &) = delete;
+};
+
+#endif
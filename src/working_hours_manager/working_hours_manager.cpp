@@ -1,24 +1,13 @@
 #include "working_hours_manager.h"
-#include <time.h>
+#include "sim_clock.h"
+#include "shared_segment.h"
 
 bool WorkingHoursManager::isOpen() {
-    time_t now;
-    time(&now);
-    struct tm timeinfo {};
-    localtime_r(&now, &timeinfo);
+    int currentHour = SimClock::hour();
 
-    int currentHour = timeinfo.tm_hour;
-
-    int shmId = shmget(SHM_KEY, sizeof(SharedMemory), 0666);
-    if (shmId < 0) {
-        perror("shmget failed in WorkingHoursManager");
-        return false;
-    }
-
-    auto *shm = (SharedMemory *) shmat(shmId, nullptr, 0);
-
-    if (shm == (void *) -1) {
-        perror("shmat failed in WorkingHoursManager");
+    SharedMemory *shm = SharedSegment::get();
+    if (!shm) {
+        std::cerr << "Shared memory segment not found in WorkingHoursManager" << std::endl;
         return false;
     }
 
@@ -28,10 +17,5 @@ bool WorkingHoursManager::isOpen() {
                   !shm->recreational.isUnderMaintenance &&
                   !shm->kids.isUnderMaintenance;
 
-    if (shmdt(shm) == -1) {
-        perror("shmdt failed");
-        return false;
-    }
-
     return isOpen;
 }